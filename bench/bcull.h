@@ -0,0 +1,55 @@
+/* Copyright [2013-2018] [Aaron Springstroh, Minimal Graphics Library]
+
+This file is part of the Beyond Dying Skies.
+
+Beyond Dying Skies is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+Beyond Dying Skies is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with Beyond Dying Skies.  If not, see <http://www.gnu.org/licenses/>.
+*/
+#ifndef _BDS_BENCH_CULL_BDS_
+#define _BDS_BENCH_CULL_BDS_
+
+#include <bench.h>
+#include <game/frustum_cull.h>
+#include <min/aabbox.h>
+#include <min/vec3.h>
+#include <random>
+
+void bench_cull(bench_results &results, const size_t iterations)
+{
+    // Fixed seed so every run culls the same boxes
+    std::mt19937 gen(0);
+    std::uniform_real_distribution<float> dist(-512.0, 512.0);
+
+    // Instance sized boxes scattered around a camera looking down +z
+    const size_t count = 50000;
+    game::frustum_cull cull;
+    cull.reserve(count);
+    const min::vec3<float> extent(0.5, 0.5, 0.5);
+    for (size_t i = 0; i < count; i++)
+    {
+        const min::vec3<float> p(dist(gen), dist(gen), dist(gen));
+        cull.add(min::aabbox<float, min::vec3>(p - extent, p + extent));
+    }
+    cull.set_view(min::vec3<float>(), min::vec3<float>(0.0, 0.0, 1.0), min::vec3<float>(0.0, 1.0, 0.0), min::vec3<float>(1.0, 0.0, 0.0), 1.333, 1.0, 0.1, 5000.0);
+    cull.set_range(min::vec3<float>(), 400.0);
+
+    // Benchmark one box at a time against the batched path
+    results.run("cull_scalar", 0, 0, count, iterations, [&cull](const size_t i) {
+        cull.cull_scalar();
+    });
+    results.run("cull_batch", 0, 0, count, iterations, [&cull](const size_t i) {
+        cull.cull();
+    });
+}
+
+#endif
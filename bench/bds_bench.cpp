@@ -0,0 +1,153 @@
+/* Copyright [2013-2018] [Aaron Springstroh, Minimal Graphics Library]
+
+This file is part of the Beyond Dying Skies.
+
+Beyond Dying Skies is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+Beyond Dying Skies is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with Beyond Dying Skies.  If not, see <http://www.gnu.org/licenses/>.
+*/
+#include <bench.h>
+#include <bcull.h>
+#include <bgrid.h>
+#include <bphysics.h>
+#include <fstream>
+#include <game/def.h>
+#include <game/options.h>
+#include <game/work_queue.h>
+#include <iostream>
+#include <string>
+#include <utility>
+#include <vector>
+
+bool parse_uint(char *str, size_t &out)
+{
+    // Try to parse string input
+    try
+    {
+        out = std::stoi(str);
+        return true;
+    }
+    catch (const std::exception &ex)
+    {
+        std::cout << "bds_bench: couldn't parse input: '"
+                  << str << "', expected integral type" << std::endl;
+    }
+
+    // Bad parse
+    return false;
+}
+
+int main(int argc, char *argv[])
+{
+    try
+    {
+        // Default parameters
+        size_t grid = 0;
+        size_t chunk = 0;
+        size_t drops = 1000;
+        size_t drones = 10;
+        size_t iterations = 5;
+        std::string file;
+
+        // Try to parse commandline args
+        for (int i = 1; i < argc; i++)
+        {
+            const std::string input(argv[i]);
+            size_t parse;
+            if (i < (argc - 1))
+            {
+                if (input.compare("-grid") == 0 && parse_uint(argv[++i], parse))
+                {
+                    grid = parse;
+                }
+                else if (input.compare("-chunk") == 0 && parse_uint(argv[++i], parse))
+                {
+                    chunk = parse;
+                }
+                else if (input.compare("-drops") == 0 && parse_uint(argv[++i], parse))
+                {
+                    drops = parse;
+                }
+                else if (input.compare("-drones") == 0 && parse_uint(argv[++i], parse))
+                {
+                    drones = parse;
+                }
+                else if (input.compare("-iter") == 0 && parse_uint(argv[++i], parse))
+                {
+                    iterations = parse;
+                }
+                else if (input.compare("-o") == 0)
+                {
+                    file = argv[++i];
+                }
+                else
+                {
+                    std::cout << "bds_bench: unknown flag '" << input << "'" << std::endl;
+                    return -1;
+                }
+            }
+            else
+            {
+                std::cout << "bds_bench: not enough arguments passed for '" << input << "'" << std::endl;
+                return -1;
+            }
+        }
+
+        // Default grid and chunk sizes, or the single size requested
+        std::vector<std::pair<size_t, size_t>> sizes = {{16, 4}, {32, 8}, {64, 8}};
+        if (grid > 0 || chunk > 0)
+        {
+            sizes = {{(grid > 0) ? grid : 64, (chunk > 0) ? chunk : 8}};
+        }
+
+        // Run all benchmarks for each size
+        bench_results results;
+        for (const auto &s : sizes)
+        {
+            game::options opt;
+            opt.set_grid(s.first);
+            opt.set_chunk(s.second);
+            if (opt.check_error())
+            {
+                return -1;
+            }
+
+            // Print progress to stderr so stdout stays valid JSON
+            std::cerr << "bds_bench: grid " << s.first << " chunk " << s.second << std::endl;
+            bench_grid(results, opt, iterations);
+            bench_physics(results, opt, drops, drones, iterations);
+        }
+
+        // Frustum culling does not depend on the grid size
+        bench_cull(results, iterations);
+
+        // Write the results
+        const size_t threads = game::work_queue::worker.size();
+        if (file.empty())
+        {
+            results.write_json(std::cout, game::_game_version, threads);
+        }
+        else
+        {
+            std::ofstream out(file);
+            results.write_json(out, game::_game_version, threads);
+        }
+    }
+    catch (const std::exception &ex)
+    {
+        std::cout << "bds_bench failed!" << std::endl;
+        std::cout << ex.what() << std::endl;
+        return -1;
+    }
+
+    return 0;
+}
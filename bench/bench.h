@@ -0,0 +1,134 @@
+/* Copyright [2013-2018] [Aaron Springstroh, Minimal Graphics Library]
+
+This file is part of the Beyond Dying Skies.
+
+Beyond Dying Skies is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+Beyond Dying Skies is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with Beyond Dying Skies.  If not, see <http://www.gnu.org/licenses/>.
+*/
+#ifndef _BDS_BENCH_BDS_
+#define _BDS_BENCH_BDS_
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <iomanip>
+#include <ostream>
+#include <string>
+#include <vector>
+
+class bench_result
+{
+  public:
+    std::string name;
+    size_t grid;
+    size_t chunk;
+    size_t count;
+    size_t iterations;
+    double mean;
+    double min;
+    double max;
+
+    bench_result(const std::string &n, const size_t g, const size_t c, const size_t items)
+        : name(n), grid(g), chunk(c), count(items), iterations(0), mean(0.0), min(0.0), max(0.0) {}
+};
+
+class bench_results
+{
+  private:
+    std::vector<bench_result> _results;
+
+    static inline std::string escape(const std::string &str)
+    {
+        // Escape quotes and backslashes for JSON strings
+        std::string out;
+        out.reserve(str.size());
+        for (const char c : str)
+        {
+            if (c == '"' || c == '\\')
+            {
+                out.push_back('\\');
+            }
+            out.push_back(c);
+        }
+
+        return out;
+    }
+
+  public:
+    template <typename F>
+    inline const bench_result &run(const std::string &name, const size_t grid, const size_t chunk, const size_t count, const size_t iterations, const F &f)
+    {
+        typedef std::chrono::steady_clock clock;
+        bench_result result(name, grid, chunk, count);
+
+        // Time each iteration
+        std::vector<double> times;
+        times.reserve(iterations);
+        for (size_t i = 0; i < iterations; i++)
+        {
+            const auto start = clock::now();
+            f(i);
+            const auto stop = clock::now();
+            times.push_back(std::chrono::duration<double, std::milli>(stop - start).count());
+        }
+
+        // Calculate statistics
+        if (iterations > 0)
+        {
+            double sum = 0.0;
+            for (const double t : times)
+            {
+                sum += t;
+            }
+            result.iterations = iterations;
+            result.mean = sum / iterations;
+            result.min = *std::min_element(times.begin(), times.end());
+            result.max = *std::max_element(times.begin(), times.end());
+        }
+
+        // Store the result
+        _results.push_back(result);
+
+        return _results.back();
+    }
+    inline void write_json(std::ostream &out, const std::string &version, const size_t threads) const
+    {
+        out << std::fixed << std::setprecision(6);
+        out << "{" << std::endl;
+        out << "  \"bench\": \"bds_bench\"," << std::endl;
+        out << "  \"version\": \"" << escape(version) << "\"," << std::endl;
+        out << "  \"threads\": " << threads << "," << std::endl;
+        out << "  \"results\": [" << std::endl;
+
+        // Write each result on its own line
+        const size_t size = _results.size();
+        for (size_t i = 0; i < size; i++)
+        {
+            const bench_result &r = _results[i];
+            out << "    {\"name\": \"" << escape(r.name) << "\""
+                << ", \"grid\": " << r.grid
+                << ", \"chunk\": " << r.chunk
+                << ", \"count\": " << r.count
+                << ", \"iterations\": " << r.iterations
+                << ", \"mean_ms\": " << r.mean
+                << ", \"min_ms\": " << r.min
+                << ", \"max_ms\": " << r.max << "}";
+            out << ((i + 1 < size) ? "," : "") << std::endl;
+        }
+
+        out << "  ]" << std::endl;
+        out << "}" << std::endl;
+    }
+};
+
+#endif
@@ -0,0 +1,263 @@
+/* Copyright [2013-2018] [Aaron Springstroh, Minimal Graphics Library]
+
+This file is part of the Beyond Dying Skies.
+
+Beyond Dying Skies is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+Beyond Dying Skies is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with Beyond Dying Skies.  If not, see <http://www.gnu.org/licenses/>.
+*/
+#ifndef _BDS_BENCH_GRID_BDS_
+#define _BDS_BENCH_GRID_BDS_
+
+#include <bench.h>
+#include <cstdio>
+#include <fstream>
+#include <game/cgrid.h>
+#include <game/cgrid_generator.h>
+#include <game/id.h>
+#include <game/mapped_file.h>
+#include <game/options.h>
+#include <game/world_format.h>
+#include <iostream>
+#include <min/ray.h>
+#include <min/serial.h>
+#include <min/vec3.h>
+#include <random>
+#include <string>
+#include <utility>
+#include <vector>
+
+std::vector<min::vec3<float>> bench_empty_points(game::cgrid &grid, std::mt19937 &gen, const size_t count)
+{
+    // Sample points inside the world boundary
+    const float extent = static_cast<float>(grid.grid_scale() / 2) - 1.0;
+    std::uniform_real_distribution<float> dist(-extent, extent);
+
+    // Keep points that are not inside terrain, give up after enough attempts
+    std::vector<min::vec3<float>> out;
+    out.reserve(count);
+    const size_t attempts = count * 100;
+    for (size_t i = 0; i < attempts && out.size() < count; i++)
+    {
+        const min::vec3<float> p(dist(gen), dist(gen), dist(gen));
+        const size_t key = grid.get_block_key(grid.get_grid_index_safe(p));
+        if (grid.get_block_id(key) == game::block_id::EMPTY)
+        {
+            out.push_back(p);
+        }
+    }
+
+    return out;
+}
+
+void bench_grid(bench_results &results, const game::options &opt, const size_t iterations)
+{
+    const size_t g = opt.grid();
+    const size_t c = opt.chunk();
+    const size_t scale = g * 2;
+
+    // Fixed seed so every run samples the same points
+    std::mt19937 gen(0);
+
+    // Benchmark terrain generation into a bare buffer
+    {
+        std::vector<game::block_id> cells(scale * scale * scale, game::block_id::EMPTY);
+        game::cgrid_generator generator(cells);
+        results.run("generate_normal", g, c, cells.size(), iterations, [&generator, &cells, scale, c](const size_t i) {
+            generator.generate_normal(cells, scale, c);
+        });
+    }
+
+    // Create the grid
+    game::cgrid grid(opt);
+    grid.new_game(opt);
+
+    // Benchmark portal generation, this also rebuilds every chunk mesh
+    results.run("generate_portal", g, c, grid.get_chunks(), iterations, [&grid](const size_t i) {
+        grid.portal();
+    });
+
+    // Use a normal world for the remaining benchmarks
+    grid.new_game(opt);
+
+    // Benchmark meshing the whole world
+    results.run("chunk_update", g, c, grid.get_chunks(), iterations, [&grid](const size_t i) {
+        grid.update_chunks();
+    });
+
+    // Benchmark encoding and decoding the world save in memory, the count is the save size in bytes
+    {
+        const size_t cubic = scale * scale * scale;
+        std::vector<game::block_id> load(cubic);
+        std::vector<uint8_t> raw;
+        results.run("world_save_raw", g, c, cubic + sizeof(uint32_t), iterations, [&grid, &raw, cubic](const size_t i) {
+            raw.clear();
+            raw.reserve(cubic + sizeof(uint32_t));
+            min::write_le_vector<game::block_id>(raw, grid.get_grid());
+        });
+        results.run("world_load_raw", g, c, raw.size(), iterations, [&raw, &load](const size_t i) {
+            size_t next = 0;
+            load = min::read_le_vector<game::block_id>(raw, next);
+        });
+
+        // Chunk records with and without the LZ pass
+        game::world_format format;
+        for (const bool compress : {false, true})
+        {
+            std::vector<uint8_t> stream;
+            format.encode(grid.get_grid(), scale, c, compress, 0, stream);
+            const std::string name = compress ? "lz" : "chunked";
+            results.run("world_save_" + name, g, c, stream.size(), iterations, [&grid, &format, &stream, scale, c, compress](const size_t i) {
+                format.encode(grid.get_grid(), scale, c, compress, 0, stream);
+            });
+            results.run("world_load_" + name, g, c, stream.size(), iterations, [&stream, &load, scale](const size_t i) {
+                game::world_format::decode(stream.data(), stream.size(), scale, load);
+            });
+            std::cerr << "bds_bench: world save " << name << " " << stream.size() << " bytes, raw " << raw.size() << " bytes" << std::endl;
+        }
+
+        // Load from disk by reading the file into a buffer against decoding from the mapped file
+        const std::string file_name = "bds_bench_world.tmp";
+        std::vector<uint8_t> stream;
+        format.encode(grid.get_grid(), scale, c, true, 0, stream);
+        for (const auto &f : {std::make_pair(std::string("raw"), &raw), std::make_pair(std::string("lz"), &stream)})
+        {
+            // Write with plain streams, the file helpers print to stdout
+            {
+                std::ofstream out(file_name, std::ios::out | std::ios::binary);
+                out.write(reinterpret_cast<const char *>(f.second->data()), f.second->size());
+            }
+            results.run("world_load_file_stream_" + f.first, g, c, f.second->size(), iterations, [&file_name, &load, scale](const size_t i) {
+                std::ifstream in(file_name, std::ios::in | std::ios::binary | std::ios::ate);
+                std::vector<uint8_t> buffer(static_cast<size_t>(in.tellg()));
+                in.seekg(0, std::ios::beg);
+                in.read(reinterpret_cast<char *>(buffer.data()), buffer.size());
+                if (game::world_format::is_format(buffer.data(), buffer.size()))
+                {
+                    game::world_format::decode(buffer.data(), buffer.size(), scale, load);
+                }
+                else
+                {
+                    game::world_format::decode_raw(buffer.data(), buffer.size(), scale, load);
+                }
+            });
+            results.run("world_load_file_mapped_" + f.first, g, c, f.second->size(), iterations, [&file_name, &load, scale](const size_t i) {
+                const game::mapped_file map(file_name);
+                if (game::world_format::is_format(map.data(), map.size()))
+                {
+                    game::world_format::decode(map.data(), map.size(), scale, load);
+                }
+                else
+                {
+                    game::world_format::decode_raw(map.data(), map.size(), scale, load);
+                }
+            });
+        }
+        std::remove(file_name.c_str());
+    }
+
+    // Benchmark path finding between nearby points like drones do
+    {
+        const size_t count = 100;
+        const std::vector<min::vec3<float>> start = bench_empty_points(grid, gen, count);
+        std::vector<min::vec3<float>> stop;
+        stop.reserve(start.size());
+        std::uniform_real_distribution<float> offset(-8.0, 8.0);
+        for (const auto &p : start)
+        {
+            stop.push_back(p + min::vec3<float>(offset(gen), offset(gen), offset(gen)));
+        }
+
+        std::vector<min::vec3<float>> path;
+        results.run("path", g, c, start.size(), iterations, [&grid, &start, &stop, &path](const size_t i) {
+            const size_t size = start.size();
+            for (size_t j = 0; j < size; j++)
+            {
+                grid.path(path, start[j], stop[j]);
+            }
+        });
+    }
+
+    // Benchmark ray tracing between random points
+    {
+        const size_t count = 10000;
+        const std::vector<min::vec3<float>> from = bench_empty_points(grid, gen, count);
+        const std::vector<min::vec3<float>> to = bench_empty_points(grid, gen, count);
+        const size_t size = std::min(from.size(), to.size());
+        std::vector<min::ray<float, min::vec3>> rays;
+        rays.reserve(size);
+        for (size_t i = 0; i < size; i++)
+        {
+            rays.emplace_back(from[i], to[i]);
+        }
+
+        results.run("ray_trace", g, c, rays.size(), iterations, [&grid, &rays](const size_t i) {
+            game::block_id value;
+            for (const auto &r : rays)
+            {
+                grid.ray_trace_last(r, 100, value);
+            }
+        });
+
+        // Same rays stepping every cell without empty chunk skipping
+        results.run("ray_trace_cells", g, c, rays.size(), iterations, [&grid, &rays](const size_t i) {
+            size_t prev_key, key;
+            game::block_id value;
+            for (const auto &r : rays)
+            {
+                grid.ray_trace_cells(r, 100, prev_key, key, value);
+            }
+        });
+    }
+
+    // Benchmark collision cell queries near terrain
+    {
+        const size_t count = 10000;
+        const std::vector<min::vec3<float>> points = bench_empty_points(grid, gen, count);
+        std::vector<std::pair<min::aabbox<float, min::vec3>, game::block_id>> cells;
+        cells.reserve(36);
+
+        results.run("collision_cells_drop", g, c, points.size(), iterations, [&grid, &points, &cells](const size_t i) {
+            for (const auto &p : points)
+            {
+                grid.drop_collision_cells(cells, p);
+            }
+        });
+        results.run("collision_cells_player", g, c, points.size(), iterations, [&grid, &points, &cells](const size_t i) {
+            for (const auto &p : points)
+            {
+                grid.player_collision_cells(cells, p);
+            }
+        });
+
+        // Same queries with the in place visitor
+        size_t solid = 0;
+        const auto count_cell = [&solid](const min::aabbox<float, min::vec3> &cell, const game::block_id atlas) {
+            solid++;
+            return true;
+        };
+        results.run("solid_cells_drop", g, c, points.size(), iterations, [&grid, &points, &count_cell](const size_t i) {
+            for (const auto &p : points)
+            {
+                grid.for_each_solid_cell(game::cgrid::drop_box(p), count_cell);
+            }
+        });
+        results.run("solid_cells_player", g, c, points.size(), iterations, [&grid, &points, &count_cell](const size_t i) {
+            for (const auto &p : points)
+            {
+                grid.for_each_solid_cell(game::cgrid::player_box(p), count_cell);
+            }
+        });
+    }
+}
+
+#endif
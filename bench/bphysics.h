@@ -0,0 +1,252 @@
+/* Copyright [2013-2018] [Aaron Springstroh, Minimal Graphics Library]
+
+This file is part of the Beyond Dying Skies.
+
+Beyond Dying Skies is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+Beyond Dying Skies is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with Beyond Dying Skies.  If not, see <http://www.gnu.org/licenses/>.
+*/
+#ifndef _BDS_BENCH_PHYSICS_BDS_
+#define _BDS_BENCH_PHYSICS_BDS_
+
+#include <algorithm>
+#include <bench.h>
+#include <bgrid.h>
+#include <game/cgrid.h>
+#include <game/def.h>
+#include <game/drone_bodies.h>
+#include <game/drop_bodies.h>
+#include <game/id.h>
+#include <game/options.h>
+#include <game/registry.h>
+#include <game/static_batch.h>
+#include <game/task_pool.h>
+#include <game/work_queue.h>
+#include <iostream>
+#include <memory>
+#include <min/tri.h>
+#include <min/vec3.h>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+
+void bench_physics_frame(bench_results &results, const std::string &name, const game::options &opt,
+                         game::cgrid &grid, const size_t drops, const size_t drones, const size_t iterations, game::task_pool *const pool)
+{
+    // Friction as world applies it at 60 frames per second
+    const size_t steps = game::_physics_frames / 60;
+    const float friction = -10.0 / steps;
+    const float drop_friction = friction * 2.0;
+
+    // Create the simulation
+    const min::vec3<float> gravity(0.0, -game::_grav_mag, 0.0);
+    game::physics sim(grid.get_world(), gravity);
+    sim.set_elasticity(game::_elasticity);
+
+    // The game drop and drone bodies, without instances or sounds
+    game::drop_bodies drop_group(sim, game::cgrid::drop_box(min::vec3<float>()), drops);
+    game::drone_bodies drone_group(sim, drones);
+    drop_group.set_pool(pool);
+
+    // Drones fly toward the world center like they chase the player, drops wake near it
+    const min::vec3<float> player;
+    drone_group.set_destination(player);
+
+    // Spawn bodies in empty space with a fixed seed, so both runs start from the same state
+    std::mt19937 gen(1);
+    const std::vector<min::vec3<float>> drop_points = bench_empty_points(grid, gen, drops);
+    for (const auto &p : drop_points)
+    {
+        drop_group.add(p, min::vec3<float>(), game::block_id::DIRT1);
+    }
+    const std::vector<min::vec3<float>> drone_points = bench_empty_points(grid, gen, drones);
+    for (const auto &p : drone_points)
+    {
+        drone_group.add(game::cgrid::drone_box(p), p, 0, 100.0);
+    }
+
+    // Stuck drones respawn at their first spawn point, explosions are left out of the numbers
+    const min::vec3<float> respawn = (drone_points.empty()) ? player : drone_points.front();
+    const auto respawn_call = [&respawn]() {
+        return respawn;
+    };
+    const auto drone_ex_call = [](const min::vec3<float> &, const min::tri<unsigned> &, const game::block_id) {};
+    const auto drop_ex_call = [](const min::vec3<float> &, const game::block_id) {};
+    const auto sleep_call = [](const size_t, const min::vec3<float> &) {};
+
+    // Benchmark one frame of physics at 60 frames per second, stepped like world::update_world_physics
+    const size_t count = drop_group.size() + drone_group.size();
+    results.run(name, opt.grid(), opt.chunk(), count, iterations, [&](const size_t i) {
+        for (size_t s = 0; s < steps; s++)
+        {
+            // Update drones and drops on this frame
+            drone_group.update_frame(grid, 1, 0, respawn_call, drone_ex_call);
+            drop_group.update_frame(grid, player, drop_friction, sleep_call, drop_ex_call);
+
+            // Solve all collisions
+            sim.solve(game::_time_step, game::_damping);
+        }
+    });
+}
+void bench_physics_threads(bench_results &results, const game::options &opt, game::cgrid &grid, const size_t drops, const size_t iterations)
+{
+    // Create the simulation
+    const min::vec3<float> gravity(0.0, -game::_grav_mag, 0.0);
+    game::physics sim(grid.get_world(), gravity);
+
+    // Spawn drops in empty space with a fixed seed
+    std::mt19937 gen(1);
+    std::vector<size_t> drop_bodies;
+    const std::vector<min::vec3<float>> drop_points = bench_empty_points(grid, gen, drops);
+    for (const auto &p : drop_points)
+    {
+        drop_bodies.push_back(sim.add_body(game::cgrid::drop_box(p), 10.0, game::id_value(game::static_id::DROP), drop_bodies.size()));
+    }
+
+    // Solve the same state without writing back so every run is comparable
+    game::static_batch batch;
+    batch.reserve(drop_bodies.size());
+    const auto solve = [&sim, &grid, &batch, &drop_bodies]() {
+        batch.clear();
+        const min::vec3<float> half = game::cgrid::drop_half_extent();
+        for (const size_t id : drop_bodies)
+        {
+            batch.gather(sim, id, half);
+        }
+        batch.solve(grid, game::_elasticity);
+    };
+
+    // Serial reference result
+    solve();
+    std::vector<min::vec3<float>> reference;
+    const size_t size = batch.size();
+    for (size_t i = 0; i < size; i++)
+    {
+        reference.push_back(batch.position(i));
+    }
+
+    // Scale from one thread to every hardware thread, the calling thread also works
+    const size_t hw = std::max(std::thread::hardware_concurrency(), 1u);
+    for (size_t n = 1; n <= hw; n++)
+    {
+        std::unique_ptr<game::task_pool> pool((n > 1) ? new game::task_pool(n - 1) : nullptr);
+        batch.set_pool(pool.get());
+        results.run("static_batch_threads_" + std::to_string(n), opt.grid(), opt.chunk(), drop_bodies.size(), iterations, [&solve](const size_t i) {
+            solve();
+        });
+
+        // Islands only move their own bodies so every thread count matches the serial result
+        for (size_t i = 0; i < size; i++)
+        {
+            const min::vec3<float> d = batch.position(i) - reference[i];
+            if (d.dot(d) != 0.0)
+            {
+                std::cerr << "bds_bench: static_batch_threads_" << n << " differs from serial at body " << i << std::endl;
+                break;
+            }
+        }
+        batch.set_pool(nullptr);
+    }
+}
+void bench_physics_remove(bench_results &results, const game::options &opt, game::cgrid &grid, const size_t iterations)
+{
+    // Create the simulation
+    const min::vec3<float> gravity(0.0, -game::_grav_mag, 0.0);
+    game::physics sim(grid.get_world(), gravity);
+
+    // Spawn many more drops than the game allows, the body data holds each drop handle
+    const size_t drops = 20000;
+    const size_t removed = 10000;
+    std::mt19937 gen(1);
+    game::registry<size_t> reg;
+    reg.reserve(drops);
+    const std::vector<min::vec3<float>> drop_points = bench_empty_points(grid, gen, drops);
+    for (const auto &p : drop_points)
+    {
+        const size_t body_id = sim.add_body(game::cgrid::drop_box(p), 10.0, game::id_value(game::static_id::DROP), 0);
+        sim.get_body(body_id).set_data(min::body_data(reg.add(body_id)));
+    }
+
+    // Remove half the drops in random order, like a big explosion collecting them
+    const size_t size = reg.size();
+    std::vector<size_t> order(size);
+    for (size_t i = 0; i < size; i++)
+    {
+        order[i] = reg[i];
+    }
+    std::shuffle(order.begin(), order.end(), gen);
+    order.resize(std::min(removed, size));
+    std::vector<bool> dead(*std::max_element(reg.begin(), reg.end()) + 1, false);
+    for (const size_t body_id : order)
+    {
+        dead[body_id] = true;
+    }
+
+    // Erase each drop and rewrite the body data of every later drop
+    std::vector<size_t> body_ids;
+    results.run("drop_remove_erase", opt.grid(), opt.chunk(), size, iterations, [&](const size_t i) {
+        body_ids.assign(reg.begin(), reg.end());
+        for (size_t j = 0; j < size; j++)
+        {
+            sim.get_body(body_ids[j]).set_data(min::body_data(j));
+        }
+        for (const size_t body_id : order)
+        {
+            const size_t index = sim.get_body(body_id).get_data().index;
+            body_ids.erase(body_ids.begin() + index);
+            const size_t remain = body_ids.size();
+            for (size_t j = index; j < remain; j++)
+            {
+                sim.get_body(body_ids[j]).set_data(min::body_data(j));
+            }
+        }
+    });
+
+    // Swap the last drop into each hole, handles never change
+    for (size_t j = 0; j < size; j++)
+    {
+        sim.get_body(reg[j]).set_data(min::body_data(reg.handle(j)));
+    }
+    game::registry<size_t> live;
+    results.run("drop_remove_swap", opt.grid(), opt.chunk(), size, iterations, [&](const size_t i) {
+        live = reg;
+        for (const size_t body_id : order)
+        {
+            live.remove(live.index(sim.get_body(body_id).get_data().index));
+        }
+    });
+
+    // Remove every dead drop in one pass
+    results.run("drop_remove_bulk", opt.grid(), opt.chunk(), size, iterations, [&](const size_t i) {
+        live = reg;
+        live.remove_if([&dead](const size_t body_id) { return dead[body_id]; }, [](const size_t, const size_t) {});
+    });
+}
+void bench_physics(bench_results &results, const game::options &opt, const size_t drops, const size_t drones, const size_t iterations)
+{
+    // Create the grid
+    game::cgrid grid(opt);
+    grid.new_game(opt);
+
+    // Compare the serial drop solver against the work queue, like '--parallel-physics'
+    bench_physics_frame(results, "physics_frame", opt, grid, drops, drones, iterations, nullptr);
+    bench_physics_frame(results, "physics_frame_parallel", opt, grid, drops, drones, iterations, &game::work_queue::worker);
+
+    // Scale the batched drop solver over thread counts
+    bench_physics_threads(results, opt, grid, drops, iterations);
+
+    // Compare drop removal strategies
+    bench_physics_remove(results, opt, grid, iterations);
+}
+
+#endif
@@ -146,6 +146,9 @@ void show_game(bds &game, min::loop_sync &sync, const size_t frames)
 
 void run(const game::options &opt)
 {
+    // Start recording the profiler trace
+    game::profiler::enable(opt.is_trace());
+
     // Load window shaders and program, enable shader program
     bds game(opt);
 
@@ -170,6 +173,12 @@ void run(const game::options &opt)
             // Run the game after the title screen
             show_game(game, sync, opt.frames());
 
+            // Dump the memory report at the end of each session
+            if (opt.is_mem_report())
+            {
+                game.print_memory();
+            }
+
             // If we are not closing the game
             if (!game.is_closed())
             {
@@ -177,11 +186,23 @@ void run(const game::options &opt)
                 game.title_screen_enable();
             }
         }
+
+        // Save the frame statistics on exit
+        if (opt.is_frame_stats())
+        {
+            game.save_frame_stats();
+        }
     }
     catch (const std::exception &ex)
     {
         game.error_message(ex.what());
     }
+
+    // Save the profiler trace on exit
+    if (opt.is_trace())
+    {
+        game::profiler::save_chrome_trace(game::file::get_trace_file());
+    }
 }
 
 bool parse_uint(char *str, size_t &out)
@@ -233,6 +254,26 @@ int main(int argc, char *argv[])
             {
                 opt.set_no_persist();
             }
+            else if (input.compare("--frame-graph") == 0)
+            {
+                opt.set_frame_graph();
+            }
+            else if (input.compare("--frame-stats") == 0)
+            {
+                opt.set_frame_stats();
+            }
+            else if (input.compare("--trace") == 0)
+            {
+                opt.set_trace();
+            }
+            else if (input.compare("--mem-report") == 0)
+            {
+                opt.set_mem_report();
+            }
+            else if (input.compare("--parallel-physics") == 0)
+            {
+                opt.set_parallel_physics();
+            }
             else if (i < (argc - 1))
             {
                 if (input.compare("-fps") == 0)
@@ -37,12 +37,11 @@ class block_adder
         if (!on_edge_py)
         {
             const auto above = min::tri<size_t>(index.x(), index.y() + 1, index.z());
-            const size_t above_key = grid.get_block_key(above);
 
             // Only set if empty
-            if (grid.get_block_id(above_key) == block_id::EMPTY)
+            if (!grid.is_solid(above))
             {
-                grid.set_block_id(above_key, atlas);
+                grid.set_block_id(grid.get_block_key(above), atlas);
             }
         }
     }
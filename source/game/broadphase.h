@@ -0,0 +1,228 @@
+/* Copyright [2013-2018] [Aaron Springstroh, Minimal Graphics Library]
+
+This file is part of the Beyond Dying Skies.
+
+Beyond Dying Skies is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+Beyond Dying Skies is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with Beyond Dying Skies.  If not, see <http://www.gnu.org/licenses/>.
+*/
+#ifndef _BDS_BROADPHASE_BDS_
+#define _BDS_BROADPHASE_BDS_
+
+#include <algorithm>
+#include <cstdint>
+#include <game/memory_report.h>
+#include <vector>
+
+namespace game
+{
+
+// Uniform hash of grid chunks holding the ids whose center is inside each chunk
+class broadphase
+{
+  private:
+    static constexpr size_t _none = static_cast<size_t>(-1);
+
+    // Open addressed cells, an emptied cell keeps its key until the table is rebuilt
+    size_t _mask;
+    size_t _used;
+    std::vector<size_t> _key;
+    std::vector<std::vector<uint_fast16_t>> _items;
+    std::vector<size_t> _cells;
+    std::vector<size_t> _cell_at;
+
+    // Cell and item position of each id
+    std::vector<size_t> _id_key;
+    std::vector<size_t> _id_slot;
+    std::vector<size_t> _id_at;
+    size_t _moves;
+
+    static inline size_t table_size(const size_t ids)
+    {
+        // Power of two with room for every id in its own cell at half load
+        size_t size = 16;
+        while (size < ids * 4)
+        {
+            size <<= 1;
+        }
+
+        return size;
+    }
+    inline size_t find(const size_t key) const
+    {
+        // Linear probe from the hashed chunk key until the key or an unused slot
+        size_t slot = (key * 2654435761u) & _mask;
+        while (_key[slot] != key && _key[slot] != _none)
+        {
+            slot = (slot + 1) & _mask;
+        }
+
+        return slot;
+    }
+    inline void link(const uint_fast16_t id, const size_t key)
+    {
+        // Drop emptied cells if the table is getting full
+        if ((_used + 1) * 2 > _key.size())
+        {
+            rebuild();
+        }
+
+        // Claim the slot for this chunk
+        const size_t slot = find(key);
+        if (_key[slot] == _none)
+        {
+            _key[slot] = key;
+            _used++;
+        }
+
+        // First item marks the cell as occupied
+        std::vector<uint_fast16_t> &items = _items[slot];
+        if (items.empty())
+        {
+            _cell_at[slot] = _cells.size();
+            _cells.push_back(slot);
+        }
+
+        // Append the id to the cell
+        _id_key[id] = key;
+        _id_slot[id] = slot;
+        _id_at[id] = items.size();
+        items.push_back(id);
+    }
+    inline void unlink(const uint_fast16_t id)
+    {
+        // Swap the last item of the cell into this position
+        const size_t slot = _id_slot[id];
+        std::vector<uint_fast16_t> &items = _items[slot];
+        const uint_fast16_t last = items.back();
+        items[_id_at[id]] = last;
+        _id_at[last] = _id_at[id];
+        items.pop_back();
+
+        // Remove the cell from the occupied list if empty
+        if (items.empty())
+        {
+            const size_t at = _cell_at[slot];
+            const size_t back = _cells.back();
+            _cells[at] = back;
+            _cell_at[back] = at;
+            _cells.pop_back();
+            _cell_at[slot] = _none;
+        }
+
+        // Forget the cell of this id
+        _id_key[id] = _none;
+        _id_slot[id] = _none;
+    }
+    inline void rebuild()
+    {
+        // Collect the ids still in a cell
+        std::vector<size_t> keys(_id_key);
+
+        // Reset the table
+        const size_t none = _none;
+        std::fill(_key.begin(), _key.end(), none);
+        std::fill(_cell_at.begin(), _cell_at.end(), none);
+        for (auto &items : _items)
+        {
+            items.clear();
+        }
+        _cells.clear();
+        _used = 0;
+
+        // Insert the live ids again, emptied cells are gone so this never rebuilds
+        const size_t size = keys.size();
+        for (size_t i = 0; i < size; i++)
+        {
+            _id_key[i] = _id_slot[i] = _none;
+            if (keys[i] != _none)
+            {
+                link(static_cast<uint_fast16_t>(i), keys[i]);
+            }
+        }
+    }
+
+  public:
+    broadphase(const size_t ids)
+        : _mask(table_size(ids) - 1), _used(0),
+          _key(table_size(ids), static_cast<size_t>(_none)), _items(table_size(ids)),
+          _cell_at(table_size(ids), static_cast<size_t>(_none)),
+          _id_key(ids, static_cast<size_t>(_none)), _id_slot(ids, static_cast<size_t>(_none)), _id_at(ids, 0), _moves(0)
+    {
+        _cells.reserve(ids);
+    }
+
+    inline size_t cells() const
+    {
+        return _cells.size();
+    }
+    template <typename F>
+    inline void for_each_cell(const F &f) const
+    {
+        // Visit occupied cells, every id is in exactly one cell
+        for (const size_t slot : _cells)
+        {
+            f(_key[slot], _items[slot]);
+        }
+    }
+    inline size_t memory_reserved() const
+    {
+        size_t items = 0;
+        for (const auto &i : _items)
+        {
+            items += memory_report::reserved(i);
+        }
+
+        return items + memory_report::reserved(_key) + memory_report::reserved(_cells) + memory_report::reserved(_cell_at) + memory_report::reserved(_id_key) + memory_report::reserved(_id_slot) + memory_report::reserved(_id_at);
+    }
+    inline size_t memory_resident() const
+    {
+        size_t items = 0;
+        for (const auto &i : _items)
+        {
+            items += memory_report::bytes(i);
+        }
+
+        return items + memory_report::bytes(_key) + memory_report::bytes(_cells) + memory_report::bytes(_cell_at) + memory_report::bytes(_id_key) + memory_report::bytes(_id_slot) + memory_report::bytes(_id_at);
+    }
+    inline size_t moves() const
+    {
+        return _moves;
+    }
+    inline void remove(const uint_fast16_t id)
+    {
+        if (_id_key[id] != _none)
+        {
+            unlink(id);
+        }
+    }
+    inline void reset_moves()
+    {
+        _moves = 0;
+    }
+    inline void update(const uint_fast16_t id, const size_t key)
+    {
+        // Only touch the table when the id changed chunk
+        if (_id_key[id] != key)
+        {
+            if (_id_key[id] != _none)
+            {
+                unlink(id);
+            }
+            link(id, key);
+            _moves++;
+        }
+    }
+};
+}
+
+#endif
@@ -18,23 +18,34 @@ along with Beyond Dying Skies.  If not, see <http://www.gnu.org/licenses/>.
 #ifndef _BDS_CHUNK_GRID_BDS_
 #define _BDS_CHUNK_GRID_BDS_
 
+#include <algorithm>
 #include <chrono>
+#include <cstdint>
 #include <game/cgrid_generator.h>
 #include <game/def.h>
+#include <game/edit_journal.h>
 #include <game/file.h>
+#include <game/frustum_cull.h>
 #include <game/id.h>
+#include <game/mapped_file.h>
+#include <game/memory_report.h>
 #include <game/options.h>
+#include <game/profiler.h>
+#include <game/save_writer.h>
 #include <game/swatch.h>
 #include <game/terrain_mesher.h>
+#include <game/world_format.h>
 #include <min/aabbox.h>
 #include <min/camera.h>
-#include <min/intersect.h>
 #include <min/mesh.h>
 #include <min/ray.h>
 #include <min/serial.h>
 #include <min/sort.h>
 #include <min/tri.h>
+#include <random>
 #include <stdexcept>
+#include <string>
+#include <utility>
 
 namespace game
 {
@@ -69,6 +80,25 @@ class view_chunk
     }
 };
 
+class ray_lane
+{
+    friend class cgrid;
+
+  private:
+    // 3D DDA state per axis
+    size_t _c[3];
+    unsigned _k[3];
+    float _t0[3];
+    float _delta[3];
+    int _step[3];
+
+    // Progress along the ray
+    size_t _count;
+    size_t _held;
+    size_t _prev;
+    size_t _key;
+};
+
 class cgrid
 {
   private:
@@ -82,11 +112,21 @@ class cgrid
     const size_t _chunk_size;
     const size_t _chunk_cells;
     const size_t _chunk_scale;
+    const size_t _chunk_words;
+    std::vector<uint64_t> _solid;
+    std::vector<size_t> _solid_x;
+    std::vector<size_t> _solid_y;
+    std::vector<size_t> _solid_z;
+    std::vector<uint32_t> _chunk_solid;
+    std::vector<size_t> _cell_chunk;
+    std::vector<size_t> _cell_local;
     std::vector<min::mesh<float, uint32_t>> _chunks;
     std::vector<bool> _chunk_update;
     std::vector<size_t> _chunk_update_keys;
     std::vector<size_t> _sort_chunk;
     std::vector<view_chunk> _view_chunks;
+    frustum_cull _view_cull;
+    std::vector<min::vec3<float>> _view_start;
     size_t _recent_chunk;
     min::vec3<float> _recent_p;
     const size_t _view_chunk_size;
@@ -96,6 +136,11 @@ class cgrid
     const min::vec3<float> _cell_extent;
     cgrid_generator _generator;
     terrain_mesher _mesher;
+    save_writer _saver;
+    edit_journal _journal;
+    uint32_t _base;
+    bool _full_save;
+    bool _rebase;
 
     static inline bool in_x(const min::vec3<float> &p, const min::vec3<float> &min, const min::vec3<float> &max)
     {
@@ -133,29 +178,20 @@ class cgrid
         // Return world size
         return min::aabbox<float, min::vec3>(minv, maxv);
     }
+    inline size_t cell_index(const float p, const float min) const
+    {
+        // Floor to the cell and clamp to the grid
+        const float cell = std::floor(p - min);
+        return (cell <= 0.0) ? 0 : std::min(static_cast<size_t>(cell), _grid_scale - 1);
+    }
     inline void collision_cells(std::vector<std::pair<min::aabbox<float, min::vec3>, block_id>> &out,
-                                const min::aabbox<float, min::vec3> &box, const min::vec3<float> &center) const
+                                const min::aabbox<float, min::vec3> &box) const
     {
-        // Get all overlapping cells
-        const auto overlap = min::vec3<float>::grid_overlap(_world.get_min(), _cell_extent, _grid_scale, box.get_min(), box.get_max());
-
-        // Create boxes of all overlapping cells
-        const size_t size = overlap.size();
-        for (size_t i = 0; i < size; i++)
-        {
-            // Get the cell key
-            const size_t key = overlap[i];
-
-            // Check if valid and if the cell is not empty
-            if (_grid[key] != block_id::EMPTY)
-            {
-                // Create box at this point
-                const min::aabbox<float, min::vec3> grid = grid_box(grid_cell_center(key));
-
-                // Add box and grid value to
-                out.emplace_back(grid, _grid[key]);
-            }
-        }
+        // Create boxes of all overlapping solid cells
+        for_each_solid_cell(box, [&out](const min::aabbox<float, min::vec3> &cell, const block_id atlas) {
+            out.emplace_back(cell, atlas);
+            return true;
+        });
     }
     template <typename F>
     inline void cubic(const min::vec3<float> &start, const min::tri<unsigned> &length, const min::tri<int> &offset, const F &f) const
@@ -349,6 +385,9 @@ class cgrid
     }
     inline void chunk_update(const size_t chunk_key)
     {
+        const profile_scope scope("cgrid::chunk_update");
+        const memory_scope mem(mem_tag::MESH);
+
         // Clear the mesh and mesher
         _chunks[chunk_key].clear();
         _mesher.clear();
@@ -362,36 +401,38 @@ class cgrid
 
         // Get the grid axis components
         const auto index = grid_key_unpack(start);
-        const size_t xend = std::min(index.x() + _chunk_size, _grid_scale);
-        const size_t yend = std::min(index.y() + _chunk_size, _grid_scale);
-        const size_t zend = std::min(index.z() + _chunk_size, _grid_scale);
 
         // Function to retrieve block value
         const auto get_block = [this](const min::tri<size_t> &index) -> block_id {
             return _grid[this->grid_key_pack(index)];
         };
 
-        // Iterate through the chunk
-        for (size_t tx = index.x(); tx < xend; tx++)
+        // Visit solid cells of the chunk, skipping 64 empty cells per word
+        const size_t cs2 = _chunk_size * _chunk_size;
+        const size_t begin = chunk_key * _chunk_words;
+        for (size_t w = 0; w < _chunk_words; w++)
         {
-            for (size_t ty = index.y(); ty < yend; ty++)
+            uint64_t bits = _solid[begin + w];
+            while (bits != 0)
             {
-                for (size_t tz = index.z(); tz < zend; tz++)
-                {
-                    // Get the cell index
-                    const auto index = min::tri<size_t>(tx, ty, tz);
+                // Pop the lowest set bit, bits are in x, y, z order
+                const size_t local = w * 64 + solid_ctz(bits);
+                bits &= bits - 1;
 
-                    // Get the current cell index value
-                    const block_id atlas = get_block(index);
-                    if (atlas != block_id::EMPTY)
-                    {
-                        // Get the cell center point
-                        const min::vec3<float> p = grid_cell_center(index);
+                // Get the cell index
+                const size_t tx = index.x() + local / cs2;
+                const size_t ty = index.y() + (local / _chunk_size) % _chunk_size;
+                const size_t tz = index.z() + local % _chunk_size;
+                const auto index = min::tri<size_t>(tx, ty, tz);
 
-                        // Generate cell faces
-                        _mesher.generate_chunk_faces(p, index, edges, get_block, static_cast<float>(atlas));
-                    }
-                }
+                // Get the current cell index value
+                const block_id atlas = get_block(index);
+
+                // Get the cell center point
+                const min::vec3<float> p = grid_cell_center(index);
+
+                // Generate cell faces
+                _mesher.generate_chunk_faces(p, index, edges, get_block, static_cast<float>(atlas));
             }
         }
 
@@ -507,14 +548,20 @@ class cgrid
         const size_t ckey = chunk_key_unsafe(p);
         _chunk_update_keys.push_back(ckey);
 
-        // Set the cell with value
+        // Preserve the chunk for a save in flight, then set the cell with value and journal the edit
+        _saver.before_write(key);
         _grid[key] = value;
+        solid_set(grid_key_unpack(key), value != block_id::EMPTY);
+        _journal.append(key, value);
 
         // Return position
         return p;
     }
     inline void generate_portal()
     {
+        // A save in flight still reads the old world
+        _saver.wait();
+
         // Function for finding grid key index
         const auto f = [this](const min::tri<size_t> &index) -> size_t {
             return grid_key_pack(index);
@@ -527,9 +574,17 @@ class cgrid
 
         // Generate the cgrid data
         _generator.generate_portal(_grid, _grid_scale, _chunk_size, f, g);
+        solid_rebuild();
+
+        // The journal can't describe a new world
+        _journal.discard();
+        _full_save = true;
     }
     inline void generate_world(const options &opt)
     {
+        // A save in flight still reads the old world
+        _saver.wait();
+
         const game_type gt = opt.get_game_mode();
         if (gt == game_type::CREATIVE)
         {
@@ -539,6 +594,13 @@ class cgrid
         {
             _generator.generate_normal(_grid, _grid_scale, _chunk_size);
         }
+
+        // Rebuild the solid bitmap from the new cells
+        solid_rebuild();
+
+        // The journal can't describe a new world
+        _journal.discard();
+        _full_save = true;
     }
     inline float grid_center_square_dist(const size_t key, const min::vec3<float> &point) const
     {
@@ -548,6 +610,12 @@ class cgrid
         // Calculate the square distance to this point
         return dv.dot(dv);
     }
+    inline bool is_solid(const size_t i, const size_t j, const size_t k) const
+    {
+        // One bit per cell, grouped by chunk
+        const size_t b = _solid_x[i] + _solid_y[j] + _solid_z[k];
+        return (_solid[b >> 6] >> (b & 63)) & 1;
+    }
     inline bool inside(const min::vec3<float> &p) const
     {
         const min::vec3<float> &min = _world.get_min();
@@ -555,37 +623,199 @@ class cgrid
 
         return in_x(p, min, max) && in_y(p, min, max) && in_z(p, min, max);
     }
-    inline bool ray_trace(const min::ray<float, min::vec3> &r, const size_t length, size_t &prev_key, size_t &key, block_id &value) const
+    static inline float ray_time(const float t0, const unsigned k, const float delta)
     {
-        // Calculate the ray trajectory for tracing in grid
-        auto grid_ray = min::vec3<float>::grid_ray(_world.get_min(), _cell_extent, r.get_origin(), r.get_direction(), r.get_inverse());
+        // Time the ray crosses its k-th boundary on an axis
+        return t0 + k * delta;
+    }
+    static inline size_t ray_axis(const float *const t)
+    {
+        // Axis that crosses first, ties go to the lower axis
+        return (t[0] <= t[1]) ? ((t[0] <= t[2]) ? 0 : 2) : ((t[1] <= t[2]) ? 1 : 2);
+    }
+    inline bool ray_begin(const min::ray<float, min::vec3> &r, ray_lane &s) const
+    {
+        // Find the starting cell, rays outside the grid never step
+        bool is_valid = true;
+        s._prev = s._key = grid_key_safe(r.get_origin(), is_valid);
+        s._count = 0;
+        s._held = _chunk_solid.size();
+        if (!is_valid)
+        {
+            return false;
+        }
 
-        // Calculate start point in grid index format
-        auto index = min::vec3<float>::grid_index(_world.get_min(), _cell_extent, r.get_origin());
+        // Setup a 3D DDA, the crossing times are recomputed from the step count so jumps match single steps
+        const float never = 1E30;
+        const min::vec3<float> &wmin = _world.get_min();
+        const min::vec3<float> &o = r.get_origin();
+        const min::vec3<float> &d = r.get_direction();
+        const min::tri<size_t> index = grid_key_unpack(s._key);
+        const float po[3] = {o.x() - wmin.x(), o.y() - wmin.y(), o.z() - wmin.z()};
+        const float dv[3] = {d.x(), d.y(), d.z()};
+        const size_t c[3] = {index.x(), index.y(), index.z()};
+        for (size_t a = 0; a < 3; a++)
+        {
+            s._c[a] = c[a];
+            s._k[a] = 0;
+            if (dv[a] > 0.0)
+            {
+                s._step[a] = 1;
+                s._delta[a] = 1.0 / dv[a];
+                s._t0[a] = (c[a] + 1 - po[a]) * s._delta[a];
+            }
+            else if (dv[a] < 0.0)
+            {
+                s._step[a] = -1;
+                s._delta[a] = -1.0 / dv[a];
+                s._t0[a] = (po[a] - c[a]) * s._delta[a];
+            }
+            else
+            {
+                s._step[a] = 0;
+                s._delta[a] = 0.0;
+                s._t0[a] = never;
+            }
+        }
 
-        // Trace a ray from origin and stop at first populated cell
-        bool is_valid = true;
-        prev_key = key = grid_key_safe(r.get_origin(), is_valid);
-        if (is_valid)
+        return true;
+    }
+    inline bool ray_jump(ray_lane &s, const size_t chunk, const size_t length) const
+    {
+        // Steps left on each axis before leaving the chunk and the time of the last one
+        const float never = 1E30;
+        unsigned n[3];
+        float te[3];
+        for (size_t a = 0; a < 3; a++)
         {
-            // bad flag signals that we have hit the last valid cell
-            bool bad_flag = false;
-            unsigned count = 0;
-            while (_grid[key] == block_id::EMPTY && !bad_flag && count < length)
+            const unsigned local = _cell_local[s._c[a]];
+            n[a] = (s._step[a] > 0) ? _chunk_size - local : ((s._step[a] < 0) ? local + 1 : 0);
+            te[a] = (s._step[a] != 0) ? ray_time(s._t0[a], s._k[a] + n[a] - 1, s._delta[a]) : never;
+        }
+
+        // The first axis to leave ends the jump, count the other axis steps before it
+        const size_t e = ray_axis(te);
+        unsigned m[3] = {0, 0, 0};
+        size_t total = 0;
+        for (size_t a = 0; a < 3; a++)
+        {
+            if (a == e)
             {
-                // Update the previous key
-                prev_key = key;
+                m[a] = n[a];
+            }
+            else if (s._step[a] != 0)
+            {
+                // Steps taken before the exit crossing, ties go to the lower axis
+                const auto before = [&s, &te, a, e](const unsigned j) -> bool {
+                    const float t = ray_time(s._t0[a], s._k[a] + j, s._delta[a]);
+                    return t < te[e] || (a < e && t == te[e]);
+                };
+
+                // Estimate the count then correct it so it matches single steps exactly
+                const float f = (te[e] - s._t0[a]) / s._delta[a] - s._k[a];
+                m[a] = (f > 0.0) ? std::min(static_cast<unsigned>(f), n[a]) : 0;
+                while (m[a] < n[a] && before(m[a]))
+                {
+                    m[a]++;
+                }
+                while (m[a] > 0 && !before(m[a] - 1))
+                {
+                    m[a]--;
+                }
+            }
+            total += m[a];
+        }
 
-                // Increment the current key
-                key = min::vec3<float>::grid_ray_next(index, grid_ray, bad_flag, _grid_scale);
-                count++;
+        // Only jump if the exit cell is in the world and within the length
+        const bool in = (s._step[e] > 0) ? (s._c[e] + n[e] < _grid_scale) : (s._c[e] >= n[e]);
+        if (!in || total == 0 || s._count + total > length)
+        {
+            // Step through the rest of this chunk
+            s._held = chunk;
+            return false;
+        }
+
+        // Move to the exit cell
+        for (size_t a = 0; a < 3; a++)
+        {
+            s._c[a] = (s._step[a] > 0) ? s._c[a] + m[a] : s._c[a] - m[a];
+            s._k[a] += m[a];
+        }
+
+        // The exit step is the last step taken
+        size_t p[3] = {s._c[0], s._c[1], s._c[2]};
+        p[e] = (s._step[e] > 0) ? p[e] - 1 : p[e] + 1;
+        s._prev = grid_key_pack(min::tri<size_t>(p[0], p[1], p[2]));
+        s._key = grid_key_pack(min::tri<size_t>(s._c[0], s._c[1], s._c[2]));
+        s._count += total;
+
+        return true;
+    }
+    template <bool Skip>
+    inline bool ray_advance(ray_lane &s, const size_t length) const
+    {
+        // Walk cells until a solid cell, the world edge or the length limit, with skipping also stop on leaving the chunk
+        const size_t none = _chunk_solid.size();
+        const size_t start = (Skip) ? solid_chunk(s._c[0], s._c[1], s._c[2]) : none;
+        while (s._count < length && !is_solid(s._c[0], s._c[1], s._c[2]))
+        {
+            // Jump over chunks without solid cells, unless a jump out of this chunk already failed
+            const size_t chunk = (Skip) ? solid_chunk(s._c[0], s._c[1], s._c[2]) : none;
+            if (Skip && chunk != start)
+            {
+                return true;
+            }
+            else if (Skip && chunk != s._held && _chunk_solid[chunk] == 0 && ray_jump(s, chunk, length))
+            {
+                return true;
             }
 
-            // return the stopping cell value
-            value = _grid[key];
+            // Update the previous key
+            s._prev = s._key;
+            s._count++;
+
+            // Step along the axis that crosses first, stop on the last valid cell
+            const float t[3] = {ray_time(s._t0[0], s._k[0], s._delta[0]), ray_time(s._t0[1], s._k[1], s._delta[1]), ray_time(s._t0[2], s._k[2], s._delta[2])};
+            const size_t a = ray_axis(t);
+            const size_t next = (s._step[a] >= 0) ? s._c[a] + s._step[a] : s._c[a] - 1;
+            if (s._step[a] == 0 || next >= _grid_scale)
+            {
+                break;
+            }
+            s._c[a] = next;
+            s._k[a]++;
+
+            // Increment the current key
+            s._key = grid_key_pack(min::tri<size_t>(s._c[0], s._c[1], s._c[2]));
         }
 
-        return is_valid;
+        return false;
+    }
+    template <bool Skip>
+    inline bool ray_march(const min::ray<float, min::vec3> &r, const size_t length, size_t &prev_key, size_t &key, block_id &value) const
+    {
+        // Trace a ray from origin and stop at first populated cell
+        ray_lane s;
+        if (!ray_begin(r, s))
+        {
+            return false;
+        }
+
+        // Walk one chunk at a time
+        while (ray_advance<Skip>(s, length))
+        {
+        }
+        prev_key = s._prev;
+        key = s._key;
+
+        // return the stopping cell value
+        value = _grid[key];
+
+        return true;
+    }
+    inline bool ray_trace(const min::ray<float, min::vec3> &r, const size_t length, size_t &prev_key, size_t &key, block_id &value) const
+    {
+        return ray_march<true>(r, length, prev_key, key, value);
     }
     inline void reserve_memory()
     {
@@ -594,9 +824,18 @@ class cgrid
         _stack.reserve(100);
         _sort_chunk.reserve(27);
         _view_chunks.reserve(27);
+
+        // Every chunk in the view cube is tested each frame
+        const size_t view = _view_chunk_size * _view_chunk_size * _view_chunk_size;
+        _view_cull.reserve(view);
+        _view_start.reserve(view);
     }
     inline void reset()
     {
+        // Let a save in flight finish with the old world
+        _saver.wait();
+        _rebase = false;
+
         // Clear out all vectors
         _neighbors.clear();
         _path.clear();
@@ -604,6 +843,63 @@ class cgrid
         _chunk_update_keys.clear();
         _sort_chunk.clear();
         _view_chunks.clear();
+        _view_cull.clear();
+        _view_start.clear();
+    }
+    static inline size_t solid_ctz(const uint64_t bits)
+    {
+#if defined(__GNUC__)
+        return __builtin_ctzll(bits);
+#else
+        size_t out = 0;
+        for (uint64_t b = bits; (b & 1) == 0; b >>= 1)
+        {
+            out++;
+        }
+        return out;
+#endif
+    }
+    inline void solid_rebuild()
+    {
+        const profile_scope scope("cgrid::solid_rebuild");
+
+        // Clear every chunk bitmap and solid count
+        std::fill(_solid.begin(), _solid.end(), 0);
+        std::fill(_chunk_solid.begin(), _chunk_solid.end(), 0);
+
+        // Set a bit for each solid cell
+        for (size_t i = 0; i < _grid_scale; i++)
+        {
+            for (size_t j = 0; j < _grid_scale; j++)
+            {
+                for (size_t k = 0; k < _grid_scale; k++)
+                {
+                    if (_grid[grid_key_pack(min::tri<size_t>(i, j, k))] != block_id::EMPTY)
+                    {
+                        const size_t b = _solid_x[i] + _solid_y[j] + _solid_z[k];
+                        _solid[b >> 6] |= static_cast<uint64_t>(1) << (b & 63);
+                        _chunk_solid[solid_chunk(i, j, k)]++;
+                    }
+                }
+            }
+        }
+    }
+    inline size_t solid_chunk(const size_t i, const size_t j, const size_t k) const
+    {
+        return (_cell_chunk[i] * _chunk_scale + _cell_chunk[j]) * _chunk_scale + _cell_chunk[k];
+    }
+    inline void solid_set(const min::tri<size_t> &index, const bool solid)
+    {
+        // Keep the bitmap and the chunk solid count in sync with the cell
+        const size_t b = _solid_x[index.x()] + _solid_y[index.y()] + _solid_z[index.z()];
+        const uint64_t mask = static_cast<uint64_t>(1) << (b & 63);
+        const bool was = (_solid[b >> 6] & mask) != 0;
+        if (solid != was)
+        {
+            _solid[b >> 6] ^= mask;
+            uint32_t &count = _chunk_solid[solid_chunk(index.x(), index.y(), index.z())];
+            count = (solid) ? count + 1 : count - 1;
+        }
     }
     inline void search(const min::vec3<float> &start, const min::vec3<float> &stop)
     {
@@ -666,44 +962,44 @@ class cgrid
         const size_t y = index.y();
         const size_t z = index.z();
 
-        // Check against lower x grid dimensions
+        // Walls are never neighbors, check against lower x grid dimensions
         const size_t edge = _grid_scale - 1;
-        if (x != 0)
+        if (x != 0 && !is_solid(x - 1, y, z))
         {
             const size_t nxk = min::vec3<float>::grid_key(min::tri<size_t>(x - 1, y, z), _grid_scale);
             _neighbors.push_back({nxk, grid_center_square_dist(nxk, stop)});
         }
 
         // Check against upper x grid dimensions
-        if (x != edge)
+        if (x != edge && !is_solid(x + 1, y, z))
         {
             const size_t pxk = min::vec3<float>::grid_key(min::tri<size_t>(x + 1, y, z), _grid_scale);
             _neighbors.push_back({pxk, grid_center_square_dist(pxk, stop)});
         }
 
         // Check against lower y grid dimensions
-        if (y != 0)
+        if (y != 0 && !is_solid(x, y - 1, z))
         {
             const size_t nyk = min::vec3<float>::grid_key(min::tri<size_t>(x, y - 1, z), _grid_scale);
             _neighbors.push_back({nyk, grid_center_square_dist(nyk, stop)});
         }
 
         // Check against upper y grid dimensions
-        if (y != edge)
+        if (y != edge && !is_solid(x, y + 1, z))
         {
             const size_t pyk = min::vec3<float>::grid_key(min::tri<size_t>(x, y + 1, z), _grid_scale);
             _neighbors.push_back({pyk, grid_center_square_dist(pyk, stop)});
         }
 
         // Check against lower z grid dimensions
-        if (z != 0)
+        if (z != 0 && !is_solid(x, y, z - 1))
         {
             const size_t nzk = min::vec3<float>::grid_key(min::tri<size_t>(x, y, z - 1), _grid_scale);
             _neighbors.push_back({nzk, grid_center_square_dist(nzk, stop)});
         }
 
         // Check against upper z grid dimensions
-        if (z != edge)
+        if (z != edge && !is_solid(x, y, z + 1))
         {
             const size_t pzk = min::vec3<float>::grid_key(min::tri<size_t>(x, y, z + 1), _grid_scale);
             _neighbors.push_back({pzk, grid_center_square_dist(pzk, stop)});
@@ -755,7 +1051,7 @@ class cgrid
             for (const auto &n : _neighbors)
             {
                 // If we haven't visited the neighbor cell, and it isn't a wall
-                if (_visit[n.first] == -1 && _grid[n.first] == block_id::EMPTY)
+                if (_visit[n.first] == -1)
                 {
                     // Flag that we pushed this key to prevent duplicates on stack
                     _visit[n.first] = 1;
@@ -779,6 +1075,8 @@ class cgrid
     }
     inline void world_create(const options &opt)
     {
+        const memory_scope mem(mem_tag::GRID);
+
         // Else generate world
         generate_world(opt);
 
@@ -792,29 +1090,44 @@ class cgrid
     }
     inline void world_load(const options &opt)
     {
-        // Create output stream for loading world
-        std::vector<uint8_t> stream;
+        const memory_scope mem(mem_tag::GRID);
 
-        // Load data into stream from file
-        file::load_file(file::get_world_file(opt.get_save_slot()), stream);
+        // Map the file and decode straight into the grid, no copy of the file or grid is made
+        const mapped_file map(file::get_world_file(opt.get_save_slot()));
 
         // If load failed dont try to parse stream data
-        if (stream.size() != 0)
+        if (map.size() != 0)
         {
-            // Load grid with file
-            size_t next = 0;
-            const std::vector<block_id> grid = min::read_le_vector<block_id>(stream, next);
+            // Chunk records or the raw format of older saves, fails if the grid is the wrong dimensions
+            bool loaded = false;
+            if (world_format::is_format(map.data(), map.size()))
+            {
+                loaded = world_format::decode(map.data(), map.size(), _grid_scale, _grid);
+            }
+            else
+            {
+                loaded = world_format::decode_raw(map.data(), map.size(), _grid_scale, _grid);
+            }
 
-            // Check that grid load correctly
-            const size_t cubic_size = _grid_scale * _grid_scale * _grid_scale;
-            if (grid.size() == cubic_size)
+            if (loaded)
             {
-                // Copy grid from file
-                _grid = grid;
+                // Replay the edits saved since the base world was written
+                _base = world_format::base(map.data(), map.size());
+                const size_t cells = _grid.size();
+                const bool clean = _journal.replay(file::get_journal_file(opt.get_save_slot()), _grid_scale, _base, [this, cells](const size_t key, const block_id value) {
+                    if (key < cells)
+                    {
+                        _grid[key] = value;
+                    }
+                });
+
+                // A torn or stale journal can't be appended to, so the next save rewrites the world
+                _full_save = !clean;
+                solid_rebuild();
             }
             else
             {
-                // Grid is wrong dimensions so regenerate world
+                // Grid is wrong dimensions or the file is malformed so regenerate world
                 generate_world(opt);
             }
         }
@@ -844,6 +1157,11 @@ class cgrid
           _chunk_size(opt.chunk()),
           _chunk_cells(_chunk_size * _chunk_size * _chunk_size),
           _chunk_scale(_grid_scale / _chunk_size),
+          _chunk_words((_chunk_cells + 63) / 64),
+          _solid(_chunk_scale * _chunk_scale * _chunk_scale * _chunk_words, 0),
+          _solid_x(_grid_scale), _solid_y(_grid_scale), _solid_z(_grid_scale),
+          _chunk_solid(_chunk_scale * _chunk_scale * _chunk_scale, 0),
+          _cell_chunk(_grid_scale), _cell_local(_grid_scale),
           _chunks(_chunk_scale * _chunk_scale * _chunk_scale, min::mesh<float, uint32_t>("chunk")),
           _chunk_update(_chunks.size(), true),
           _recent_chunk(0),
@@ -852,7 +1170,7 @@ class cgrid
           _view_dist(calculate_view_distance()),
           _world(calculate_world_size(opt.grid())),
           _cell_extent(1.0, 1.0, 1.0),
-          _generator(_grid), _mesher(_chunk_size)
+          _generator(_grid), _mesher(_chunk_size), _base(0), _full_save(true), _rebase(false)
     {
         // Check chunk size
         if (_grid_scale % _chunk_size != 0)
@@ -872,6 +1190,19 @@ class cgrid
             throw std::runtime_error("cgrid: view_chunk_size can't be greater than " + std::to_string(_chunk_scale * 2 + 1));
         }
 
+        // Bit offset of each axis index in the per chunk solid bitmap
+        const size_t bits = _chunk_words * 64;
+        for (size_t i = 0; i < _grid_scale; i++)
+        {
+            const size_t c = i / _chunk_size;
+            const size_t l = i % _chunk_size;
+            _solid_x[i] = c * _chunk_scale * _chunk_scale * bits + l * _chunk_size * _chunk_size;
+            _solid_y[i] = c * _chunk_scale * bits + l * _chunk_size;
+            _solid_z[i] = c * bits + l;
+            _cell_chunk[i] = c;
+            _cell_local[i] = l;
+        }
+
         // Reserve memory
         reserve_memory();
     }
@@ -891,19 +1222,72 @@ class cgrid
         // Load the world
         world_create(opt);
     }
-    inline void save(const options &opt)
+    inline bool save_failed() const
+    {
+        return !_saver.is_active() && _saver.failed();
+    }
+    inline float save_progress() const
     {
-        // Create output stream for saving world
-        std::vector<uint8_t> stream;
+        return _saver.progress();
+    }
+    inline void save_wait()
+    {
+        // Finish a save in flight
+        _saver.wait();
+    }
+    inline void save(const options &opt, std::vector<uint8_t> &&state)
+    {
+        const size_t slot = opt.get_save_slot();
+        const std::string world = file::get_world_file(slot);
+        const std::string journal = file::get_journal_file(slot);
+        const std::string state_file = file::get_state_file(slot);
+
+        // A full save in flight removes the old journal when it lands, new edits wait for it
+        if (_rebase)
+        {
+            _saver.wait();
+            _rebase = false;
+        }
+
+        // A failed background save left the world on disk behind the grid, joining it reports why
+        if (!_saver.is_active() && _saver.failed())
+        {
+            _saver.wait();
+            _full_save = true;
+        }
 
-        // Reserve space for grid
-        stream.reserve(_grid.size() * sizeof(block_id));
+        // Append the edits since the last save if the base world is current
+        if (!_full_save && _journal.flush(journal, _grid_scale, _base))
+        {
+            // The world on disk now matches the grid
+            file::replace_file(state_file, state);
 
-        // Write data into stream
-        min::write_le_vector<block_id>(stream, _grid);
+            // Merge the journal into the base world in the background once it grows too large
+            if (_journal.should_compact() && !_saver.is_active())
+            {
+                _journal.seal(journal);
+                _saver.begin(_grid, _grid_scale, _chunk_size, _base, world, std::string(), std::vector<uint8_t>(), [journal]() {
+                    edit_journal::remove_sealed(journal);
+                });
+            }
+
+            return;
+        }
 
-        // Write data to file
-        file::save_file(file::get_world_file(opt.get_save_slot()), stream);
+        // Write the whole world in the background under a new base id, the old journal no longer applies
+        _saver.wait();
+        const uint32_t base = _base;
+        std::random_device rd;
+        while (_base == base)
+        {
+            _base = static_cast<uint32_t>(rd() ^ std::chrono::system_clock::now().time_since_epoch().count());
+        }
+        _journal.discard();
+        _full_save = false;
+        _rebase = true;
+        _saver.begin(_grid, _grid_scale, _chunk_size, _base, world, state_file, std::move(state), [journal]() {
+            edit_journal::remove(journal);
+        });
     }
     static inline min::aabbox<float, min::vec3> grid_box(const min::vec3<float> &p)
     {
@@ -921,26 +1305,38 @@ class cgrid
         // Return the box
         return min::aabbox<float, min::vec3>(p - half_extent, p + half_extent);
     }
+    static inline min::vec3<float> drop_half_extent()
+    {
+        return min::vec3<float>(0.25, 0.25, 0.25);
+    }
     static inline min::aabbox<float, min::vec3> drop_box(const min::vec3<float> &p)
     {
         // Create box at center
-        const min::vec3<float> half_extent(0.25, 0.25, 0.25);
+        const min::vec3<float> half_extent = drop_half_extent();
 
         // Return the box
         return min::aabbox<float, min::vec3>(p - half_extent, p + half_extent);
     }
+    static inline min::vec3<float> explode_half_extent()
+    {
+        return min::vec3<float>(0.25, 0.25, 0.25);
+    }
     static inline min::aabbox<float, min::vec3> explode_box(const min::vec3<float> &p)
     {
         // Create box at center
-        const min::vec3<float> half_extent(0.25, 0.25, 0.25);
+        const min::vec3<float> half_extent = explode_half_extent();
 
         // Return the box
         return min::aabbox<float, min::vec3>(p - half_extent, p + half_extent);
     }
+    static inline min::vec3<float> missile_half_extent()
+    {
+        return min::vec3<float>(0.25, 0.25, 0.25);
+    }
     static inline min::aabbox<float, min::vec3> missile_box(const min::vec3<float> &p)
     {
         // Create box at center
-        const min::vec3<float> half_extent(0.25, 0.25, 0.25);
+        const min::vec3<float> half_extent = missile_half_extent();
 
         // Return the box
         return min::aabbox<float, min::vec3>(p - half_extent, p + half_extent);
@@ -982,7 +1378,7 @@ class cgrid
             const min::aabbox<float, min::vec3> box = drone_box(center);
 
             // Calculate collision cells around this box
-            collision_cells(out, box, center);
+            collision_cells(out, box);
         }
     }
     inline void drop_collision_cells(std::vector<std::pair<min::aabbox<float, min::vec3>, block_id>> &out, const min::vec3<float> &center) const
@@ -998,7 +1394,7 @@ class cgrid
             const min::aabbox<float, min::vec3> box = drop_box(center);
 
             // Calculate collision cells around this box
-            collision_cells(out, box, center);
+            collision_cells(out, box);
         }
     }
     inline void explosive_collision_cells(std::vector<std::pair<min::aabbox<float, min::vec3>, block_id>> &out, const min::vec3<float> &center) const
@@ -1014,7 +1410,7 @@ class cgrid
             const min::aabbox<float, min::vec3> box = explode_box(center);
 
             // Calculate collision cells around this box
-            collision_cells(out, box, center);
+            collision_cells(out, box);
         }
     }
     inline void missile_collision_cells(std::vector<std::pair<min::aabbox<float, min::vec3>, block_id>> &out, const min::vec3<float> &center) const
@@ -1030,7 +1426,7 @@ class cgrid
             const min::aabbox<float, min::vec3> box = missile_box(center);
 
             // Calculate collision cells around this box
-            collision_cells(out, box, center);
+            collision_cells(out, box);
         }
     }
     inline void player_collision_cells(std::vector<std::pair<min::aabbox<float, min::vec3>, block_id>> &out, const min::vec3<float> &center) const
@@ -1046,11 +1442,55 @@ class cgrid
             const min::aabbox<float, min::vec3> box = player_box(center);
 
             // Calculate collision cells around this box
-            collision_cells(out, box, center);
+            collision_cells(out, box);
+        }
+    }
+    template <typename F>
+    inline void for_each_solid_cell(const min::aabbox<float, min::vec3> &box, const F &f) const
+    {
+        // Boxes outside the world do not collide
+        if (!inside(box.get_center()))
+        {
+            return;
+        }
+
+        // Get the overlapped cell index range
+        const min::vec3<float> &wmin = _world.get_min();
+        const min::vec3<float> &bmin = box.get_min();
+        const min::vec3<float> &bmax = box.get_max();
+        const size_t x0 = cell_index(bmin.x(), wmin.x());
+        const size_t y0 = cell_index(bmin.y(), wmin.y());
+        const size_t z0 = cell_index(bmin.z(), wmin.z());
+        const size_t x1 = cell_index(bmax.x(), wmin.x());
+        const size_t y1 = cell_index(bmax.y(), wmin.y());
+        const size_t z1 = cell_index(bmax.z(), wmin.z());
+
+        // Visit solid cells in place, stop early if the function returns false
+        for (size_t i = x0; i <= x1; i++)
+        {
+            for (size_t j = y0; j <= y1; j++)
+            {
+                for (size_t k = z0; k <= z1; k++)
+                {
+                    if (is_solid(i, j, k))
+                    {
+                        // Box for this cell lives on the stack
+                        const size_t key = grid_key_pack(min::tri<size_t>(i, j, k));
+                        const block_id atlas = _grid[key];
+                        const min::vec3<float> center(i + wmin.x() + 0.5, j + wmin.y() + 0.5, k + wmin.z() + 0.5);
+                        if (!f(grid_box(center), atlas))
+                        {
+                            return;
+                        }
+                    }
+                }
+            }
         }
     }
     inline void flush_chunk_updates()
     {
+        const profile_scope scope("cgrid::flush_chunk_updates");
+
         // Sort chunk keys using a radix sort
         min::uint_sort<size_t>(_chunk_update_keys, _sort_chunk, [](const size_t i) {
             return i;
@@ -1091,6 +1531,10 @@ class cgrid
     {
         return grid_key_pack(index);
     }
+    inline bool is_solid(const min::tri<size_t> &index) const
+    {
+        return is_solid(index.x(), index.y(), index.z());
+    }
     inline block_id get_block_id(const size_t key) const
     {
         return _grid[key];
@@ -1103,6 +1547,17 @@ class cgrid
     {
         return _chunks[key];
     }
+    inline min::aabbox<float, min::vec3> get_chunk_box(const size_t key) const
+    {
+        return create_chunk_box(chunk_start(key));
+    }
+    inline size_t get_chunk_key(const min::vec3<float> &p) const
+    {
+        // Points outside the world share the key after the last chunk
+        bool is_valid = true;
+        const size_t key = chunk_key_safe(p, is_valid);
+        return (is_valid) ? key : _chunks.size();
+    }
     inline size_t get_chunks() const
     {
         return _chunks.size();
@@ -1111,6 +1566,10 @@ class cgrid
     {
         return _chunk_scale;
     }
+    inline const std::vector<block_id> &get_grid() const
+    {
+        return _grid;
+    }
     inline const std::vector<view_chunk> &get_view_chunks() const
     {
         return _view_chunks;
@@ -1123,20 +1582,10 @@ class cgrid
     {
         return _grid_scale;
     }
-    inline bool is_viewable(const min::camera<float> &cam, const min::aabbox<float, min::vec3> &box) const
+    inline void load_view_range(frustum_cull &cull) const
     {
-        // Is the box inside the frustum?
-        if (min::intersect<float>(cam.get_frustum(), box))
-        {
-            // Check box against view distance from current chunk
-            const float dist = (box.get_center() - _recent_p).magnitude();
-            if (dist < _view_dist)
-            {
-                return true;
-            }
-        }
-
-        return false;
+        // Limit culled boxes to the view distance from the current chunk
+        cull.set_range(_recent_p, _view_dist);
     }
     inline unsigned load_swatch(swatch &sw, const min::vec3<float> &start, const min::tri<int> &offset, const min::tri<unsigned> &length) const
     {
@@ -1165,6 +1614,28 @@ class cgrid
         // Return the swatch cost
         return out;
     }
+    inline void memory(memory_report &report) const
+    {
+        report.add("cgrid::grid", _grid);
+        report.add("cgrid::visit", _visit);
+        report.add("cgrid::solid", _solid);
+        report.add("cgrid::chunk_solid", _chunk_solid);
+
+        // Sum the chunk mesh buffers, capacity is mostly from chunk_warm
+        size_t resident = 0;
+        size_t reserved = 0;
+        for (const auto &c : _chunks)
+        {
+            resident += memory_report::bytes(c.vertex) + memory_report::bytes(c.uv) + memory_report::bytes(c.normal) + memory_report::bytes(c.index);
+            reserved += memory_report::reserved(c.vertex) + memory_report::reserved(c.uv) + memory_report::reserved(c.normal) + memory_report::reserved(c.index);
+        }
+        report.add("cgrid::chunks", resident, reserved);
+        report.add("cgrid::save_writer", _saver.memory_resident(), _saver.memory_reserved());
+        report.add("cgrid::view_cull", _view_cull.memory_resident(), _view_cull.memory_reserved());
+
+        // Generator back buffer
+        _generator.memory(report);
+    }
     inline void preview_atlas(min::mesh<float, uint32_t> &mesh, const min::tri<int> &offset, const min::tri<unsigned> &length, const block_id atlas) const
     {
         // Clear the mesher
@@ -1243,6 +1714,43 @@ class cgrid
         // Generate mesh
         _mesher.generate_preview(mesh);
     }
+    inline bool ray_trace_cells(const min::ray<float, min::vec3> &r, const size_t length, size_t &prev_key, size_t &key, block_id &value) const
+    {
+        // Step every cell without skipping empty chunks, reference for ray_trace
+        return ray_march<false>(r, length, prev_key, key, value);
+    }
+    inline bool ray_trace_reference(const min::ray<float, min::vec3> &r, const size_t length, size_t &prev_key, size_t &key, block_id &value) const
+    {
+        // The original tracer on min::vec3::grid_ray_next, kept so tests can check the DDA against it
+        auto grid_ray = min::vec3<float>::grid_ray(_world.get_min(), _cell_extent, r.get_origin(), r.get_direction(), r.get_inverse());
+
+        // Calculate start point in grid index format
+        auto index = min::vec3<float>::grid_index(_world.get_min(), _cell_extent, r.get_origin());
+
+        // Trace a ray from origin and stop at first populated cell
+        bool is_valid = true;
+        prev_key = key = grid_key_safe(r.get_origin(), is_valid);
+        if (is_valid)
+        {
+            // bad flag signals that we have hit the last valid cell
+            bool bad_flag = false;
+            unsigned count = 0;
+            while (!is_solid(index) && !bad_flag && count < length)
+            {
+                // Update the previous key
+                prev_key = key;
+
+                // Increment the current key
+                key = min::vec3<float>::grid_ray_next(index, grid_ray, bad_flag, _grid_scale);
+                count++;
+            }
+
+            // return the stopping cell value
+            value = _grid[key];
+        }
+
+        return is_valid;
+    }
     inline bool ray_trace_last_key(const min::ray<float, min::vec3> &r, const size_t length, min::vec3<float> &point, size_t &key, block_id &value) const
     {
         // Trace a ray and return the last key
@@ -1286,6 +1794,120 @@ class cgrid
         // return ray start point since it is not in the grid
         return r.get_origin();
     }
+    inline bool sweep(const min::vec3<float> &p, const min::vec3<float> &half, const min::vec3<float> &d, float &toi, block_id &atlas) const
+    {
+        // Boxes outside the world do not collide
+        if (!inside(p))
+        {
+            return false;
+        }
+
+        // Shrink the box so touching a cell face is not an overlap
+        const float eps = 1E-4;
+        const min::vec3<float> shrink(eps, eps, eps);
+
+        // An overlap at the start is an impact at zero
+        bool hit = false;
+        const min::aabbox<float, min::vec3> start(p - half + shrink, p + half - shrink);
+        for_each_solid_cell(start, [&hit, &atlas](const min::aabbox<float, min::vec3> &cell, const block_id value) {
+            hit = true;
+            atlas = value;
+            return false;
+        });
+        if (hit)
+        {
+            toi = 0.0;
+            return true;
+        }
+
+        // Setup a 3D DDA on the leading face of the box along each axis
+        const min::vec3<float> &wmin = _world.get_min();
+        const float pv[3] = {p.x() - wmin.x(), p.y() - wmin.y(), p.z() - wmin.z()};
+        const float hv[3] = {half.x(), half.y(), half.z()};
+        const float dv[3] = {d.x(), d.y(), d.z()};
+        float next[3];
+        float delta[3];
+        int layer[3];
+        int step[3];
+        for (size_t a = 0; a < 3; a++)
+        {
+            if (dv[a] > 0.0)
+            {
+                // Crossing boundary b enters cell b
+                const float lead = pv[a] + hv[a];
+                const float b = std::ceil(lead - eps);
+                next[a] = std::max(0.0f, (b - lead) / dv[a]);
+                delta[a] = 1.0 / dv[a];
+                layer[a] = static_cast<int>(b);
+                step[a] = 1;
+            }
+            else if (dv[a] < 0.0)
+            {
+                // Crossing boundary b enters cell b - 1
+                const float lead = pv[a] - hv[a];
+                const float b = std::floor(lead + eps);
+                next[a] = std::max(0.0f, (b - lead) / dv[a]);
+                delta[a] = -1.0 / dv[a];
+                layer[a] = static_cast<int>(b) - 1;
+                step[a] = -1;
+            }
+            else
+            {
+                // Never crosses a boundary during the sweep
+                next[a] = 2.0;
+                delta[a] = 0.0;
+                layer[a] = 0;
+                step[a] = 0;
+            }
+        }
+
+        // Visit boundary crossings in time order until the end of the sweep
+        const int scale = static_cast<int>(_grid_scale);
+        while (true)
+        {
+            // Get the axis that crosses next
+            const size_t a = (next[0] <= next[1]) ? ((next[0] <= next[2]) ? 0 : 2) : ((next[1] <= next[2]) ? 1 : 2);
+            const float t = next[a];
+            if (t > 1.0)
+            {
+                return false;
+            }
+
+            // Get the cells covered by the box face at this time, skip faces outside the world
+            bool in = layer[a] >= 0 && layer[a] < scale;
+            size_t lo[3];
+            size_t hi[3];
+            for (size_t b = 0; b < 3; b++)
+            {
+                const float c = pv[b] + dv[b] * t;
+                in = in && (c + hv[b] - eps >= 0.0) && (c - hv[b] + eps < scale);
+                lo[b] = cell_index(c - hv[b] + eps, 0.0);
+                hi[b] = cell_index(c + hv[b] - eps, 0.0);
+            }
+            lo[a] = hi[a] = static_cast<size_t>(std::max(layer[a], 0));
+
+            // Stop at the first solid cell in the entered layer
+            for (size_t i = lo[0]; in && i <= hi[0]; i++)
+            {
+                for (size_t j = lo[1]; j <= hi[1]; j++)
+                {
+                    for (size_t k = lo[2]; k <= hi[2]; k++)
+                    {
+                        if (is_solid(i, j, k))
+                        {
+                            toi = t;
+                            atlas = _grid[grid_key_pack(min::tri<size_t>(i, j, k))];
+                            return true;
+                        }
+                    }
+                }
+            }
+
+            // Step into the next layer on this axis
+            layer[a] += step[a];
+            next[a] += delta[a];
+        }
+    }
     inline void path(std::vector<min::vec3<float>> &out, const min::vec3<float> &start, const min::vec3<float> &stop)
     {
         // Convert keys to points
@@ -1306,11 +1928,7 @@ class cgrid
         generate_portal();
 
         // Update all chunks
-        const size_t chunks = _chunks.size();
-        for (size_t i = 0; i < chunks; i++)
-        {
-            chunk_update(i);
-        }
+        update_chunks();
     }
     inline void set_boundary_chunk(const size_t key)
     {
@@ -1494,6 +2112,15 @@ class cgrid
     {
         _chunk_update[chunk_key] = false;
     }
+    inline void update_chunks()
+    {
+        // Rebuild the mesh of every chunk
+        const size_t chunks = _chunks.size();
+        for (size_t i = 0; i < chunks; i++)
+        {
+            chunk_update(i);
+        }
+    }
     inline void update_current_chunk(const min::vec3<float> &p)
     {
         bool is_valid = true;
@@ -1525,32 +2152,34 @@ class cgrid
         // Calculate a weighted center to favor chunks in front of viewer
         const min::vec3<float> weight_center = cam.project_point(_chunk_size / 2);
 
-        // Count for assigning indices
-        size_t count = 0;
-
-        // Create cubic function, for each chunk in cubic space
-        const auto f = [this, &cam, &count, &weight_center](const min::vec3<float> &p) {
-            // Create chunk bounding box
-            const min::aabbox<float, min::vec3> box = this->create_chunk_box(p);
-
-            // If the view is within the frustum
-            if (min::intersect<float>(cam.get_frustum(), box))
-            {
-                // Get the key for this chunk
-                const size_t key = this->chunk_key_unsafe(p);
-
-                // Calculate square distances from center of view frustum
-                const min::vec3<float> diff = weight_center - box.get_center();
-                const float dist = diff.dot(diff);
-
-                // Store the index, key, box and dist for this view chunk
-                this->_view_chunks.emplace_back(count++, key, box, dist);
-            }
+        // Collect the box of each chunk in cubic space
+        _view_cull.clear();
+        _view_start.clear();
+        const auto f = [this](const min::vec3<float> &p) {
+            this->_view_cull.add(this->create_chunk_box(p));
+            this->_view_start.push_back(p);
         };
 
         // Run the function
         cubic(start, length, offset, f);
 
+        // Test all chunk boxes against the view frustum at once
+        _view_cull.set_camera(cam);
+        const std::vector<size_t> &in = _view_cull.cull();
+
+        // Store the index, key, box and dist for each view chunk
+        size_t count = 0;
+        for (const size_t i : in)
+        {
+            const min::vec3<float> &p = _view_start[i];
+            const min::aabbox<float, min::vec3> box = create_chunk_box(p);
+
+            // Calculate square distances from center of view frustum
+            const min::vec3<float> diff = weight_center - box.get_center();
+            const float dist = diff.dot(diff);
+            _view_chunks.emplace_back(count++, chunk_key_unsafe(p), box, dist);
+        }
+
         // Sort the view indices based on distance from camera to reduce overdraw
         std::sort(_view_chunks.begin(), _view_chunks.end(), [](const view_chunk &a, const view_chunk &b) {
             return a.get_dist() < b.get_dist();
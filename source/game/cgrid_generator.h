@@ -23,6 +23,7 @@ along with Beyond Dying Skies.  If not, see <http://www.gnu.org/licenses/>.
 #include <fstream>
 #include <game/id.h>
 #include <game/memory_map.h>
+#include <game/memory_report.h>
 #include <game/work_queue.h>
 #include <kernel/mandelbulb_asym.h>
 #include <kernel/mandelbulb_exp.h>
@@ -195,6 +196,8 @@ class cgrid_generator
     }
     inline void generate_creative(std::vector<block_id> &grid, const size_t scale, const size_t chunk_size)
     {
+        const memory_scope mem(mem_tag::GENERATOR);
+
         // Reseed the generator
         work_queue::worker.seed(std::chrono::high_resolution_clock::now().time_since_epoch().count());
 
@@ -216,6 +219,8 @@ class cgrid_generator
     }
     inline void generate_normal(std::vector<block_id> &grid, const size_t scale, const size_t chunk_size)
     {
+        const memory_scope mem(mem_tag::GENERATOR);
+
         // Reseed the generator
         work_queue::worker.seed(std::chrono::high_resolution_clock::now().time_since_epoch().count());
 
@@ -280,6 +285,10 @@ class cgrid_generator
         // Put the threads back to sleep
         work_queue::worker.sleep();
     }
+    inline void memory(memory_report &report) const
+    {
+        report.add("cgrid_generator::back", _back);
+    }
 };
 }
 
@@ -19,6 +19,8 @@ along with Beyond Dying Skies.  If not, see <http://www.gnu.org/licenses/>.
 #define _BDS_CHESTS_BDS_
 
 #include <game/def.h>
+#include <game/entity.h>
+#include <game/registry.h>
 #include <game/static_instance.h>
 #include <min/aabbox.h>
 #include <min/grid.h>
@@ -32,29 +34,20 @@ class chest
 {
   private:
     size_t _body_id;
-    size_t _inst_id;
     min::vec3<float> _p;
 
   public:
-    chest(const size_t body_id, const size_t inst_id, const min::vec3<float> &p)
-        : _body_id(body_id), _inst_id(inst_id), _p(p) {}
+    chest(const size_t body_id, const min::vec3<float> &p)
+        : _body_id(body_id), _p(p) {}
 
     inline size_t body_id() const
     {
         return _body_id;
     }
-    inline void dec_inst()
-    {
-        _inst_id--;
-    }
     inline const min::vec3<float> &get_position() const
     {
         return _p;
     }
-    inline size_t inst_id() const
-    {
-        return _inst_id;
-    }
 };
 
 class chests
@@ -62,7 +55,7 @@ class chests
   private:
     physics *const _sim;
     static_instance *const _inst;
-    std::vector<chest> _chests;
+    registry<chest> _chests;
     const std::string _str;
 
     inline min::body<float, min::vec3> &body(const size_t index)
@@ -101,19 +94,14 @@ class chests
     }
     inline void reset()
     {
-        // Remove all the chests backwards to preserve chest-instance id mapping
-        const size_t size = _chests.size();
-        for (size_t i = size; i-- != 0;)
+        // Clear all the bodies
+        for (const chest &c : _chests)
         {
-            // Get the chest
-            const chest &c = _chests[i];
-
-            // Clear instance and body
-            _inst->get_chest().clear(c.inst_id());
             _sim->clear_body(c.body_id());
         }
 
-        // Clear all the chests
+        // Clear all the chests and instances at once
+        _inst->get_chest().clear();
         _chests.clear();
     }
     inline bool add(const min::vec3<float> &p)
@@ -130,39 +118,48 @@ class chests
         // Create a box for the chest
         const min::aabbox<float, min::vec3> box = _inst->get_chest().get_box(inst_id);
 
-        // Store the chest index as body data
-        const size_t index = _chests.size();
-
         // Add to physics simulation
-        const size_t body_id = _sim->add_body(box, 10.0, id_value(static_id::CHEST), index);
+        const size_t body_id = _sim->add_body(box, 10.0, id_value(static_id::CHEST), 0);
 
         // Create a new chest
-        _chests.emplace_back(body_id, inst_id, p);
+        const size_t id = _chests.add(body_id, p);
+
+        // Store the stable chest handle as body data
+        _sim->get_body(body_id).set_data(min::body_data(id));
 
         // Return chest added
         return true;
     }
+    inline void gather(entity_store &es) const
+    {
+        // Add every chest to the store, chests are pinned so their instance never moves
+        const size_t size = _chests.size();
+        for (size_t i = 0; i < size; i++)
+        {
+            es.add(static_id::CHEST, i, _chests[i].body_id(), true);
+        }
+    }
     inline const std::string &get_string() const
     {
         return _str;
     }
-    inline void remove(const size_t index)
+    inline void remove(const size_t id)
     {
-        // Clear chest at index
-        _inst->get_chest().clear(_chests[index].inst_id());
-        _sim->clear_body(_chests[index].body_id());
-        _chests.erase(_chests.begin() + index);
-
-        // Adjust the remaining chest indices
-        const size_t size = _chests.size();
-        for (size_t i = index; i < size; i++)
+        // Ignore handles of chests already removed
+        if (!_chests.valid(id))
         {
-            // Adjust the instance id
-            _chests[i].dec_inst();
-
-            // Adjust the body data index
-            body(i).set_data(min::body_data(i));
+            return;
         }
+
+        // Swap the last chest and instance into this index
+        const size_t index = _chests.index(id);
+        _inst->get_chest().clear(index);
+        _sim->clear_body(_chests[index].body_id());
+        _chests.remove(index);
+    }
+    inline size_t size() const
+    {
+        return _chests.size();
     }
     inline void update_frame()
     {
@@ -177,20 +174,6 @@ class chests
             set_position(i, inv_g);
         }
     }
-    inline void update()
-    {
-        // Update all chest positions
-        const size_t size = _chests.size();
-        for (size_t i = 0; i < size; i++)
-        {
-            // Update the instance matrix
-            const size_t inst_id = _chests[i].inst_id();
-
-            // Update body positions
-            const min::vec3<float> &p = body(i).get_position();
-            _inst->get_chest().update_position(inst_id, p);
-        }
-    }
 };
 }
 
@@ -34,8 +34,14 @@ typedef min::physics<float, uint_fast16_t, uint_fast32_t, min::vec3, min::aabbox
 typedef min::tree<float, uint_fast8_t, uint_fast8_t, min::vec2, min::aabbox, min::aabbox> ui_tree;
 
 // Collision constants
+static constexpr float _damping = 0.1;
+static constexpr float _elasticity = 0.1;
 static constexpr float _grav_mag = 10.0;
 static constexpr size_t _physics_frames = 180;
+static constexpr float _time_step = 1.0 / _physics_frames;
+
+// Game version, shown in the debug text and written to benchmark results
+static constexpr const char *_game_version = "0.1.314";
 
 // Callbacks
 typedef std::function<void(min::body<float, min::vec3> &, min::body<float, min::vec3> &)> coll_call;
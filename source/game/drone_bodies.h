@@ -0,0 +1,428 @@
+/* Copyright [2013-2018] [Aaron Springstroh, Minimal Graphics Library]
+
+This file is part of the Beyond Dying Skies.
+
+Beyond Dying Skies is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+Beyond Dying Skies is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with Beyond Dying Skies.  If not, see <http://www.gnu.org/licenses/>.
+*/
+#ifndef _BDS_DRONE_BODIES_BDS_
+#define _BDS_DRONE_BODIES_BDS_
+
+#include <algorithm>
+#include <cmath>
+#include <game/cgrid.h>
+#include <game/def.h>
+#include <game/id.h>
+#include <game/path.h>
+#include <game/registry.h>
+#include <min/aabbox.h>
+#include <min/grid.h>
+#include <min/physics_nt.h>
+#include <min/tri.h>
+#include <min/vec3.h>
+#include <vector>
+
+namespace game
+{
+class drone
+{
+  private:
+    size_t _body_id;
+    size_t _path_id;
+    size_t _sound_id;
+    std::vector<path> *_paths;
+    float _max_health;
+    float _health;
+    size_t _idle;
+    size_t _launch;
+
+  public:
+    drone(const size_t body_id,
+          const size_t path_id, const size_t sound_id, std::vector<path> *const vp,
+          const min::vec3<float> &p, const min::vec3<float> &dest, const float health)
+        : _body_id(body_id), _path_id(path_id),
+          _sound_id(sound_id), _paths(vp), _max_health(health), _health(health), _idle(0), _launch(0)
+    {
+        // Reset path and update with new info
+        get_path().set_dead(false);
+        get_path().update(p, dest);
+    }
+    inline size_t body_id() const
+    {
+        return _body_id;
+    }
+    inline bool damage(const float d)
+    {
+        // Decriment health
+        _health -= d;
+
+        // Return if dead
+        return _health <= 0.0;
+    }
+    inline void dec_idle(const size_t ticks)
+    {
+        _idle -= std::min(_idle, ticks);
+    }
+    inline void dec_launch(const size_t ticks)
+    {
+        _launch -= std::min(_launch, ticks);
+    }
+    inline float get_health() const
+    {
+        return _health;
+    }
+    inline float get_max_health() const
+    {
+        return _max_health;
+    }
+    inline float get_health_percent() const
+    {
+        return _health / _max_health;
+    }
+    inline path &get_path()
+    {
+        return (*_paths)[_path_id];
+    }
+    inline const path &get_path() const
+    {
+        return (*_paths)[_path_id];
+    }
+    inline bool is_idle() const
+    {
+        return _idle != 0;
+    }
+    inline bool is_launching() const
+    {
+        return _launch == 0;
+    }
+    inline size_t path_id() const
+    {
+        return _path_id;
+    }
+    inline void set_idle(const size_t frames)
+    {
+        _idle = frames;
+    }
+    inline size_t sound_id() const
+    {
+        return _sound_id;
+    }
+    inline void set_launch(const size_t frames)
+    {
+        _launch = frames;
+    }
+    inline min::vec3<float> step(cgrid &grid, const float speed)
+    {
+        return get_path().step(grid) * speed;
+    }
+};
+
+// Drone bodies, paths and their physics step without the renderer or sound, the drone index is the instance id
+class drone_bodies
+{
+  private:
+    static constexpr uint_fast16_t _splash_level = 10;
+    static constexpr uint_fast16_t _tunnel_level = 15;
+    physics *const _sim;
+    min::vec3<float> _dest;
+    std::vector<path> _paths;
+    registry<drone> _drones;
+    size_t _path_old;
+    coll_call _f;
+    bool _disable;
+
+    inline min::body<float, min::vec3> &body(const size_t index)
+    {
+        return _sim->get_body(_drones[index].body_id());
+    }
+    inline const min::body<float, min::vec3> &body(const size_t index) const
+    {
+        return _sim->get_body(_drones[index].body_id());
+    }
+    inline size_t get_idle_path_id()
+    {
+        // Output id
+        size_t id = 0;
+
+        // Scan for unused path
+        const size_t size = _paths.size();
+        for (size_t i = 0; i < size; i++)
+        {
+            // Start at the oldest index
+            const size_t index = (_path_old %= size)++;
+
+            // If index is unused
+            if (_paths[index].is_dead())
+            {
+                // Assign id for use
+                id = index;
+
+                // Break out since found
+                break;
+            }
+        }
+
+        return id;
+    }
+    inline void force(const size_t index, const min::vec3<float> &f)
+    {
+        // Get the drop body
+        min::body<float, min::vec3> &b = body(index);
+
+        // Apply force to the body per mass
+        b.add_force(f * b.get_mass());
+    }
+    inline static float path_speed(const float remain)
+    {
+        // Calculate speed slowing down as approaching goal
+        return 3.75 * ((remain - 3.0) / (remain + 3.0) + 1.1);
+    }
+
+  public:
+    drone_bodies(physics &sim, const size_t size)
+        : _sim(&sim), _paths(size), _path_old(0), _f(nullptr), _disable(false)
+    {
+        // Reserve space for drones
+        _drones.reserve(size);
+    }
+    inline drone &operator[](const size_t index)
+    {
+        return _drones[index];
+    }
+    inline const drone &operator[](const size_t index) const
+    {
+        return _drones[index];
+    }
+    inline size_t add(const min::aabbox<float, min::vec3> &box, const min::vec3<float> &p, const size_t sound_id, const float health)
+    {
+        // The body data is set to the drone handle below
+        const size_t body_id = _sim->add_body(box, 10.0, id_value(static_id::DRONE), 0);
+
+        // Register player collision callback
+        if (_f)
+        {
+            _sim->register_callback(body_id, _f);
+        }
+
+        // Get idle path
+        const size_t path_id = get_idle_path_id();
+
+        // Add path and path data for drone
+        const size_t id = _drones.add(body_id, path_id, sound_id, &_paths, p, _dest, health);
+
+        // Store the stable drone handle as body data
+        _sim->get_body(body_id).set_data(min::body_data(id));
+
+        // Return the drone handle
+        return id;
+    }
+    inline bool damage(const size_t index, const min::vec3<float> &dir, const float dam)
+    {
+        // Apply a force on the drone body when hit
+        force(index, dir * (dam * 100.0));
+
+        // Knock the drone offline for physics frames == 1 sec
+        drone &d = _drones[index];
+        d.set_idle(_physics_frames);
+
+        // Do damage and return if dead
+        return d.damage(dam);
+    }
+    inline size_t index(const size_t id) const
+    {
+        return _drones.index(id);
+    }
+    inline float max_speed() const
+    {
+        // Fastest body speed, sets how often this group must collide
+        float out = 0.0;
+        const size_t size = _drones.size();
+        for (size_t i = 0; i < size; i++)
+        {
+            const min::vec3<float> &v = body(i).get_linear_velocity();
+            out = std::max(out, v.dot(v));
+        }
+
+        return std::sqrt(out);
+    }
+    inline const min::vec3<float> &position(const size_t index) const
+    {
+        // Return the drone position
+        return body(index).get_position();
+    }
+    inline void remove_at(const size_t index)
+    {
+        // Get path id to set dead flag
+        const size_t path_id = _drones[index].path_id();
+        _paths[path_id].clear();
+        _paths[path_id].set_dead(true);
+
+        // Swap the last drone into this index
+        _sim->clear_body(_drones[index].body_id());
+        _drones.remove(index);
+    }
+    inline void reset()
+    {
+        // Clear all the drones
+        for (const drone &d : _drones)
+        {
+            // Get path id to set dead flag
+            const size_t path_id = d.path_id();
+            _paths[path_id].clear();
+            _paths[path_id].set_dead(true);
+
+            // Clear body
+            _sim->clear_body(d.body_id());
+        }
+
+        // Clear all the drones at once
+        _drones.clear();
+
+        // Reset the oldest path
+        _path_old = 0;
+
+        // Reset disable flag
+        _disable = false;
+    }
+    inline void set_collision_callback(const coll_call &f)
+    {
+        _f = f;
+    }
+    inline void set_destination(const min::vec3<float> &p)
+    {
+        _dest = p;
+    }
+    inline void set_position(const size_t index, const min::vec3<float> &p)
+    {
+        // Warp character to new position
+        body(index).set_position(p);
+    }
+    inline size_t size() const
+    {
+        return _drones.size();
+    }
+    inline bool valid(const size_t id) const
+    {
+        return _drones.valid(id);
+    }
+    template <typename R, typename ES>
+    inline void update_frame(cgrid &grid, const size_t ticks, const uint_fast16_t player_level, const R &respawn, const ES &ex_scale_call)
+    {
+        // Do drone collisions
+        const size_t size = _drones.size();
+
+        // Update drone paths
+        if (!_disable)
+        {
+            for (size_t i = 0; i < size; i++)
+            {
+                // Get the drone
+                drone &d = _drones[i];
+
+                // Only path if not idling
+                if (!d.is_idle())
+                {
+                    // Get remaining distance
+                    const float remain = d.get_path().get_remain();
+
+                    // Calculate the speed of the next step
+                    const min::vec3<float> step = d.step(grid, path_speed(remain));
+
+                    // Add velocity to the body
+                    body(i).set_linear_velocity(step);
+
+                    // Update the path data position
+                    const min::vec3<float> &p = body(i).get_position();
+                    d.get_path().update(p, _dest);
+                }
+                else
+                {
+                    // Decrement idle frame count
+                    d.dec_idle(ticks);
+                }
+
+                // Decrement launch counter
+                if (!d.is_launching())
+                {
+                    d.dec_launch(ticks);
+                }
+            }
+        }
+
+        // Update drone collisions
+        for (size_t i = 0; i < size; i++)
+        {
+            // Get the drone
+            drone &d = _drones[i];
+
+            // Check if drone is stuck
+            // Stuck theory
+            // 1) A stuck drone will receive a zero path while searching in the grid
+            // 2) A zero path triggers the stuck flag
+            // 3) We warp the drone below to resolve the issue and clear the flag
+            if (d.get_path().is_stuck())
+            {
+                // Respawn the body
+                body(i).set_position(respawn());
+
+                // Clear stuck flag
+                d.get_path().clear_stuck();
+            }
+
+            // Collision flag and first solid cell
+            const min::vec3<float> &p = body(i).get_position();
+            bool hit = false;
+            block_id first = block_id::EMPTY;
+
+            // Solve static collisions against all cells that could collide
+            const size_t body = d.body_id();
+            grid.for_each_solid_cell(cgrid::drone_box(p), [this, &hit, &first, body](const min::aabbox<float, min::vec3> &cell, const block_id atlas) {
+                // Collide with the cell
+                const bool status = _sim->collide(body, cell);
+
+                // Remember the first solid cell
+                if (first == block_id::EMPTY)
+                {
+                    first = atlas;
+                }
+
+                // Register hit flag, BUG FIX, DONT COLLAPSE THIS LINE!
+                hit = hit || status;
+
+                return true;
+            });
+
+            // If we got a hit
+            if (hit)
+            {
+                // Tunnel through geometry looking for player
+                const bool splash = d.is_idle() && (player_level >= _splash_level);
+                const bool tunnel = player_level >= _tunnel_level;
+                if (splash || tunnel)
+                {
+                    // Blow up geometry around drone
+                    const min::tri<unsigned> scale(3, 3, 3);
+
+                    // First solid cell, must be set if hit
+                    ex_scale_call(p, scale, first);
+                }
+
+                // Create new path
+                d.get_path().clear();
+            }
+        }
+    }
+};
+}
+
+#endif
@@ -0,0 +1,445 @@
+/* Copyright [2013-2018] [Aaron Springstroh, Minimal Graphics Library]
+
+This file is part of the Beyond Dying Skies.
+
+Beyond Dying Skies is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+Beyond Dying Skies is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with Beyond Dying Skies.  If not, see <http://www.gnu.org/licenses/>.
+*/
+#ifndef _BDS_DROP_BODIES_BDS_
+#define _BDS_DROP_BODIES_BDS_
+
+#include <algorithm>
+#include <cmath>
+#include <game/cgrid.h>
+#include <game/def.h>
+#include <game/id.h>
+#include <game/registry.h>
+#include <game/static_batch.h>
+#include <game/task_pool.h>
+#include <min/aabbox.h>
+#include <min/physics_nt.h>
+#include <min/vec3.h>
+#include <vector>
+
+namespace game
+{
+class drop
+{
+  private:
+    size_t _body_id;
+    size_t _spawn;
+    block_id _atlas;
+    min::vec3<float> _rest;
+    uint_fast16_t _still;
+    uint_fast8_t _count;
+    bool _asleep;
+
+  public:
+    drop(const size_t body_id, const size_t spawn, const block_id atlas)
+        : _body_id(body_id), _spawn(spawn), _atlas(atlas), _still(0), _count(1), _asleep(false) {}
+
+    inline block_id atlas() const
+    {
+        return _atlas;
+    }
+    inline size_t body_id() const
+    {
+        return _body_id;
+    }
+    inline uint_fast8_t count() const
+    {
+        return _count;
+    }
+    inline size_t spawn() const
+    {
+        return _spawn;
+    }
+    inline void set_body_id(const size_t body_id)
+    {
+        _body_id = body_id;
+    }
+    inline void set_count(const uint_fast8_t count)
+    {
+        _count = count;
+    }
+    inline bool is_asleep() const
+    {
+        return _asleep;
+    }
+    inline const min::vec3<float> &rest() const
+    {
+        return _rest;
+    }
+    inline bool settle(const bool still, const uint_fast16_t frames, const min::vec3<float> &p)
+    {
+        // Count consecutive still frames, fall asleep after enough of them
+        _still = (still) ? _still + 1 : 0;
+        if (_still >= frames)
+        {
+            _rest = p;
+            _asleep = true;
+        }
+
+        return _asleep;
+    }
+    inline void wake()
+    {
+        _still = 0;
+        _asleep = false;
+    }
+};
+
+// Drop bodies and their physics step without the renderer, the drop index is the instance id
+class drop_bodies
+{
+  private:
+    static constexpr float _sleep_speed = 0.1;
+    static constexpr uint_fast16_t _sleep_frames = 90;
+    static constexpr uint_fast8_t _stack_max = 64;
+    static constexpr float _wake_player = 4.0;
+    physics *const _sim;
+    const min::aabbox<float, min::vec3> _box;
+    registry<drop> _drops;
+    std::vector<size_t> _awake;
+    static_batch _batch;
+    size_t _spawned;
+
+    inline min::body<float, min::vec3> &body(const size_t index)
+    {
+        return _sim->get_body(_drops[index].body_id());
+    }
+    inline const min::body<float, min::vec3> &body(const size_t index) const
+    {
+        return _sim->get_body(_drops[index].body_id());
+    }
+    inline min::aabbox<float, min::vec3> box(const min::vec3<float> &p) const
+    {
+        // Move the model box to the drop position
+        min::aabbox<float, min::vec3> out(_box);
+        out.set_position(p);
+
+        return out;
+    }
+    inline void force(const size_t index, const min::vec3<float> &f)
+    {
+        // Get the drop body
+        min::body<float, min::vec3> &b = body(index);
+
+        // Apply force to the body per mass
+        b.add_force(f * b.get_mass());
+    }
+    inline void reserve_memory(const size_t size)
+    {
+        // Reserve space for drops
+        _drops.reserve(size);
+        _awake.reserve(size);
+        _batch.reserve(size);
+    }
+    inline void sleep_at(const size_t index)
+    {
+        // Take the body out of the simulation, sleeping drops are not stepped or pinned
+        _sim->clear_body(_drops[index].body_id());
+    }
+    inline void wake_at(const size_t index)
+    {
+        // Get the drop at rest
+        drop &d = _drops[index];
+        d.wake();
+
+        // Add the drop back to the simulation at rest
+        const size_t body_id = _sim->add_body(box(d.rest()), 10.0, id_value(static_id::DROP), 0);
+        d.set_body_id(body_id);
+
+        // Store the stable drop handle as body data
+        _sim->get_body(body_id).set_data(min::body_data(_drops.handle(index)));
+    }
+
+  public:
+    drop_bodies(physics &sim, const min::aabbox<float, min::vec3> &box, const size_t size)
+        : _sim(&sim), _box(box), _spawned(0)
+    {
+        reserve_memory(size);
+    }
+    inline drop &operator[](const size_t index)
+    {
+        return _drops[index];
+    }
+    inline const drop &operator[](const size_t index) const
+    {
+        return _drops[index];
+    }
+    inline size_t add(const min::vec3<float> &p, const min::vec3<float> &dir, const block_id atlas)
+    {
+        // Add to physics simulation
+        const size_t body_id = _sim->add_body(box(p), 10.0, id_value(static_id::DROP), 0);
+
+        // Create a new drop
+        const size_t id = _drops.add(body_id, _spawned++, atlas);
+
+        // Get the physics body for editing
+        min::body<float, min::vec3> &body = _sim->get_body(body_id);
+
+        // Store the stable drop handle as body data
+        body.set_data(min::body_data(id));
+
+        // Set body linear velocity
+        const min::vec3<float> lv = min::vec3<float>(0.0, 5.0, 0.0) + dir * -5.0;
+        body.set_linear_velocity(lv);
+
+        // Return the drop handle
+        return id;
+    }
+    inline size_t asleep() const
+    {
+        // Count the sleeping drops
+        size_t out = 0;
+        for (const drop &d : _drops)
+        {
+            out += d.is_asleep();
+        }
+
+        return out;
+    }
+    inline size_t index(const size_t id) const
+    {
+        return _drops.index(id);
+    }
+    inline float max_speed() const
+    {
+        // Fastest body speed, sets how often this group must collide
+        float out = 0.0;
+        const size_t size = _drops.size();
+        for (size_t i = 0; i < size; i++)
+        {
+            // Sleeping drops have no body
+            if (_drops[i].is_asleep())
+            {
+                continue;
+            }
+
+            const min::vec3<float> &v = body(i).get_linear_velocity();
+            out = std::max(out, v.dot(v));
+        }
+
+        return std::sqrt(out);
+    }
+    inline size_t oldest_single() const
+    {
+        // Find the oldest drop holding a single item, recycling it loses no stack
+        const size_t size = _drops.size();
+        size_t index = size;
+        for (size_t i = 0; i < size; i++)
+        {
+            const drop &d = _drops[i];
+            if (d.count() == 1 && (index == size || d.spawn() < _drops[index].spawn()))
+            {
+                index = i;
+            }
+        }
+
+        return index;
+    }
+    inline const min::vec3<float> &position(const size_t index) const
+    {
+        // Return the drop position, sleeping drops have no body
+        const drop &d = _drops[index];
+        if (d.is_asleep())
+        {
+            return d.rest();
+        }
+
+        return body(index).get_position();
+    }
+    inline void recycle(const size_t index, const min::vec3<float> &p, const min::vec3<float> &dir, const block_id atlas)
+    {
+        // A sleeping drop needs its body back
+        if (_drops[index].is_asleep())
+        {
+            wake_at(index);
+        }
+
+        // Get the old body
+        const size_t body_id = _drops[index].body_id();
+
+        // Get the physics body for editing
+        min::body<float, min::vec3> &body = _sim->get_body(body_id);
+
+        // Set body linear velocity
+        const min::vec3<float> lv = min::vec3<float>(0.0, 5.0, 0.0) + dir * -5.0;
+        body.set_linear_velocity(lv);
+
+        // Update body position
+        body.set_position(p);
+
+        // Recreate drop, the body keeps the drop handle
+        _drops[index] = drop(body_id, _spawned++, atlas);
+    }
+    inline void remove_at(const size_t index)
+    {
+        // Sleeping drops have no body to clear
+        if (!_drops[index].is_asleep())
+        {
+            _sim->clear_body(_drops[index].body_id());
+        }
+
+        // Swap the last drop into this index
+        _drops.remove(index);
+    }
+    inline void reset()
+    {
+        // Clear all the bodies, sleeping drops have none
+        for (const drop &d : _drops)
+        {
+            if (!d.is_asleep())
+            {
+                _sim->clear_body(d.body_id());
+            }
+        }
+
+        // Clear all the drops at once
+        _drops.clear();
+
+        // Restart the spawn order
+        _spawned = 0;
+    }
+    inline void set_pool(task_pool *const pool)
+    {
+        // Solve large batches on this pool
+        _batch.set_pool(pool);
+    }
+    inline size_t size() const
+    {
+        return _drops.size();
+    }
+    inline bool stack(const min::vec3<float> &p, const block_id atlas, const float max_d2)
+    {
+        // Find the nearest drop of this atlas with room in its stack
+        const size_t size = _drops.size();
+        float best = max_d2;
+        size_t index = size;
+        for (size_t i = 0; i < size; i++)
+        {
+            const drop &d = _drops[i];
+            if (d.atlas() == atlas && d.count() < _stack_max)
+            {
+                const min::vec3<float> dp = position(i) - p;
+                const float d2 = dp.dot(dp);
+                if (d2 <= best)
+                {
+                    best = d2;
+                    index = i;
+                }
+            }
+        }
+
+        // Merge into the stack
+        if (index < size)
+        {
+            _drops[index].set_count(_drops[index].count() + 1);
+            return true;
+        }
+
+        return false;
+    }
+    inline bool valid(const size_t id) const
+    {
+        return _drops.valid(id);
+    }
+    inline void wake(const min::vec3<float> &p, const float radius)
+    {
+        // Wake sleeping drops near an edit or explosion
+        const float r2 = radius * radius;
+        const size_t size = _drops.size();
+        for (size_t i = 0; i < size; i++)
+        {
+            const drop &d = _drops[i];
+            if (d.is_asleep())
+            {
+                const min::vec3<float> dp = d.rest() - p;
+                if (dp.dot(dp) <= r2)
+                {
+                    wake_at(i);
+                }
+            }
+        }
+    }
+    template <typename S, typename E>
+    inline void update_frame(const cgrid &grid, const min::vec3<float> &player, const float friction, const S &sleep_call, const E &ex_call)
+    {
+        // Gather the awake drops into the batch
+        _awake.clear();
+        _batch.clear();
+        const size_t size = _drops.size();
+        const float wake2 = _wake_player * _wake_player;
+        const min::vec3<float> half = cgrid::drop_half_extent();
+        for (size_t i = 0; i < size; i++)
+        {
+            drop &d = _drops[i];
+            if (d.is_asleep())
+            {
+                // Wake drops near the player so they can be picked up
+                const min::vec3<float> dp = d.rest() - player;
+                if (dp.dot(dp) > wake2)
+                {
+                    // Sleeping drops skip the grid and the simulation entirely
+                    continue;
+                }
+
+                wake_at(i);
+            }
+
+            _awake.push_back(i);
+            _batch.gather(*_sim, d.body_id(), half);
+        }
+
+        // Solve static collisions and write back the moved bodies
+        _batch.solve(grid, _elasticity);
+        _batch.scatter(*_sim);
+
+        // Add friction force and detect drops at rest
+        const size_t awake = _awake.size();
+        const float sleep2 = _sleep_speed * _sleep_speed;
+        for (size_t j = 0; j < awake; j++)
+        {
+            const size_t index = _awake[j];
+            const bool hit = _batch.is_hit(j);
+            const min::vec3<float> vel = _batch.velocity(j);
+            if (hit)
+            {
+                const min::vec3<float> xz(vel.x(), 0.0, vel.z());
+
+                // Add friction force opposing lateral motion
+                force(index, xz * friction);
+            }
+
+            // Drops resting on a cell below the speed threshold fall asleep, the owner pins the instance at rest
+            if (_drops[index].settle(hit && vel.dot(vel) < sleep2, _sleep_frames, _batch.position(j)))
+            {
+                sleep_at(index);
+                sleep_call(index, _drops[index].rest());
+            }
+        }
+
+        // If drop collides with sodium cell, blow it up, this may spawn drops so it runs last
+        _batch.for_each_contact([&ex_call](const size_t i, const min::vec3<float> &center, const block_id atlas) {
+            if (atlas == block_id::SODIUM)
+            {
+                // Call explosion callback
+                ex_call(center, atlas);
+            }
+        });
+    }
+};
+}
+
+#endif
@@ -0,0 +1,221 @@
+/* Copyright [2013-2018] [Aaron Springstroh, Minimal Graphics Library]
+
+This file is part of the Beyond Dying Skies.
+
+Beyond Dying Skies is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+Beyond Dying Skies is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with Beyond Dying Skies.  If not, see <http://www.gnu.org/licenses/>.
+*/
+#ifndef _BDS_EDIT_JOURNAL_BDS_
+#define _BDS_EDIT_JOURNAL_BDS_
+
+#include <cstdint>
+#include <cstdio>
+#include <fstream>
+#include <game/id.h>
+#include <string>
+#include <vector>
+
+namespace game
+{
+
+// Write ahead log of grid edits, saves append the edits made since the last save instead of rewriting the world
+// The log is a header followed by blocks of (key, value) records, each block ends with a checksum of its records
+// The header names the base world id, so a log left over from an older base world is never replayed
+class edit_journal
+{
+  private:
+    static constexpr uint32_t _magic = 0x4A534442;
+    static constexpr uint32_t _version = 2;
+    static constexpr size_t _header = 4 * sizeof(uint32_t);
+    static constexpr size_t _record = sizeof(uint32_t) + sizeof(uint8_t);
+    static constexpr size_t _compact_bytes = 1 << 20;
+
+    std::vector<uint8_t> _pending;
+    size_t _bytes;
+
+    static inline uint32_t read_u32(const uint8_t *const p)
+    {
+        // Little endian
+        return static_cast<uint32_t>(p[0]) | (static_cast<uint32_t>(p[1]) << 8) | (static_cast<uint32_t>(p[2]) << 16) | (static_cast<uint32_t>(p[3]) << 24);
+    }
+    static inline void write_u32(std::vector<uint8_t> &out, const uint32_t value)
+    {
+        // Little endian
+        out.push_back(static_cast<uint8_t>(value));
+        out.push_back(static_cast<uint8_t>(value >> 8));
+        out.push_back(static_cast<uint8_t>(value >> 16));
+        out.push_back(static_cast<uint8_t>(value >> 24));
+    }
+    static inline uint32_t checksum(const uint8_t *const data, const size_t size)
+    {
+        // FNV-1a
+        uint32_t out = 2166136261u;
+        for (size_t i = 0; i < size; i++)
+        {
+            out = (out ^ data[i]) * 16777619u;
+        }
+
+        return out;
+    }
+    template <typename F>
+    static inline bool replay_file(const std::string &file_name, const size_t scale, const uint32_t base, const F &f, size_t &bytes)
+    {
+        bytes = 0;
+
+        // A missing log has nothing to replay
+        std::ifstream file(file_name, std::ios::in | std::ios::binary | std::ios::ate);
+        if (!file.is_open())
+        {
+            return true;
+        }
+
+        // Read the whole log, it is small compared to the world
+        std::vector<uint8_t> stream(static_cast<size_t>(file.tellg()));
+        file.seekg(0, std::ios::beg);
+        file.read(reinterpret_cast<char *>(stream.data()), stream.size());
+        bytes = stream.size();
+
+        // A log for another world size or base world is stale
+        const size_t size = stream.size();
+        if (size < _header || read_u32(&stream[0]) != _magic || read_u32(&stream[4]) != _version || read_u32(&stream[8]) != scale || read_u32(&stream[12]) != base)
+        {
+            return false;
+        }
+
+        // Apply whole blocks in order, a torn block at the end from a crash is dropped
+        size_t next = _header;
+        while (size - next >= sizeof(uint32_t))
+        {
+            const size_t count = read_u32(&stream[next]);
+            const size_t length = count * _record;
+            if (count == 0 || (size - next - sizeof(uint32_t)) / _record < count || size - next - sizeof(uint32_t) - length < sizeof(uint32_t))
+            {
+                return false;
+            }
+            const uint8_t *const records = &stream[next + sizeof(uint32_t)];
+            if (checksum(records, length) != read_u32(records + length))
+            {
+                return false;
+            }
+            for (size_t i = 0; i < count; i++)
+            {
+                const uint8_t *const r = records + i * _record;
+                f(static_cast<size_t>(read_u32(r)), static_cast<block_id>(static_cast<int8_t>(r[4])));
+            }
+            next += sizeof(uint32_t) + length + sizeof(uint32_t);
+        }
+
+        // Any bytes left over are a torn block
+        return next == size;
+    }
+
+  public:
+    edit_journal() : _bytes(0) {}
+
+    inline void append(const size_t key, const block_id value)
+    {
+        // Key followed by the new value
+        write_u32(_pending, static_cast<uint32_t>(key));
+        _pending.push_back(static_cast<uint8_t>(static_cast<int8_t>(value)));
+    }
+    inline size_t bytes() const
+    {
+        return _bytes + _pending.size();
+    }
+    inline void discard()
+    {
+        // The next save writes a new base world, the next flush starts a new log
+        _pending.clear();
+        _bytes = 0;
+    }
+    inline bool flush(const std::string &file_name, const size_t scale, const uint32_t base)
+    {
+        // Nothing edited since the last save
+        if (_pending.empty())
+        {
+            return true;
+        }
+
+        // Block of records with its count and checksum
+        std::vector<uint8_t> block;
+        block.reserve(_header + _pending.size() + 2 * sizeof(uint32_t));
+        if (_bytes == 0)
+        {
+            write_u32(block, _magic);
+            write_u32(block, _version);
+            write_u32(block, static_cast<uint32_t>(scale));
+            write_u32(block, base);
+        }
+        write_u32(block, static_cast<uint32_t>(_pending.size() / _record));
+        block.insert(block.end(), _pending.begin(), _pending.end());
+        write_u32(block, checksum(_pending.data(), _pending.size()));
+
+        // Start a new log or append to the current one
+        const std::ios::openmode mode = std::ios::out | std::ios::binary | ((_bytes == 0) ? std::ios::trunc : std::ios::app);
+        std::ofstream file(file_name, mode);
+        if (!file.is_open())
+        {
+            return false;
+        }
+        file.write(reinterpret_cast<const char *>(block.data()), block.size());
+        file.flush();
+        if (!file.good())
+        {
+            return false;
+        }
+
+        // The edits are now on disk
+        _bytes += block.size();
+        _pending.clear();
+
+        return true;
+    }
+    static inline void remove(const std::string &file_name)
+    {
+        // The base world now holds every edit
+        std::remove(file_name.c_str());
+        std::remove((file_name + ".old").c_str());
+    }
+    static inline void remove_sealed(const std::string &file_name)
+    {
+        // The base world now holds the sealed edits
+        std::remove((file_name + ".old").c_str());
+    }
+    template <typename F>
+    inline bool replay(const std::string &file_name, const size_t scale, const uint32_t base, const F &f)
+    {
+        // Edits sealed by an unfinished compaction come first
+        size_t old_bytes = 0;
+        const bool old = replay_file(file_name + ".old", scale, base, f, old_bytes);
+
+        // Then the current log
+        const bool current = replay_file(file_name, scale, base, f, _bytes);
+        _pending.clear();
+
+        // The journal can keep appending only if both logs were clean and the sealed log is gone
+        return old && current && old_bytes == 0;
+    }
+    inline void seal(const std::string &file_name)
+    {
+        // Flushes after this start a new log, the sealed log is removed once the base world holds it
+        std::rename(file_name.c_str(), (file_name + ".old").c_str());
+        _bytes = 0;
+    }
+    inline bool should_compact() const
+    {
+        return _bytes > _compact_bytes;
+    }
+};
+}
+
+#endif
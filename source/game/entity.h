@@ -0,0 +1,205 @@
+/* Copyright [2013-2018] [Aaron Springstroh, Minimal Graphics Library]
+
+This file is part of the Beyond Dying Skies.
+
+Beyond Dying Skies is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+Beyond Dying Skies is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with Beyond Dying Skies.  If not, see <http://www.gnu.org/licenses/>.
+*/
+#ifndef _BDS_ENTITY_BDS_
+#define _BDS_ENTITY_BDS_
+
+#include <array>
+#include <cstdint>
+#include <game/def.h>
+#include <game/static_instance.h>
+#include <min/vec3.h>
+#include <vector>
+
+namespace game
+{
+
+// Structure of array transforms of every entity kind, gathered once per frame for the shared systems
+class entity_store
+{
+  private:
+    static constexpr size_t _kinds = id_value(static_id::ASSET_SIZE) + 1;
+    static constexpr float _rotation_rate = 120.0;
+
+    // Entity components
+    std::vector<static_id> _kind;
+    std::vector<size_t> _inst;
+    std::vector<size_t> _body;
+    std::vector<uint_fast8_t> _still;
+    std::vector<float> _px;
+    std::vector<float> _py;
+    std::vector<float> _pz;
+    std::vector<float> _vx;
+    std::vector<float> _vy;
+    std::vector<float> _vz;
+
+    // Contiguous range of each kind
+    std::array<size_t, _kinds> _begin;
+    std::array<size_t, _kinds> _end;
+    float _angle;
+
+    static inline bool spins(const static_id kind)
+    {
+        return kind == static_id::DROP || kind == static_id::EXPLOSIVE;
+    }
+
+  public:
+    entity_store() : _angle(0.0)
+    {
+        clear();
+    }
+    inline void add(const static_id kind, const size_t inst_id, const size_t body_id, const bool still)
+    {
+        // Each kind must be added in one run
+        const size_t k = id_value(kind);
+        if (_begin[k] == _end[k])
+        {
+            _begin[k] = _kind.size();
+        }
+
+        // Add the entity, transforms are filled by load
+        _kind.push_back(kind);
+        _inst.push_back(inst_id);
+        _body.push_back(body_id);
+        _still.push_back(still);
+        _end[k] = _kind.size();
+    }
+    inline size_t begin(const static_id kind) const
+    {
+        return _begin[id_value(kind)];
+    }
+    inline void clear()
+    {
+        // Clear components and kind ranges
+        _kind.clear();
+        _inst.clear();
+        _body.clear();
+        _still.clear();
+        _px.clear();
+        _py.clear();
+        _pz.clear();
+        _vx.clear();
+        _vy.clear();
+        _vz.clear();
+        _begin.fill(0);
+        _end.fill(0);
+    }
+    inline size_t end(const static_id kind) const
+    {
+        return _end[id_value(kind)];
+    }
+    inline void load(physics &sim)
+    {
+        // Read every body transform in one pass
+        const size_t size = _body.size();
+        _px.resize(size);
+        _py.resize(size);
+        _pz.resize(size);
+        _vx.resize(size);
+        _vy.resize(size);
+        _vz.resize(size);
+        for (size_t i = 0; i < size; i++)
+        {
+            const min::body<float, min::vec3> &b = sim.get_body(_body[i]);
+            const min::vec3<float> &p = b.get_position();
+            const min::vec3<float> &v = b.get_linear_velocity();
+            _px[i] = p.x();
+            _py[i] = p.y();
+            _pz[i] = p.z();
+            _vx[i] = v.x();
+            _vy[i] = v.y();
+            _vz[i] = v.z();
+        }
+    }
+    inline min::vec3<float> position(const size_t i) const
+    {
+        return min::vec3<float>(_px[i], _py[i], _pz[i]);
+    }
+    inline void reserve(const size_t size)
+    {
+        _kind.reserve(size);
+        _inst.reserve(size);
+        _body.reserve(size);
+        _still.reserve(size);
+        _px.reserve(size);
+        _py.reserve(size);
+        _pz.reserve(size);
+        _vx.reserve(size);
+        _vy.reserve(size);
+        _vz.reserve(size);
+    }
+    inline void reset()
+    {
+        clear();
+        _angle = 0.0;
+    }
+    inline void rotate(static_instance &inst, const float dt)
+    {
+        // Update the shared rotation angle
+        _angle += _rotation_rate * dt;
+        if (_angle > 360.0)
+        {
+            _angle -= 360.0;
+        }
+
+        // Calculate quaternion around Y axis
+        const min::quat<float> q(min::vec3<float>::up(), _angle);
+
+        // Spin every moving instance of the spinning kinds, still entities keep their matrix clean
+        for (size_t k = 1; k < _kinds; k++)
+        {
+            const static_id kind = static_cast<static_id>(k);
+            if (spins(kind))
+            {
+                static_asset &asset = inst.get_asset(kind);
+                for (size_t i = _begin[k]; i < _end[k]; i++)
+                {
+                    if (!_still[i])
+                    {
+                        asset.update_rotation(_inst[i], q);
+                    }
+                }
+            }
+        }
+    }
+    inline size_t size() const
+    {
+        return _kind.size();
+    }
+    inline min::vec3<float> velocity(const size_t i) const
+    {
+        return min::vec3<float>(_vx[i], _vy[i], _vz[i]);
+    }
+    inline void write(static_instance &inst) const
+    {
+        // Write every instance translation, one kind range at a time, still entities keep their pinned matrix
+        for (size_t k = 1; k < _kinds; k++)
+        {
+            static_asset &asset = inst.get_asset(static_cast<static_id>(k));
+            for (size_t i = _begin[k]; i < _end[k]; i++)
+            {
+                if (!_still[i])
+                {
+                    asset.update_position(_inst[i], min::vec3<float>(_px[i], _py[i], _pz[i]));
+                }
+            }
+        }
+    }
+};
+}
+
+#endif
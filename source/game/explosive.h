@@ -19,7 +19,10 @@ along with Beyond Dying Skies.  If not, see <http://www.gnu.org/licenses/>.
 #define _BDS_EXPLOSIVE_BDS_
 
 #include <game/def.h>
+#include <game/entity.h>
 #include <game/id.h>
+#include <game/registry.h>
+#include <game/static_batch.h>
 #include <game/static_instance.h>
 #include <min/aabbox.h>
 #include <min/grid.h>
@@ -34,12 +37,11 @@ class explosive
 {
   private:
     size_t _body_id;
-    size_t _inst_id;
     block_id _atlas;
 
   public:
-    explosive(const size_t body_id, const size_t inst_id, const block_id atlas)
-        : _body_id(body_id), _inst_id(inst_id), _atlas(atlas) {}
+    explosive(const size_t body_id, const block_id atlas)
+        : _body_id(body_id), _atlas(atlas) {}
 
     inline block_id atlas() const
     {
@@ -49,26 +51,16 @@ class explosive
     {
         return _body_id;
     }
-    inline void dec_inst()
-    {
-        _inst_id--;
-    }
-    inline size_t inst_id() const
-    {
-        return _inst_id;
-    }
 };
 
 class explosives
 {
   private:
-    static constexpr float _rotation_rate = 120.0;
     physics *const _sim;
     static_instance *const _inst;
-    std::vector<std::pair<min::aabbox<float, min::vec3>, block_id>> _col_cells;
-    std::vector<explosive> _ex;
+    registry<explosive> _ex;
+    static_batch _batch;
     const min::tri<unsigned> _scale;
-    float _angle;
     coll_call _f;
     const std::string _str;
 
@@ -81,70 +73,64 @@ class explosives
         return _sim->get_body(_ex[index].body_id());
     }
     template <typename ES>
-    inline void explode(const size_t index, const block_id atlas, const ES &ex_scale_call)
+    inline void explode_at(const size_t index, const block_id atlas, const ES &ex_scale_call)
     {
         // Call the explosion callback function if available
-        ex_scale_call(position(index), _scale, atlas);
+        ex_scale_call(body(index).get_position(), _scale, atlas);
 
         // Blow up the grenade
-        explode(index);
+        remove_at(index);
     }
-    inline void remove(const size_t index)
+    inline void remove_at(const size_t index)
     {
-        // Clear explosives at index
-        _inst->get_explosive().clear(_ex[index].inst_id());
+        // Swap the last explosive and instance into this index
+        _inst->get_explosive().clear(index);
         _sim->clear_body(_ex[index].body_id());
-        _ex.erase(_ex.begin() + index);
-
-        // Adjust the remaining explosive indices
-        const size_t size = _ex.size();
-        for (size_t i = index; i < size; i++)
-        {
-            // Adjust the instance id
-            _ex[i].dec_inst();
-
-            // Adjust the body data index
-            body(i).set_data(min::body_data(i));
-        }
+        _ex.remove(index);
     }
     inline void reserve_memory()
     {
-        // Reserve space for collision cells
-        _col_cells.reserve(27);
+        // Reserve space for explosives
         _ex.reserve(static_instance::max_explosives());
+        _batch.reserve(static_instance::max_explosives());
     }
 
   public:
     explosives(physics &sim, static_instance &inst)
         : _sim(&sim), _inst(&inst),
-          _scale(3, 5, 3), _angle(0.0), _f(nullptr), _str("Explosive")
+          _scale(3, 5, 3), _f(nullptr), _str("Explosive")
     {
-        // Reserve memory for collision cells
+        // Reserve memory for explosives
         reserve_memory();
     }
     inline void reset()
     {
-        // Remove all the explosives backwards to preserve ex-instance id mapping
-        const size_t size = _ex.size();
-        for (size_t i = size; i-- != 0;)
+        // Clear all the bodies
+        for (const explosive &e : _ex)
         {
-            // Get the explosive
-            const explosive &e = _ex[i];
-
-            // Clear instance and body
-            _inst->get_explosive().clear(e.inst_id());
             _sim->clear_body(e.body_id());
         }
 
-        // Clear all the drops
+        // Clear all the explosives and instances at once
+        _inst->get_explosive().clear();
         _ex.clear();
-
-        // Reset the angle
-        _angle = 0.0;
     }
-    inline void explode(const size_t index)
+    inline void explode(const size_t id)
     {
-        remove(index);
+        // Ignore handles of explosives already removed
+        if (_ex.valid(id))
+        {
+            remove_at(_ex.index(id));
+        }
+    }
+    inline void gather(entity_store &es) const
+    {
+        // Add every explosive to the store, the explosive index is the instance id
+        const size_t size = _ex.size();
+        for (size_t i = 0; i < size; i++)
+        {
+            es.add(static_id::EXPLOSIVE, i, _ex[i].body_id(), false);
+        }
     }
     inline const min::tri<unsigned> &get_scale() const
     {
@@ -168,90 +154,74 @@ class explosives
         // Create a box for the explosive
         const min::aabbox<float, min::vec3> box = _inst->get_explosive().get_box(inst_id);
 
-        // Store the explosive index as body data
-        const size_t index = _ex.size();
-
         // Add to physics simulation
-        const size_t body_id = _sim->add_body(box, 10.0, id_value(static_id::EXPLOSIVE), index);
+        const size_t body_id = _sim->add_body(box, 10.0, id_value(static_id::EXPLOSIVE), 0);
 
         // Register player collision callback
         _sim->register_callback(body_id, _f);
 
+        // Create a new explosive
+        const size_t id = _ex.add(body_id, atlas);
+
         // Get the physics body for editing
         min::body<float, min::vec3> &body = _sim->get_body(body_id);
 
+        // Store the stable explosive handle as body data
+        body.set_data(min::body_data(id));
+
         // Set body linear velocity
         const min::vec3<float> lv = vel + (up * 5.0) + (dir * 20.0);
         body.set_linear_velocity(lv);
 
-        // Create a new explosive
-        _ex.emplace_back(body_id, inst_id, atlas);
-
         // Return launch success
         return true;
     }
-    inline const min::vec3<float> &position(const size_t index) const
-    {
-        // Return the explosive position
-        return body(index).get_position();
-    }
     inline void set_collision_callback(const coll_call &f)
     {
         _f = f;
     }
+    inline size_t size() const
+    {
+        return _ex.size();
+    }
     template <typename ES>
-    inline void update_frame(const cgrid &grid, const ES &ex_scale_call)
+    inline void update_frame(const cgrid &grid, const float dt, const ES &ex_scale_call)
     {
-        // Do explosive collisions
+        // Gather all explosives into the batch
+        _batch.clear();
         const size_t size = _ex.size();
+        const min::vec3<float> half = cgrid::explode_half_extent();
         for (size_t i = 0; i < size; i++)
         {
-            // Get all cells that could collide
-            grid.explosive_collision_cells(_col_cells, position(i));
-
-            // Solve static collisions
-            const size_t body = _ex[i].body_id();
-            for (const auto &cell : _col_cells)
-            {
-                if (_sim->collide(body, cell.first))
-                {
-                    // Explode the explosive
-                    explode(i, cell.second, ex_scale_call);
+            _batch.gather(*_sim, _ex[i].body_id(), half);
+        }
 
-                    // Decrement current index
-                    i--;
+        // Solve static collisions and write back the moved bodies
+        _batch.solve(grid, _elasticity);
+        _batch.scatter(*_sim);
 
-                    // Abort inner loop
-                    break;
-                }
-            }
-        }
-    }
-    inline void update(const cgrid &grid, const float dt)
-    {
-        // Update the explosive rotation angle
-        _angle += _rotation_rate * dt;
-        if (_angle > 360.0)
+        // Explode the explosives that hit, in reverse so the swapped in explosive was already tested
+        for (size_t i = size; i-- > 0;)
         {
-            _angle -= 360.0;
+            if (_batch.is_hit(i))
+            {
+                explode_at(i, _batch.first_atlas(i), ex_scale_call);
+            }
         }
 
-        // Calculate quaternion around Y axis
-        const min::quat<float> q(min::vec3<float>::up(), _angle);
-
-        // Update all explosive positions
-        const size_t size = _ex.size();
-        for (size_t i = 0; i < size; i++)
+        // Sweep the rest along this step so fast explosives can not skip thin walls
+        for (size_t i = _ex.size(); i-- > 0;)
         {
-            // Update the instance matrix
-            const size_t inst_id = _ex[i].inst_id();
-
-            // Update body positions
-            const min::vec3<float> &p = body(i).get_position();
-            _inst->get_explosive().update_position(inst_id, p);
-
-            // Update body rotations
-            _inst->get_explosive().update_rotation(inst_id, q);
+            float toi;
+            block_id atlas;
+            const min::vec3<float> p = body(i).get_position();
+            const min::vec3<float> d = body(i).get_linear_velocity() * dt;
+            if (grid.sweep(p, half, d, toi, atlas))
+            {
+                // Move to the time of impact and explode there
+                body(i).set_position(p + d * toi);
+                explode_at(i, atlas, ex_scale_call);
+            }
         }
     }
 };
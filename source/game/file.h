@@ -56,14 +56,29 @@ class file
 #define SAVE_WORLD      \
     TOSTRING(SAVE_PATH) \
     "/save/world."
+#define SAVE_JOURNAL    \
+    TOSTRING(SAVE_PATH) \
+    "/save/journal."
+#define SAVE_TRACE      \
+    TOSTRING(SAVE_PATH) \
+    "/save/trace.json"
+#define SAVE_FRAME_STATS \
+    TOSTRING(SAVE_PATH)  \
+    "/save/frame_stats.csv"
 #else
 #define SAVE_KEYMAP "save/keymap."
 #define SAVE_STATE "save/state."
 #define SAVE_WORLD "save/world."
+#define SAVE_JOURNAL "save/journal."
+#define SAVE_TRACE "save/trace.json"
+#define SAVE_FRAME_STATS "save/frame_stats.csv"
 #endif
 #define HOME_KEYMAP "/.bds-game/save/keymap."
 #define HOME_STATE "/.bds-game/save/state."
 #define HOME_WORLD "/.bds-game/save/world."
+#define HOME_JOURNAL "/.bds-game/save/journal."
+#define HOME_TRACE "/.bds-game/save/trace.json"
+#define HOME_FRAME_STATS "/.bds-game/save/frame_stats.csv"
     static std::ostringstream _ss;
     static inline void clear_stream()
     {
@@ -72,6 +87,38 @@ class file
     }
 
   public:
+    static inline std::string get_frame_stats_file()
+    {
+        clear_stream();
+        const char *home = std::getenv("HOME");
+        if (home == nullptr)
+        {
+            _ss << SAVE_FRAME_STATS;
+        }
+        else
+        {
+            _ss << home;
+            _ss << HOME_FRAME_STATS;
+        }
+        return _ss.str();
+    }
+    static inline std::string get_journal_file(const size_t save_slot)
+    {
+        clear_stream();
+        const char *home = std::getenv("HOME");
+        if (home == nullptr)
+        {
+            _ss << SAVE_JOURNAL;
+            _ss << save_slot;
+        }
+        else
+        {
+            _ss << home;
+            _ss << HOME_JOURNAL;
+            _ss << save_slot;
+        }
+        return _ss.str();
+    }
     static inline std::string get_keymap_file(const size_t save_slot)
     {
         clear_stream();
@@ -106,6 +153,21 @@ class file
         }
         return _ss.str();
     }
+    static inline std::string get_trace_file()
+    {
+        clear_stream();
+        const char *home = std::getenv("HOME");
+        if (home == nullptr)
+        {
+            _ss << SAVE_TRACE;
+        }
+        else
+        {
+            _ss << home;
+            _ss << HOME_TRACE;
+        }
+        return _ss.str();
+    }
     static inline std::string get_world_file(const size_t save_slot)
     {
         clear_stream();
@@ -139,14 +201,24 @@ class file
 
         return saved;
     }
+    static inline bool erase_journal(const size_t index)
+    {
+        // The sealed log only exists while a compaction is running
+        const std::string journal = get_journal_file(index);
+        std::remove((journal + ".old").c_str());
+
+        // Only report an erase if there was a journal
+        return exists_file(journal) && erase_file(journal);
+    }
     static inline bool erase_save(const size_t index)
     {
         const bool k = erase_file(get_keymap_file(index));
         const bool s = erase_file(get_state_file(index));
         const bool w = erase_file(get_world_file(index));
+        const bool j = erase_journal(index);
 
         // Did we delete any saves?
-        return k || s || w;
+        return k || s || w || j;
     }
     static inline bool exists_file(const std::string &file_name)
     {
@@ -180,6 +252,54 @@ class file
             std::cout << "file: could not load file '" << file_name << "'" << std::endl;
         }
     }
+    static inline bool replace_file(const std::string &file_name, const std::vector<uint8_t> &stream, std::string &error)
+    {
+        // Write a temporary file next to the target so a crash never leaves a partial file, never prints so any thread can call it
+        const std::string temp = file_name + ".tmp";
+        {
+            std::ofstream file(temp, std::ios::out | std::ios::binary);
+            if (!file.is_open())
+            {
+                error = "could not save file '" + temp + "'";
+                return false;
+            }
+
+            file.write(reinterpret_cast<const char *>(stream.data()), stream.size());
+            if (!file.good())
+            {
+                error = "could not write file '" + temp + "'";
+                return false;
+            }
+        }
+
+        // Swap in the new file, rename can't replace an existing file on every platform
+        if (std::rename(temp.c_str(), file_name.c_str()) != 0)
+        {
+            std::remove(file_name.c_str());
+            if (std::rename(temp.c_str(), file_name.c_str()) != 0)
+            {
+                error = "could not replace file '" + file_name + "'";
+                return false;
+            }
+        }
+
+        return true;
+    }
+    static inline bool replace_file(const std::string &file_name, const std::vector<uint8_t> &stream)
+    {
+        // Print diagnostic message
+        std::cout << "file: saving to " << file_name << std::endl;
+
+        // Replace the file and print why it failed
+        std::string error;
+        if (!replace_file(file_name, stream, error))
+        {
+            std::cout << "file: " << error << std::endl;
+            return false;
+        }
+
+        return true;
+    }
     static inline void save_file(const std::string &file_name, const std::vector<uint8_t> &stream)
     {
         // Save bytes to file
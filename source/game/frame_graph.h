@@ -0,0 +1,307 @@
+/* Copyright [2013-2018] [Aaron Springstroh, Minimal Graphics Library]
+
+This file is part of the Beyond Dying Skies.
+
+Beyond Dying Skies is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+Beyond Dying Skies is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with Beyond Dying Skies.  If not, see <http://www.gnu.org/licenses/>.
+*/
+#ifndef _BDS_FRAME_GRAPH_BDS_
+#define _BDS_FRAME_GRAPH_BDS_
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <functional>
+#include <game/profiler.h>
+#include <game/task_pool.h>
+#include <iomanip>
+#include <memory>
+#include <mutex>
+#include <ostream>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace game
+{
+
+class frame_node
+{
+  public:
+    std::string name;
+    std::function<void()> f;
+    std::vector<size_t> deps;
+    std::vector<size_t> next;
+    bool main;
+    double start;
+    double stop;
+
+    frame_node(const std::string &n, std::function<void()> &&func, const bool on_main)
+        : name(n), f(std::move(func)), main(on_main), start(0.0), stop(0.0) {}
+};
+
+// Per frame dependency graph, nodes run on the task pool as soon as their dependencies finish
+class frame_graph
+{
+  private:
+    typedef std::chrono::steady_clock clock;
+    std::vector<frame_node> _nodes;
+    std::unique_ptr<std::atomic<size_t>[]> _remain;
+    size_t _remain_size;
+    std::mutex _main_lock;
+    std::vector<size_t> _main_ready;
+    size_t _main_count;
+    clock::time_point _begin;
+    double _frame;
+
+    inline size_t add_node(const std::string &name, const std::vector<size_t> &deps, std::function<void()> &&f, const bool main)
+    {
+        // Dependencies must already exist, this keeps the nodes in topological order
+        const size_t index = _nodes.size();
+        for (const size_t d : deps)
+        {
+            if (d >= index)
+            {
+                throw std::runtime_error("frame_graph: dependency must be added before node '" + name + "'");
+            }
+        }
+
+        // Add the node and link it to its dependencies
+        _nodes.emplace_back(name, std::move(f), main);
+        _nodes.back().deps = deps;
+        for (const size_t d : deps)
+        {
+            _nodes[d].next.push_back(index);
+        }
+
+        // Count main thread nodes
+        if (main)
+        {
+            _main_count++;
+        }
+
+        return index;
+    }
+    inline double elapsed() const
+    {
+        return std::chrono::duration<double, std::milli>(clock::now() - _begin).count();
+    }
+    inline bool pop_main(size_t &index)
+    {
+        std::lock_guard<std::mutex> lock(_main_lock);
+        if (_main_ready.empty())
+        {
+            return false;
+        }
+
+        // Take the next ready main thread node
+        index = _main_ready.back();
+        _main_ready.pop_back();
+
+        return true;
+    }
+    inline void run_node(task_pool &pool, task_group &g, const size_t index)
+    {
+        frame_node &node = _nodes[index];
+
+        // Run the node and record timing
+        node.start = elapsed();
+        {
+            const profile_scope scope(node.name.c_str());
+            node.f();
+        }
+        node.stop = elapsed();
+
+        // Schedule dependents that are now ready
+        for (const size_t n : node.next)
+        {
+            if (_remain[n].fetch_sub(1, std::memory_order_acq_rel) == 1)
+            {
+                schedule(pool, g, n);
+            }
+        }
+    }
+    inline void schedule(task_pool &pool, task_group &g, const size_t index)
+    {
+        // Main thread nodes are handed back to the calling thread
+        if (_nodes[index].main)
+        {
+            std::lock_guard<std::mutex> lock(_main_lock);
+            _main_ready.push_back(index);
+        }
+        else
+        {
+            pool.spawn(g, [this, &pool, &g, index](std::mt19937 &gen) {
+                this->run_node(pool, g, index);
+            });
+        }
+    }
+
+  public:
+    frame_graph() : _remain_size(0), _main_count(0), _frame(0.0) {}
+
+    inline size_t add(const std::string &name, const std::vector<size_t> &deps, std::function<void()> &&f)
+    {
+        return add_node(name, deps, std::move(f), false);
+    }
+    inline size_t add_main(const std::string &name, const std::vector<size_t> &deps, std::function<void()> &&f)
+    {
+        return add_node(name, deps, std::move(f), true);
+    }
+    inline void clear()
+    {
+        _nodes.clear();
+        _main_count = 0;
+    }
+    inline void execute(task_pool &pool)
+    {
+        // Allocate dependency counters if the graph changed
+        const size_t size = _nodes.size();
+        if (_remain_size != size)
+        {
+            _remain.reset(new std::atomic<size_t>[size]);
+            _remain_size = size;
+        }
+
+        // Reset dependency counters
+        for (size_t i = 0; i < size; i++)
+        {
+            _remain[i].store(_nodes[i].deps.size(), std::memory_order_relaxed);
+        }
+        _main_ready.clear();
+
+        // Start the frame clock
+        _begin = clock::now();
+
+        // Schedule all root nodes
+        task_group g;
+        for (size_t i = 0; i < size; i++)
+        {
+            if (_nodes[i].deps.empty())
+            {
+                schedule(pool, g, i);
+            }
+        }
+
+        // Run main thread nodes as they become ready, help the pool otherwise
+        size_t main_left = _main_count;
+        while (main_left > 0)
+        {
+            size_t index;
+            if (pop_main(index))
+            {
+                run_node(pool, g, index);
+                main_left--;
+            }
+            else if (!pool.run_one())
+            {
+                std::this_thread::yield();
+            }
+        }
+
+        // Wait for the remaining pool nodes
+        pool.wait(g);
+
+        // Stop the frame clock
+        _frame = elapsed();
+    }
+    inline double critical_path(std::vector<size_t> &out) const
+    {
+        out.clear();
+
+        // Nothing to do
+        const size_t size = _nodes.size();
+        if (size == 0)
+        {
+            return 0.0;
+        }
+
+        // Longest path through measured node times, nodes are in topological order
+        std::vector<double> length(size, 0.0);
+        std::vector<size_t> prev(size, size);
+        size_t last = 0;
+        for (size_t i = 0; i < size; i++)
+        {
+            const frame_node &node = _nodes[i];
+            double longest = 0.0;
+            for (const size_t d : node.deps)
+            {
+                if (length[d] > longest)
+                {
+                    longest = length[d];
+                    prev[i] = d;
+                }
+            }
+            length[i] = longest + (node.stop - node.start);
+
+            // Track the end of the longest path
+            if (length[i] > length[last])
+            {
+                last = i;
+            }
+        }
+
+        // Walk the path backwards
+        for (size_t i = last; i != size; i = prev[i])
+        {
+            out.push_back(i);
+        }
+        std::reverse(out.begin(), out.end());
+
+        return length[last];
+    }
+    inline void dump(std::ostream &out) const
+    {
+        // Calculate the critical path
+        std::vector<size_t> path;
+        const double length = critical_path(path);
+
+        // Print the frame summary
+        out << std::fixed << std::setprecision(3);
+        out << "frame_graph: frame " << _frame << " ms, critical path " << length << " ms" << std::endl;
+
+        // Print the critical path
+        out << "  ";
+        const size_t size = path.size();
+        for (size_t i = 0; i < size; i++)
+        {
+            const frame_node &node = _nodes[path[i]];
+            out << node.name << " " << (node.stop - node.start);
+            if (i + 1 < size)
+            {
+                out << " -> ";
+            }
+        }
+        out << std::endl;
+
+        // Print the start and stop of every node
+        for (const frame_node &node : _nodes)
+        {
+            out << "    " << std::left << std::setw(10) << node.name << std::right
+                << " [" << node.start << ", " << node.stop << "]"
+                << (node.main ? " main" : "") << std::endl;
+        }
+    }
+    inline double frame_time() const
+    {
+        return _frame;
+    }
+    inline const std::vector<frame_node> &get_nodes() const
+    {
+        return _nodes;
+    }
+};
+}
+
+#endif
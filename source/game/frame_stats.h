@@ -0,0 +1,310 @@
+/* Copyright [2013-2018] [Aaron Springstroh, Minimal Graphics Library]
+
+This file is part of the Beyond Dying Skies.
+
+Beyond Dying Skies is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+Beyond Dying Skies is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with Beyond Dying Skies.  If not, see <http://www.gnu.org/licenses/>.
+*/
+#ifndef _BDS_FRAME_STATS_BDS_
+#define _BDS_FRAME_STATS_BDS_
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <fstream>
+#include <game/frame_graph.h>
+#include <iomanip>
+#include <iostream>
+#include <string>
+#include <vector>
+
+namespace game
+{
+
+class frame_summary
+{
+  public:
+    float p50;
+    float p95;
+    float p99;
+    float max;
+
+    frame_summary() : p50(0.0), p95(0.0), p99(0.0), max(0.0) {}
+};
+
+// Log linear histogram of microseconds over a rolling window, about 3% relative error
+class frame_histogram
+{
+  private:
+    static constexpr size_t _sub_bits = 5;
+    static constexpr size_t _sub = 1 << _sub_bits;
+    static constexpr size_t _buckets = (32 - _sub_bits + 1) * _sub;
+    std::vector<uint32_t> _counts;
+    std::vector<uint32_t> _window;
+    size_t _head;
+    size_t _size;
+
+    static inline size_t bucket(const uint32_t v)
+    {
+        // Values below two sub ranges map directly
+        if (v < 2 * _sub)
+        {
+            return v;
+        }
+
+        // Find the most significant bit
+        size_t msb = 0;
+        for (uint32_t t = v; t > 1; t >>= 1)
+        {
+            msb++;
+        }
+
+        // Keep the top bits of the value as the sub bucket
+        const size_t shift = msb - _sub_bits;
+        return (shift + 1) * _sub + ((v >> shift) - _sub);
+    }
+    static inline uint64_t bucket_value(const size_t b)
+    {
+        // Direct buckets
+        if (b < 2 * _sub)
+        {
+            return b;
+        }
+
+        // Upper bound of the bucket range
+        const size_t shift = b / _sub - 1;
+        const uint64_t m = (b % _sub) + _sub;
+        return ((m + 1) << shift) - 1;
+    }
+
+  public:
+    frame_histogram(const size_t window)
+        : _counts(_buckets, 0), _window(std::max(window, static_cast<size_t>(1)), 0), _head(0), _size(0) {}
+
+    inline void add(const float ms)
+    {
+        // Convert to microseconds, clamp to the histogram range
+        const double us = std::max(0.0, std::min(static_cast<double>(ms) * 1000.0, 4294967295.0));
+        const uint32_t v = static_cast<uint32_t>(us);
+
+        // Evict the oldest sample if the window is full
+        const size_t capacity = _window.size();
+        if (_size == capacity)
+        {
+            _counts[bucket(_window[_head])]--;
+        }
+        else
+        {
+            _size++;
+        }
+
+        // Add the new sample
+        _window[_head] = v;
+        _counts[bucket(v)]++;
+        _head = (_head + 1) % capacity;
+    }
+    inline size_t count() const
+    {
+        return _size;
+    }
+    inline frame_summary summary() const
+    {
+        frame_summary out;
+
+        // Nothing recorded
+        if (_size == 0)
+        {
+            return out;
+        }
+
+        // Scan the window once for the exact maximum
+        uint32_t max = 0;
+        for (size_t i = 0; i < _size; i++)
+        {
+            max = std::max(max, _window[i]);
+        }
+        out.max = max / 1000.0;
+
+        // Percentiles in ascending order, found in a single walk over the buckets
+        const double p[3] = {0.50, 0.95, 0.99};
+        float *const dest[3] = {&out.p50, &out.p95, &out.p99};
+        size_t next = 0;
+        size_t sum = 0;
+        for (size_t i = 0; i < _buckets && next < 3; i++)
+        {
+            sum += _counts[i];
+
+            // Bucket upper bound can overshoot the largest sample
+            const float value = std::min(static_cast<float>(bucket_value(i) / 1000.0), out.max);
+            while (next < 3 && sum >= std::max(static_cast<size_t>(std::ceil(p[next] * _size)), static_cast<size_t>(1)))
+            {
+                *dest[next++] = value;
+            }
+        }
+
+        // Ranks past the last bucket clamp to the maximum
+        for (; next < 3; next++)
+        {
+            *dest[next] = out.max;
+        }
+
+        return out;
+    }
+};
+
+class frame_tags
+{
+  public:
+    uint32_t chunks;
+    uint32_t insts;
+    uint32_t chests;
+    uint32_t drones;
+    uint32_t drops;
+    uint32_t explosives;
+    uint32_t missiles;
+};
+
+// Frame and frame graph node times over a rolling window, tagged with world size and entity counts
+class frame_stats
+{
+  private:
+    static constexpr size_t _frame = 0;
+    static constexpr size_t _update = 1;
+    const size_t _window;
+    const size_t _grid;
+    const size_t _chunk;
+    const size_t _view;
+    std::vector<std::string> _names;
+    std::vector<frame_histogram> _hist;
+    std::vector<float> _samples;
+    std::vector<frame_tags> _tags;
+    size_t _head;
+    size_t _size;
+
+    inline void add_series(const std::string &name)
+    {
+        _names.push_back(name);
+        _hist.emplace_back(_window);
+    }
+    inline void load_series(const frame_graph &graph)
+    {
+        // Frame time and graph time, then one series per graph node
+        add_series("frame");
+        add_series("update");
+        for (const frame_node &node : graph.get_nodes())
+        {
+            add_series(node.name);
+        }
+
+        // Reserve the sample ring
+        _samples.resize(_window * _names.size(), 0.0);
+        _tags.resize(_window);
+    }
+
+  public:
+    frame_stats(const size_t grid, const size_t chunk, const size_t view, const size_t window)
+        : _window(std::max(window, static_cast<size_t>(1))), _grid(grid), _chunk(chunk), _view(view), _head(0), _size(0) {}
+
+    inline void add(const float frame_ms, const frame_graph &graph, const frame_tags &tags)
+    {
+        // Create series on first sample
+        if (_names.empty())
+        {
+            load_series(graph);
+        }
+
+        // Record the frame and graph times
+        const size_t series = _names.size();
+        float *const sample = &_samples[_head * series];
+        sample[_frame] = frame_ms;
+        sample[_update] = graph.frame_time();
+
+        // Record each node time, the graph can't change shape after the first sample
+        const std::vector<frame_node> &nodes = graph.get_nodes();
+        const size_t size = std::min(nodes.size(), series - 2);
+        for (size_t i = 0; i < size; i++)
+        {
+            sample[i + 2] = nodes[i].stop - nodes[i].start;
+        }
+
+        // Add to the histograms
+        for (size_t i = 0; i < series; i++)
+        {
+            _hist[i].add(sample[i]);
+        }
+
+        // Tag the sample and advance the ring
+        _tags[_head] = tags;
+        _head = (_head + 1) % _window;
+        _size = std::min(_size + 1, _window);
+    }
+    inline frame_summary frame() const
+    {
+        return (_hist.size() > _frame) ? _hist[_frame].summary() : frame_summary();
+    }
+    inline frame_summary update() const
+    {
+        return (_hist.size() > _update) ? _hist[_update].summary() : frame_summary();
+    }
+    inline void save_csv(const std::string &file_name) const
+    {
+        std::ofstream file(file_name, std::ios::out);
+        if (!file.is_open())
+        {
+            std::cout << "frame_stats: could not save file '" << file_name << "'" << std::endl;
+            return;
+        }
+
+        // Print diagnostic message
+        std::cout << "frame_stats: saving to " << file_name << std::endl;
+
+        // Write the header
+        file << "sample";
+        for (const std::string &name : _names)
+        {
+            file << "," << name << "_ms";
+        }
+        file << ",grid,chunk,view,chunks,insts,chests,drones,drops,explosives,missiles" << std::endl;
+
+        // Write the window oldest first
+        file << std::fixed << std::setprecision(3);
+        const size_t series = _names.size();
+        const size_t start = (_size == _window) ? _head : 0;
+        for (size_t i = 0; i < _size; i++)
+        {
+            const size_t index = (start + i) % _window;
+            const float *const sample = &_samples[index * series];
+            const frame_tags &t = _tags[index];
+            file << i;
+            for (size_t j = 0; j < series; j++)
+            {
+                file << "," << sample[j];
+            }
+            file << "," << _grid << "," << _chunk << "," << _view
+                 << "," << t.chunks << "," << t.insts << "," << t.chests << "," << t.drones
+                 << "," << t.drops << "," << t.explosives << "," << t.missiles << std::endl;
+        }
+
+        // Print the percentiles of each series
+        for (size_t i = 0; i < series; i++)
+        {
+            const frame_summary s = _hist[i].summary();
+            std::cout << "frame_stats: " << _names[i]
+                      << " p50 " << s.p50 << " p95 " << s.p95
+                      << " p99 " << s.p99 << " max " << s.max << std::endl;
+        }
+    }
+};
+}
+
+#endif
@@ -0,0 +1,267 @@
+/* Copyright [2013-2018] [Aaron Springstroh, Minimal Graphics Library]
+
+This file is part of the Beyond Dying Skies.
+
+Beyond Dying Skies is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+Beyond Dying Skies is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with Beyond Dying Skies.  If not, see <http://www.gnu.org/licenses/>.
+*/
+#ifndef _BDS_FRUSTUM_CULL_BDS_
+#define _BDS_FRUSTUM_CULL_BDS_
+
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <game/simd.h>
+#include <limits>
+#include <min/aabbox.h>
+#include <min/camera.h>
+#include <min/vec3.h>
+#include <vector>
+
+namespace game
+{
+
+// Tests many boxes against the view frustum, boxes are stored as centers and half extents
+class frustum_cull
+{
+  private:
+    static constexpr size_t _planes = 6;
+
+    // Box centers and half extents, one array per axis
+    std::vector<float> _cx;
+    std::vector<float> _cy;
+    std::vector<float> _cz;
+    std::vector<float> _ex;
+    std::vector<float> _ey;
+    std::vector<float> _ez;
+    std::vector<size_t> _in;
+
+    // Inward plane normals and offsets, a point is inside if n.p + d >= 0
+    float _nx[_planes];
+    float _ny[_planes];
+    float _nz[_planes];
+    float _d[_planes];
+
+    // Box centers must also be within range of this point
+    float _rx;
+    float _ry;
+    float _rz;
+    float _range2;
+
+    inline void set_plane(const size_t i, const min::vec3<float> &n, const min::vec3<float> &p)
+    {
+        // Plane with normal n that passes through p
+        _nx[i] = n.x();
+        _ny[i] = n.y();
+        _nz[i] = n.z();
+        _d[i] = -n.dot(p);
+    }
+    inline bool inside(const size_t i) const
+    {
+        // Check center against view range
+        const float dx = _cx[i] - _rx;
+        const float dy = _cy[i] - _ry;
+        const float dz = _cz[i] - _rz;
+        bool out = (dx * dx + dy * dy + dz * dz) < _range2;
+
+        // Box is outside if the nearest corner is behind any plane
+        for (size_t j = 0; j < _planes; j++)
+        {
+            const float dist = (_nx[j] * _cx[i] + _ny[j] * _cy[i] + _nz[j] * _cz[i]) + _d[j];
+            const float r = (std::abs(_nx[j]) * _ex[i] + std::abs(_ny[j]) * _ey[i] + std::abs(_nz[j]) * _ez[i]);
+            out = out && (dist + r >= 0.0f);
+        }
+
+        return out;
+    }
+    inline void cull_scalar(const size_t begin)
+    {
+        // Test the remaining boxes one at a time
+        const size_t size = _cx.size();
+        for (size_t i = begin; i < size; i++)
+        {
+            if (inside(i))
+            {
+                _in.push_back(i);
+            }
+        }
+    }
+#ifdef BDS_AVX2
+    BDS_AVX2_TARGET inline size_t cull_avx2()
+    {
+        const __m256 zero = _mm256_setzero_ps();
+        const __m256 rx = _mm256_set1_ps(_rx);
+        const __m256 ry = _mm256_set1_ps(_ry);
+        const __m256 rz = _mm256_set1_ps(_rz);
+        const __m256 range2 = _mm256_set1_ps(_range2);
+
+        // Test eight boxes at a time
+        const size_t size = _cx.size();
+        size_t i = 0;
+        for (; i + 8 <= size; i += 8)
+        {
+            const __m256 cx = _mm256_loadu_ps(&_cx[i]);
+            const __m256 cy = _mm256_loadu_ps(&_cy[i]);
+            const __m256 cz = _mm256_loadu_ps(&_cz[i]);
+            const __m256 ex = _mm256_loadu_ps(&_ex[i]);
+            const __m256 ey = _mm256_loadu_ps(&_ey[i]);
+            const __m256 ez = _mm256_loadu_ps(&_ez[i]);
+
+            // Check centers against view range
+            const __m256 dx = _mm256_sub_ps(cx, rx);
+            const __m256 dy = _mm256_sub_ps(cy, ry);
+            const __m256 dz = _mm256_sub_ps(cz, rz);
+            const __m256 d2 = _mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(dx, dx), _mm256_mul_ps(dy, dy)), _mm256_mul_ps(dz, dz));
+            __m256 keep = _mm256_cmp_ps(d2, range2, _CMP_LT_OQ);
+
+            // Same plane test as the scalar path
+            for (size_t j = 0; j < _planes; j++)
+            {
+                const __m256 nx = _mm256_set1_ps(_nx[j]);
+                const __m256 ny = _mm256_set1_ps(_ny[j]);
+                const __m256 nz = _mm256_set1_ps(_nz[j]);
+                const __m256 ax = _mm256_set1_ps(std::abs(_nx[j]));
+                const __m256 ay = _mm256_set1_ps(std::abs(_ny[j]));
+                const __m256 az = _mm256_set1_ps(std::abs(_nz[j]));
+                const __m256 dot = _mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(nx, cx), _mm256_mul_ps(ny, cy)), _mm256_mul_ps(nz, cz));
+                const __m256 dist = _mm256_add_ps(dot, _mm256_set1_ps(_d[j]));
+                const __m256 r = _mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(ax, ex), _mm256_mul_ps(ay, ey)), _mm256_mul_ps(az, ez));
+                keep = _mm256_and_ps(keep, _mm256_cmp_ps(_mm256_add_ps(dist, r), zero, _CMP_GE_OQ));
+            }
+
+            // Compact the surviving lanes into the output list
+            const int mask = _mm256_movemask_ps(keep);
+            if (mask != 0)
+            {
+                for (size_t k = 0; k < 8; k++)
+                {
+                    if (mask & (1 << k))
+                    {
+                        _in.push_back(i + k);
+                    }
+                }
+            }
+        }
+
+        return i;
+    }
+#endif
+
+  public:
+    frustum_cull()
+        : _nx{}, _ny{}, _nz{}, _d{}, _rx(0.0), _ry(0.0), _rz(0.0), _range2(std::numeric_limits<float>::max()) {}
+
+    inline void add(const min::aabbox<float, min::vec3> &box)
+    {
+        const min::vec3<float> c = box.get_center();
+        const min::vec3<float> e = (box.get_max() - box.get_min()) * 0.5;
+        _cx.push_back(c.x());
+        _cy.push_back(c.y());
+        _cz.push_back(c.z());
+        _ex.push_back(e.x());
+        _ey.push_back(e.y());
+        _ez.push_back(e.z());
+    }
+    inline void clear()
+    {
+        _cx.clear();
+        _cy.clear();
+        _cz.clear();
+        _ex.clear();
+        _ey.clear();
+        _ez.clear();
+        _in.clear();
+    }
+    inline const std::vector<size_t> &cull()
+    {
+        _in.clear();
+
+        // Vector path for whole groups of eight if the CPU has AVX2, scalar path for the rest
+#ifdef BDS_AVX2
+        cull_scalar(simd::avx2() ? cull_avx2() : 0);
+#else
+        cull_scalar(0);
+#endif
+
+        // Indices of the boxes inside, in ascending order
+        return _in;
+    }
+    inline const std::vector<size_t> &cull_scalar()
+    {
+        _in.clear();
+        cull_scalar(0);
+
+        return _in;
+    }
+    inline void clear_range()
+    {
+        _range2 = std::numeric_limits<float>::max();
+    }
+    inline size_t memory_reserved() const
+    {
+        return (_cx.capacity() + _cy.capacity() + _cz.capacity() + _ex.capacity() + _ey.capacity() + _ez.capacity()) * sizeof(float) + _in.capacity() * sizeof(size_t);
+    }
+    inline size_t memory_resident() const
+    {
+        return (_cx.size() + _cy.size() + _cz.size() + _ex.size() + _ey.size() + _ez.size()) * sizeof(float) + _in.size() * sizeof(size_t);
+    }
+    inline void reserve(const size_t size)
+    {
+        _cx.reserve(size);
+        _cy.reserve(size);
+        _cz.reserve(size);
+        _ex.reserve(size);
+        _ey.reserve(size);
+        _ez.reserve(size);
+        _in.reserve(size);
+    }
+    inline void set_camera(const min::camera<float> &cam)
+    {
+        const min::frustum<float> &f = cam.get_frustum();
+
+        // Widen both half angles so the planes hold whether the fov is vertical or horizontal
+        const float t = std::tan(f.get_fov() * 0.00872664626);
+        const float aspect = f.get_aspect_ratio();
+        const float th = t * std::max(1.0f, aspect);
+        const float tv = t * std::max(1.0f, 1.0f / aspect);
+
+        // The near plane is put at the eye so nothing in front of the camera is lost
+        set_view(cam.get_position(), cam.get_forward(), cam.get_up(), cam.get_right(), th, tv, 0.0, f.get_far());
+    }
+    inline void set_range(const min::vec3<float> &p, const float range)
+    {
+        _rx = p.x();
+        _ry = p.y();
+        _rz = p.z();
+        _range2 = range * range;
+    }
+    inline void set_view(const min::vec3<float> &eye, const min::vec3<float> &forward, const min::vec3<float> &up, const min::vec3<float> &right, const float tan_h, const float tan_v, const float near_dist, const float far_dist)
+    {
+        // Near and far planes
+        set_plane(0, forward, eye + forward * near_dist);
+        set_plane(1, forward * -1.0, eye + forward * far_dist);
+
+        // Side planes pass through the eye, normals face the view axis
+        set_plane(2, forward * tan_h - right, eye);
+        set_plane(3, forward * tan_h + right, eye);
+        set_plane(4, forward * tan_v - up, eye);
+        set_plane(5, forward * tan_v + up, eye);
+    }
+    inline size_t size() const
+    {
+        return _cx.size();
+    }
+};
+}
+
+#endif
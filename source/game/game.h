@@ -22,6 +22,7 @@ along with Beyond Dying Skies.  If not, see <http://www.gnu.org/licenses/>.
 #include <game/def.h>
 #include <game/events.h>
 #include <game/keymap.h>
+#include <game/memory_report.h>
 #include <game/options.h>
 #include <game/particle.h>
 #include <game/sound.h>
@@ -66,6 +67,7 @@ class bds
     std::pair<uint_fast16_t, uint_fast16_t> _cursor;
     double _fps;
     double _idle;
+    game::memory_report _mem;
 
     void center_cursor()
     {
@@ -114,7 +116,7 @@ class bds
         _ui.text().set_debug_title("Beyond Dying Skies: Official Demo");
         _ui.text().set_debug_vendor(vendor);
         _ui.text().set_debug_renderer(render);
-        _ui.text().set_debug_version("VERSION: 0.1.314");
+        _ui.text().set_debug_version(std::string("VERSION: ") + game::_game_version);
     }
     void load_game_mode()
     {
@@ -223,6 +225,9 @@ class bds
         const float energy = stat.get_energy();
         const size_t chunks = _world.get_chunks_in_view();
         const size_t insts = _world.get_inst_in_view();
+        const game::frame_stats &frame_stats = _world.get_frame_stats();
+        const size_t asleep = _world.get_drops().asleep();
+        const size_t awake = _world.get_drops().size() - asleep;
 
         // Check if player gave damage
         if (stat.is_crit())
@@ -252,6 +257,9 @@ class bds
             stat.clear_took_dmg();
         }
 
+        // Show the progress of a background save
+        _ui.set_alert_save(_world.save_progress(), _world.save_failed());
+
         // Get the target info
         const auto info = _world.get_target_info(play.get_target());
 
@@ -260,7 +268,7 @@ class bds
         _ui.set_draw_timer((time > 0.0) && !_ui.is_focused());
 
         // Update the ui overlay, process timer and upload changes
-        _ui.update(p, f, health, energy, _fps, _idle, chunks, insts, *info.first, time, dt);
+        _ui.update(p, f, health, energy, _fps, _idle, chunks, insts, frame_stats.frame(), frame_stats.update(), _mem, awake, asleep, *info.first, time, dt);
     }
     void update_uniforms(min::camera<float> &camera, const bool update_bones)
     {
@@ -283,13 +291,22 @@ class bds
         // Update ui matrices
         _uniforms.update_ui(_ui.get_scale(), _ui.get_uv());
 
-        // Update drone and missile matrices
+        // Update the changed instance matrices
         const game::static_instance &instance = _world.get_instance();
-        _uniforms.update_chests(instance.get_chest().get_out_matrix());
-        _uniforms.update_drones(instance.get_drone().get_out_matrix());
-        _uniforms.update_drops(instance.get_drop().get_out_matrix());
-        _uniforms.update_explosives(instance.get_explosive().get_out_matrix());
-        _uniforms.update_missiles(instance.get_missile().get_out_matrix());
+        const game::static_asset &chest = instance.get_chest();
+        const game::static_asset &drone = instance.get_drone();
+        const game::static_asset &drop = instance.get_drop();
+        const game::static_asset &explosive = instance.get_explosive();
+        const game::static_asset &missile = instance.get_missile();
+        _uniforms.update_chests(chest.get_out_matrix(), chest.get_out_begin(), chest.get_out_end());
+        _uniforms.update_drones(drone.get_out_matrix(), drone.get_out_begin(), drone.get_out_end());
+        _uniforms.update_drops(drop.get_out_matrix(), drop.get_out_begin(), drop.get_out_end());
+        _uniforms.update_explosives(explosive.get_out_matrix(), explosive.get_out_begin(), explosive.get_out_end());
+        _uniforms.update_missiles(missile.get_out_matrix(), missile.get_out_begin(), missile.get_out_end());
+
+        // Record the instance matrix bytes staged for upload
+        const size_t staged = chest.get_out_changed() + drone.get_out_changed() + drop.get_out_changed() + explosive.get_out_changed() + missile.get_out_changed();
+        game::profiler::counter("uniforms::instance_bytes", staged * sizeof(min::mat4<float>));
 
         // Update md5 model bones
         if (update_bones)
@@ -323,11 +340,14 @@ class bds
         min::settings::enable_gamma_correction();
 
         // Delete the mem-file data
-        game::memory_map::memory.clear();
+        game::memory_map::clear();
 
         // Load GPU info
         load_gpu_info();
 
+        // Collect the initial memory report
+        update_memory();
+
         // Show the window
         _win.show();
     }
@@ -418,6 +438,9 @@ class bds
     }
     void title_screen_enable()
     {
+        // Finish a background save before the title can load or erase it
+        _world.save_wait();
+
         // Reset the game state
         _title.enable();
 
@@ -554,10 +577,31 @@ class bds
         _fps = fps;
         _idle = idle;
     }
+    void save_frame_stats() const
+    {
+        _world.get_frame_stats().save_csv(game::file::get_frame_stats_file());
+    }
+    void print_memory()
+    {
+        // Refresh and print the memory report
+        update_memory();
+        _mem.print(std::cout);
+    }
+    void update_memory()
+    {
+        // Collect memory usage of all subsystems
+        _mem.clear();
+        _world.memory(_mem);
+        _sound.memory(_mem);
+        game::memory_map::report(_mem);
+    }
     void update_second()
     {
         // Update the events
         _events.update_second(_world);
+
+        // Update the memory report
+        update_memory();
     }
     void update_window()
     {
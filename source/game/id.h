@@ -205,6 +205,22 @@ inline static constexpr item_id id_from_atlas(const block_id id)
     return static_cast<item_id>(id_value(id) + 17);
 }
 
+enum class static_id : size_t
+{
+    PLAYER = 0,
+    CHEST = 1,
+    DRONE = 2,
+    DROP = 3,
+    EXPLOSIVE = 4,
+    MISSILE = 5,
+    ASSET_SIZE = MISSILE
+};
+
+inline constexpr size_t id_value(const static_id id)
+{
+    return static_cast<size_t>(id);
+}
+
 enum class ui_type
 {
     store,
@@ -226,6 +226,7 @@ class load_state
                 // Erase previous save files
                 file::erase_file(state);
                 file::erase_file(world);
+                file::erase_journal(slot);
 
                 // Did not load the state
                 return false;
@@ -336,12 +337,10 @@ class load_state
         // We loaded the state
         return true;
     }
-    inline void save(const options &opt)
+    inline void serialize(const options &opt, std::vector<uint8_t> &stream) const
     {
-        // Create output stream for saving world
-        std::vector<uint8_t> stream;
-
-        // Cache the file size
+        // Cache the file size, the grid writes the stream with the world it matches
+        stream.clear();
         stream.reserve(438);
 
         // Write the grid size into stream
@@ -404,9 +403,6 @@ class load_state
             // !!! - Undo chest adjustment, in world.h - !!!!
             min::write_le_vec3<float>(stream, min::vec3<float>(p.x(), p.y() + 1.0, p.z()));
         }
-
-        // Write data to file
-        file::save_file(file::get_state_file(opt.get_save_slot()), stream);
     }
     inline void set_state(const min::vec3<float> &p, const min::camera<float> &camera, const inventory &inv, const stats &stat, const static_instance &si)
     {
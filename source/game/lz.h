@@ -0,0 +1,199 @@
+/* Copyright [2013-2018] [Aaron Springstroh, Minimal Graphics Library]
+
+This file is part of the Beyond Dying Skies.
+
+Beyond Dying Skies is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+Beyond Dying Skies is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with Beyond Dying Skies.  If not, see <http://www.gnu.org/licenses/>.
+*/
+#ifndef _BDS_LZ_BDS_
+#define _BDS_LZ_BDS_
+
+#include <cstdint>
+#include <cstring>
+#include <vector>
+
+namespace game
+{
+
+// Byte oriented LZ77 codec in the LZ4 style, sequences of literals and back references
+class lz
+{
+  private:
+    static constexpr size_t _min_match = 4;
+    static constexpr size_t _max_offset = 65535;
+    static constexpr size_t _max_bits = 12;
+
+    static inline uint32_t read32(const uint8_t *const p)
+    {
+        uint32_t out;
+        std::memcpy(&out, p, sizeof(uint32_t));
+        return out;
+    }
+    static inline void write_length(std::vector<uint8_t> &out, size_t length)
+    {
+        // Lengths past the token nibble continue in bytes of 255
+        while (length >= 255)
+        {
+            out.push_back(255);
+            length -= 255;
+        }
+        out.push_back(static_cast<uint8_t>(length));
+    }
+    static inline bool read_length(const uint8_t *&in, const uint8_t *const end, size_t &length)
+    {
+        uint8_t b = 255;
+        while (b == 255)
+        {
+            if (in == end)
+            {
+                return false;
+            }
+            b = *in++;
+            length += b;
+        }
+
+        return true;
+    }
+    static inline void write_sequence(std::vector<uint8_t> &out, const uint8_t *const literal, const size_t literals, const size_t offset, const size_t match)
+    {
+        // Token holds the literal count and the match length past the minimum
+        const size_t extra = (match > 0) ? match - _min_match : 0;
+        const uint8_t high = static_cast<uint8_t>((literals < 15) ? literals : 15);
+        const uint8_t low = static_cast<uint8_t>((extra < 15) ? extra : 15);
+        out.push_back(static_cast<uint8_t>((high << 4) | low));
+        if (high == 15)
+        {
+            write_length(out, literals - 15);
+        }
+
+        // Copy the literals
+        out.insert(out.end(), literal, literal + literals);
+
+        // The last sequence has no match
+        if (match > 0)
+        {
+            out.push_back(static_cast<uint8_t>(offset & 0xFF));
+            out.push_back(static_cast<uint8_t>(offset >> 8));
+            if (low == 15)
+            {
+                write_length(out, extra - 15);
+            }
+        }
+    }
+
+  public:
+    static inline void compress(const uint8_t *const in, const size_t size, std::vector<uint8_t> &out)
+    {
+        // Hash table of recent positions plus one, sized to the input
+        size_t bits = 4;
+        while (bits < _max_bits && (static_cast<size_t>(1) << bits) < size)
+        {
+            bits++;
+        }
+        uint32_t table[1 << _max_bits];
+        std::memset(table, 0, sizeof(uint32_t) << bits);
+
+        // Greedy match on four byte sequences
+        size_t anchor = 0;
+        size_t i = 0;
+        while (i + _min_match <= size)
+        {
+            const uint32_t seq = read32(in + i);
+            const size_t h = (seq * 2654435761u) >> (32 - bits);
+            const size_t prev = table[h];
+            table[h] = static_cast<uint32_t>(i + 1);
+
+            // Extend the match if the candidate is in range and equal
+            if (prev > 0 && i - (prev - 1) <= _max_offset && read32(in + prev - 1) == seq)
+            {
+                const size_t from = prev - 1;
+                size_t match = _min_match;
+                while (i + match < size && in[from + match] == in[i + match])
+                {
+                    match++;
+                }
+
+                write_sequence(out, in + anchor, i - anchor, i - from, match);
+                i += match;
+                anchor = i;
+            }
+            else
+            {
+                i++;
+            }
+        }
+
+        // Flush the remaining literals
+        write_sequence(out, in + anchor, size - anchor, 0, 0);
+    }
+    static inline bool decompress(const uint8_t *in, const size_t size, uint8_t *const out, const size_t out_size)
+    {
+        const uint8_t *const end = in + size;
+        size_t o = 0;
+        while (in < end)
+        {
+            // Read the token and literal count
+            const uint8_t token = *in++;
+            size_t literals = token >> 4;
+            if (literals == 15 && !read_length(in, end, literals))
+            {
+                return false;
+            }
+
+            // Copy the literals
+            if (literals > static_cast<size_t>(end - in) || literals > out_size - o)
+            {
+                return false;
+            }
+            std::memcpy(out + o, in, literals);
+            in += literals;
+            o += literals;
+
+            // The last sequence ends with its literals
+            if (in == end)
+            {
+                break;
+            }
+
+            // Read the match offset and length
+            if (end - in < 2)
+            {
+                return false;
+            }
+            const size_t offset = in[0] | (static_cast<size_t>(in[1]) << 8);
+            in += 2;
+            size_t match = token & 0xF;
+            if (match == 15 && !read_length(in, end, match))
+            {
+                return false;
+            }
+            match += _min_match;
+
+            // Copy byte by byte since the match may overlap itself
+            if (offset == 0 || offset > o || match > out_size - o)
+            {
+                return false;
+            }
+            for (size_t j = 0; j < match; j++, o++)
+            {
+                out[o] = out[o - offset];
+            }
+        }
+
+        // The whole output must be filled
+        return o == out_size;
+    }
+};
+}
+
+#endif
@@ -0,0 +1,162 @@
+/* Copyright [2013-2018] [Aaron Springstroh, Minimal Graphics Library]
+
+This file is part of the Beyond Dying Skies.
+
+Beyond Dying Skies is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+Beyond Dying Skies is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with Beyond Dying Skies.  If not, see <http://www.gnu.org/licenses/>.
+*/
+#ifndef _BDS_MAPPED_FILE_BDS_
+#define _BDS_MAPPED_FILE_BDS_
+
+#include <cstdint>
+#include <iostream>
+#include <string>
+
+#if defined(_WIN32)
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace game
+{
+
+// Read only view of a whole file, pages are read on first touch instead of copied into a buffer
+class mapped_file
+{
+  private:
+    const uint8_t *_data;
+    size_t _size;
+#if defined(_WIN32)
+    HANDLE _file;
+    HANDLE _map;
+#else
+    int _fd;
+#endif
+
+    inline void map(const std::string &file_name)
+    {
+#if defined(_WIN32)
+        // Open the file and map a view of all of it
+        _file = CreateFileA(file_name.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+        if (_file == INVALID_HANDLE_VALUE)
+        {
+            return;
+        }
+        LARGE_INTEGER size;
+        if (!GetFileSizeEx(_file, &size) || size.QuadPart == 0)
+        {
+            return;
+        }
+        _map = CreateFileMappingA(_file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+        if (_map == nullptr)
+        {
+            return;
+        }
+        const void *const view = MapViewOfFile(_map, FILE_MAP_READ, 0, 0, 0);
+        if (view == nullptr)
+        {
+            return;
+        }
+        _size = static_cast<size_t>(size.QuadPart);
+#else
+        // Open the file and map all of it
+        _fd = open(file_name.c_str(), O_RDONLY);
+        if (_fd < 0)
+        {
+            return;
+        }
+        struct stat st;
+        if (fstat(_fd, &st) != 0 || st.st_size == 0)
+        {
+            return;
+        }
+        void *const view = mmap(nullptr, st.st_size, PROT_READ, MAP_PRIVATE, _fd, 0);
+        if (view == MAP_FAILED)
+        {
+            return;
+        }
+
+        // The world is decoded front to back once
+        madvise(view, st.st_size, MADV_SEQUENTIAL);
+        _size = static_cast<size_t>(st.st_size);
+#endif
+        _data = static_cast<const uint8_t *>(view);
+    }
+    inline void unmap()
+    {
+#if defined(_WIN32)
+        if (_data)
+        {
+            UnmapViewOfFile(_data);
+        }
+        if (_map != nullptr)
+        {
+            CloseHandle(_map);
+        }
+        if (_file != INVALID_HANDLE_VALUE)
+        {
+            CloseHandle(_file);
+        }
+#else
+        if (_data)
+        {
+            munmap(const_cast<uint8_t *>(_data), _size);
+        }
+        if (_fd >= 0)
+        {
+            close(_fd);
+        }
+#endif
+    }
+
+  public:
+    mapped_file(const std::string &file_name)
+        : _data(nullptr), _size(0),
+#if defined(_WIN32)
+          _file(INVALID_HANDLE_VALUE), _map(nullptr)
+#else
+          _fd(-1)
+#endif
+    {
+        map(file_name);
+        if (!_data)
+        {
+            std::cout << "file: could not map file '" << file_name << "'" << std::endl;
+        }
+    }
+    ~mapped_file()
+    {
+        unmap();
+    }
+    mapped_file(const mapped_file &) = delete;
+    mapped_file &operator=(const mapped_file &) = delete;
+
+    inline const uint8_t *data() const
+    {
+        return _data;
+    }
+    inline size_t size() const
+    {
+        return _size;
+    }
+};
+}
+
+#endif
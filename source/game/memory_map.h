@@ -18,7 +18,9 @@ along with Beyond Dying Skies.  If not, see <http://www.gnu.org/licenses/>.
 #ifndef _BDS_MEMORY_MAP_BDS_
 #define _BDS_MEMORY_MAP_BDS_
 
+#include <fstream>
 #include <game/file.h>
+#include <game/memory_report.h>
 #include <min/mem_chunk.h>
 namespace game
 {
@@ -26,12 +28,38 @@ namespace game
 // Global memory chunk to load all game data
 class memory_map
 {
+  private:
+    static size_t _size;
+    static bool _mapped;
+
+    static inline size_t data_size()
+    {
+        // Size of the data file, read once when it is mapped
+        std::ifstream file(DATA_FILE, std::ios::in | std::ios::binary | std::ios::ate);
+        return (file.is_open()) ? static_cast<size_t>(file.tellg()) : 0;
+    }
+
   public:
     static min::mem_chunk memory;
+
+    static inline void clear()
+    {
+        // Unmap the data file once all assets are loaded
+        memory.clear();
+        _mapped = false;
+    }
+    static inline void report(memory_report &report)
+    {
+        // The data file only counts while mapped, it is unmapped once assets load
+        const size_t size = (_mapped) ? _size : 0;
+        report.add("memory_map::data", size, size);
+    }
 };
 
-// Load the memory mapped file
+// Load the memory mapped file and record its size
 min::mem_chunk memory_map::memory(DATA_FILE);
+size_t memory_map::_size = memory_map::data_size();
+bool memory_map::_mapped = true;
 }
 
 #endif
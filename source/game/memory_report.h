@@ -0,0 +1,311 @@
+/* Copyright [2013-2018] [Aaron Springstroh, Minimal Graphics Library]
+
+This file is part of the Beyond Dying Skies.
+
+Beyond Dying Skies is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+Beyond Dying Skies is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with Beyond Dying Skies.  If not, see <http://www.gnu.org/licenses/>.
+*/
+#ifndef _BDS_MEMORY_REPORT_BDS_
+#define _BDS_MEMORY_REPORT_BDS_
+
+#include <array>
+#include <atomic>
+#include <cstdint>
+#include <cstdlib>
+#include <iomanip>
+#include <new>
+#include <ostream>
+#include <string>
+#include <vector>
+
+namespace game
+{
+
+enum class mem_tag : uint_fast8_t
+{
+    OTHER = 0,
+    GRID = 1,
+    GENERATOR = 2,
+    MESH = 3,
+    TERRAIN = 4,
+    INSTANCE = 5,
+    SOUND = 6,
+    PHYSICS = 7
+};
+
+inline constexpr uint_fast8_t id_value(const mem_tag id)
+{
+    return static_cast<uint_fast8_t>(id);
+}
+
+// Heap bytes attributed to the tag that was active on the allocating thread
+class memory_track
+{
+  private:
+    static constexpr size_t _tags = 8;
+    static std::array<std::atomic<int64_t>, _tags> _bytes;
+    static inline uint_fast8_t &local_tag()
+    {
+        static thread_local uint_fast8_t tag = 0;
+        return tag;
+    }
+
+  public:
+    static inline void add(const uint_fast8_t tag, const size_t size)
+    {
+        _bytes[tag].fetch_add(size, std::memory_order_relaxed);
+    }
+    static inline int64_t bytes(const mem_tag tag)
+    {
+        return _bytes[id_value(tag)].load(std::memory_order_relaxed);
+    }
+    static inline bool enabled()
+    {
+#ifdef BDS_TRACK_ALLOC
+        return true;
+#else
+        return false;
+#endif
+    }
+    static inline const char *name(const mem_tag tag)
+    {
+        static const char *names[_tags] = {"other", "grid", "generator", "mesh", "terrain", "instance", "sound", "physics"};
+        return names[id_value(tag)];
+    }
+    static inline void remove(const uint_fast8_t tag, const size_t size)
+    {
+        _bytes[tag].fetch_sub(size, std::memory_order_relaxed);
+    }
+    static inline uint_fast8_t get_tag()
+    {
+        return local_tag();
+    }
+    static inline void set_tag(const uint_fast8_t tag)
+    {
+        local_tag() = tag;
+    }
+    static inline size_t tags()
+    {
+        return _tags;
+    }
+};
+
+std::array<std::atomic<int64_t>, memory_track::_tags> memory_track::_bytes;
+
+// Attributes heap growth on this thread to a subsystem while in scope
+class memory_scope
+{
+  private:
+    const uint_fast8_t _prev;
+
+  public:
+    memory_scope(const mem_tag tag) : _prev(memory_track::get_tag())
+    {
+        memory_track::set_tag(id_value(tag));
+    }
+    ~memory_scope()
+    {
+        memory_track::set_tag(_prev);
+    }
+    memory_scope(const memory_scope &) = delete;
+    memory_scope &operator=(const memory_scope &) = delete;
+};
+
+class memory_usage
+{
+  public:
+    std::string name;
+    size_t resident;
+    size_t reserved;
+
+    memory_usage(const std::string &n, const size_t res, const size_t rsv)
+        : name(n), resident(res), reserved(rsv) {}
+};
+
+// Resident and reserved bytes reported by each subsystem
+class memory_report
+{
+  private:
+    std::vector<memory_usage> _usage;
+
+  public:
+    template <typename T>
+    static inline size_t bytes(const std::vector<T> &v)
+    {
+        return v.size() * sizeof(T);
+    }
+    template <typename T>
+    static inline size_t reserved(const std::vector<T> &v)
+    {
+        return v.capacity() * sizeof(T);
+    }
+
+    inline void add(const std::string &name, const size_t resident, const size_t reserved)
+    {
+        _usage.emplace_back(name, resident, reserved);
+    }
+    template <typename T>
+    inline void add(const std::string &name, const std::vector<T> &v)
+    {
+        _usage.emplace_back(name, bytes(v), reserved(v));
+    }
+    inline void clear()
+    {
+        _usage.clear();
+    }
+    inline const std::vector<memory_usage> &get_usage() const
+    {
+        return _usage;
+    }
+    inline void print(std::ostream &out) const
+    {
+        const double mb = 1.0 / (1024.0 * 1024.0);
+        out << std::fixed << std::setprecision(2);
+        out << "memory: " << std::left << std::setw(32) << "subsystem" << std::right
+            << std::setw(12) << "resident MB" << std::setw(12) << "reserved MB" << std::endl;
+
+        // Print each subsystem
+        for (const memory_usage &u : _usage)
+        {
+            out << "memory: " << std::left << std::setw(32) << u.name << std::right
+                << std::setw(12) << u.resident * mb << std::setw(12) << u.reserved * mb << std::endl;
+        }
+
+        // Print the totals
+        out << "memory: " << std::left << std::setw(32) << "total" << std::right
+            << std::setw(12) << resident() * mb << std::setw(12) << reserved() * mb << std::endl;
+
+        // Print the tracked heap if enabled
+        if (memory_track::enabled())
+        {
+            const size_t size = memory_track::tags();
+            for (size_t i = 0; i < size; i++)
+            {
+                const mem_tag tag = static_cast<mem_tag>(i);
+                out << "memory: heap " << std::left << std::setw(27) << memory_track::name(tag) << std::right
+                    << std::setw(12) << memory_track::bytes(tag) * mb << std::endl;
+            }
+        }
+    }
+    inline size_t reserved() const
+    {
+        size_t out = 0;
+        for (const memory_usage &u : _usage)
+        {
+            out += u.reserved;
+        }
+
+        return out;
+    }
+    inline size_t resident() const
+    {
+        size_t out = 0;
+        for (const memory_usage &u : _usage)
+        {
+            out += u.resident;
+        }
+
+        return out;
+    }
+};
+}
+
+#ifdef BDS_TRACK_ALLOC
+
+// Debug build allocator, prefixes each block with its size and tag so frees are attributed
+namespace game
+{
+static constexpr size_t _mem_header = 16;
+
+inline void *track_alloc(const size_t size) noexcept
+{
+    uint8_t *const block = static_cast<uint8_t *>(std::malloc(size + _mem_header));
+    if (!block)
+    {
+        return nullptr;
+    }
+
+    // Store size and tag in the header
+    size_t *const header = reinterpret_cast<size_t *>(block);
+    const uint_fast8_t tag = memory_track::get_tag();
+    header[0] = size;
+    header[1] = tag;
+    memory_track::add(tag, size);
+
+    return block + _mem_header;
+}
+inline void track_free(void *ptr) noexcept
+{
+    if (!ptr)
+    {
+        return;
+    }
+
+    // Read the header and release the block
+    uint8_t *const block = static_cast<uint8_t *>(ptr) - _mem_header;
+    const size_t *const header = reinterpret_cast<const size_t *>(block);
+    memory_track::remove(static_cast<uint_fast8_t>(header[1]), header[0]);
+    std::free(block);
+}
+}
+
+void *operator new(std::size_t size)
+{
+    void *const ptr = game::track_alloc(size);
+    if (!ptr)
+    {
+        throw std::bad_alloc();
+    }
+
+    return ptr;
+}
+void *operator new[](std::size_t size)
+{
+    return operator new(size);
+}
+void *operator new(std::size_t size, const std::nothrow_t &) noexcept
+{
+    return game::track_alloc(size);
+}
+void *operator new[](std::size_t size, const std::nothrow_t &) noexcept
+{
+    return game::track_alloc(size);
+}
+void operator delete(void *ptr) noexcept
+{
+    game::track_free(ptr);
+}
+void operator delete[](void *ptr) noexcept
+{
+    game::track_free(ptr);
+}
+void operator delete(void *ptr, std::size_t) noexcept
+{
+    game::track_free(ptr);
+}
+void operator delete[](void *ptr, std::size_t) noexcept
+{
+    game::track_free(ptr);
+}
+void operator delete(void *ptr, const std::nothrow_t &) noexcept
+{
+    game::track_free(ptr);
+}
+void operator delete[](void *ptr, const std::nothrow_t &) noexcept
+{
+    game::track_free(ptr);
+}
+
+#endif
+
+#endif
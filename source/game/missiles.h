@@ -19,9 +19,12 @@ along with Beyond Dying Skies.  If not, see <http://www.gnu.org/licenses/>.
 #define _BDS_MISSILES_BDS_
 
 #include <game/def.h>
+#include <game/entity.h>
 #include <game/id.h>
 #include <game/particle.h>
+#include <game/registry.h>
 #include <game/sound.h>
+#include <game/static_batch.h>
 #include <game/static_instance.h>
 #include <min/grid.h>
 #include <min/physics_nt.h>
@@ -36,26 +39,17 @@ class missile
 {
   private:
     size_t _body_id;
-    size_t _inst_id;
     size_t _part_id;
     size_t _sound_id;
 
   public:
-    missile(const size_t body_id, const size_t inst_id, const size_t part_id, const size_t sound_id)
-        : _body_id(body_id), _inst_id(inst_id), _part_id(part_id), _sound_id(sound_id) {}
+    missile(const size_t body_id, const size_t part_id, const size_t sound_id)
+        : _body_id(body_id), _part_id(part_id), _sound_id(sound_id) {}
 
     inline size_t body_id() const
     {
         return _body_id;
     }
-    inline void dec_inst()
-    {
-        _inst_id--;
-    }
-    inline size_t inst_id() const
-    {
-        return _inst_id;
-    }
     inline size_t part_id() const
     {
         return _part_id;
@@ -73,8 +67,8 @@ class missiles
     static_instance *const _inst;
     particle *const _part;
     sound *const _sound;
-    std::vector<std::pair<min::aabbox<float, min::vec3>, block_id>> _col_cells;
-    std::vector<missile> _miss;
+    registry<missile> _miss;
+    static_batch _batch;
     const min::tri<unsigned> _scale;
     coll_call _f;
     const std::string _str;
@@ -88,42 +82,37 @@ class missiles
         return _sim->get_body(_miss[index].body_id());
     }
     template <typename ES>
-    inline void explode(const size_t index, const block_id atlas, const ES &ex_scale_call)
+    inline void explode_at(const size_t index, const block_id atlas, const ES &ex_scale_call)
     {
         // Call the explosion callback function if available
-        ex_scale_call(position(index), _scale, atlas);
+        ex_scale_call(body(index).get_position(), _scale, atlas);
 
         // Blow up the missile
-        explode(index);
+        remove_at(index);
     }
     inline const min::vec3<float> &velocity(const size_t index) const
     {
         // Return the explosive position
         return body(index).get_linear_velocity();
     }
-    inline void remove(const size_t index)
+    inline void remove_at(const size_t index)
     {
-        // Clear missiles at index
-        _inst->get_missile().clear(_miss[index].inst_id());
-        _sim->clear_body(_miss[index].body_id());
-        _miss.erase(_miss.begin() + index);
+        // Stop playing particles
+        _part->abort_miss_launch(_miss[index].part_id());
 
-        // Adjust the remaining missile indices
-        const size_t size = _miss.size();
-        for (size_t i = index; i < size; i++)
-        {
-            // Adjust the instance id
-            _miss[i].dec_inst();
+        // Stop playing launch sound
+        _sound->stop_miss_launch(_miss[index].sound_id());
 
-            // Adjust the body data index
-            body(i).set_data(min::body_data(i));
-        }
+        // Swap the last missile and instance into this index
+        _inst->get_missile().clear(index);
+        _sim->clear_body(_miss[index].body_id());
+        _miss.remove(index);
     }
     inline void reserve_memory()
     {
-        // Reserve space for collision cells
-        _col_cells.reserve(27);
+        // Reserve space for missiles
         _miss.reserve(static_instance::max_missiles());
+        _batch.reserve(static_instance::max_missiles());
     }
 
   public:
@@ -136,31 +125,32 @@ class missiles
     }
     inline void reset()
     {
-        // Remove all the missiles backwards to preserve ex-instance id mapping
-        const size_t size = _miss.size();
-        for (size_t i = size; i-- != 0;)
+        // Clear all the bodies
+        for (const missile &m : _miss)
         {
-            // Get the missile
-            const missile &m = _miss[i];
-
-            // Clear instance and body
-            _inst->get_explosive().clear(m.inst_id());
             _sim->clear_body(m.body_id());
         }
 
-        // Clear all the drops
+        // Clear all the missiles and instances at once
+        _inst->get_missile().clear();
         _miss.clear();
     }
-    inline void explode(const size_t index)
+    inline void explode(const size_t id)
     {
-        // Stop playing particles
-        _part->abort_miss_launch(_miss[index].part_id());
-
-        // Stop playing launch sound
-        _sound->stop_miss_launch(_miss[index].sound_id());
-
-        // Blow up the missile
-        remove(index);
+        // Ignore handles of missiles already removed
+        if (_miss.valid(id))
+        {
+            remove_at(_miss.index(id));
+        }
+    }
+    inline void gather(entity_store &es) const
+    {
+        // Add every missile to the store, the missile index is the instance id
+        const size_t size = _miss.size();
+        for (size_t i = 0; i < size; i++)
+        {
+            es.add(static_id::MISSILE, i, _miss[i].body_id(), false);
+        }
     }
     inline const min::tri<unsigned> &get_scale() const
     {
@@ -202,81 +192,91 @@ class missiles
         // Create a box for the missile
         const min::aabbox<float, min::vec3> box = _inst->get_missile().get_box(inst_id);
 
-        // Store the missile index as body data
-        const size_t index = _miss.size();
-
         // Add to physics simulation
-        const size_t body_id = _sim->add_body(box, 10.0, id_value(static_id::MISSILE), index);
+        const size_t body_id = _sim->add_body(box, 10.0, id_value(static_id::MISSILE), 0);
 
         // Register player collision callback
         _sim->register_callback(body_id, _f);
 
+        // Create a new missile
+        const size_t id = _miss.add(body_id, part_id, sound_id);
+
         // Get the physics body for editing
         min::body<float, min::vec3> &body = _sim->get_body(body_id);
 
+        // Store the stable missile handle as body data
+        body.set_data(min::body_data(id));
+
         // Set body linear velocity
         body.set_linear_velocity(vel + (dir * 30.0));
 
-        // Create a new missile
-        _miss.emplace_back(body_id, inst_id, part_id, sound_id);
-
         // Return launch success
         return true;
     }
-    inline const min::vec3<float> &position(const size_t index) const
-    {
-        // Return the explosive position
-        return body(index).get_position();
-    }
     inline void set_collision_callback(const coll_call &f)
     {
         _f = f;
     }
+    inline size_t size() const
+    {
+        return _miss.size();
+    }
     template <typename ES>
-    inline void update_frame(const cgrid &grid, const ES &ex_scale_call)
+    inline void update_frame(const cgrid &grid, const float dt, const ES &ex_scale_call)
     {
-        // Do missile collisions
+        // Gather all missiles into the batch
+        _batch.clear();
         const size_t size = _miss.size();
+        const min::vec3<float> half = cgrid::missile_half_extent();
         for (size_t i = 0; i < size; i++)
         {
-            // Get all cells that could collide
-            grid.missile_collision_cells(_col_cells, position(i));
+            _batch.gather(*_sim, _miss[i].body_id(), half);
+        }
 
-            // Solve static collisions
-            const size_t body = _miss[i].body_id();
-            for (const auto &cell : _col_cells)
-            {
-                if (_sim->collide(body, cell.first))
-                {
-                    // Explode the missile
-                    explode(i, cell.second, ex_scale_call);
+        // Solve static collisions and write back the moved bodies
+        _batch.solve(grid, _elasticity);
+        _batch.scatter(*_sim);
 
-                    // Decrement current index
-                    i--;
+        // Explode the missiles that hit, in reverse so the swapped in missile was already tested
+        for (size_t i = size; i-- > 0;)
+        {
+            if (_batch.is_hit(i))
+            {
+                explode_at(i, _batch.first_atlas(i), ex_scale_call);
+            }
+        }
 
-                    // Abort inner loop
-                    break;
-                }
+        // Sweep the rest along this step so fast missiles can not skip thin walls
+        for (size_t i = _miss.size(); i-- > 0;)
+        {
+            float toi;
+            block_id atlas;
+            const min::vec3<float> p = body(i).get_position();
+            const min::vec3<float> d = velocity(i) * dt;
+            if (grid.sweep(p, half, d, toi, atlas))
+            {
+                // Move to the time of impact and explode there
+                body(i).set_position(p + d * toi);
+                explode_at(i, atlas, ex_scale_call);
             }
         }
     }
-    inline void update(const cgrid &grid)
+    inline void update(const entity_store &es)
     {
-        // Update all missile positions
-        const size_t size = _miss.size();
+        // Follow all missiles gathered in the store, the store already wrote their positions
+        const size_t first = es.begin(static_id::MISSILE);
+        const size_t size = es.end(static_id::MISSILE) - first;
         for (size_t i = 0; i < size; i++)
         {
-            // Update the instance matrix
-            const size_t inst_id = _miss[i].inst_id();
+            // Get particle and sound id
             const size_t part_id = _miss[i].part_id();
             const size_t sound_id = _miss[i].sound_id();
 
-            // Update missile positions
-            const min::vec3<float> &p = body(i).get_position();
-            _inst->get_missile().update_position(inst_id, p);
+            // Get the missile position
+            const min::vec3<float> p = es.position(first + i);
 
             // Set particle position slightly behind the rocket opposing body velocity
-            const min::vec3<float> dir = min::vec3<float>(velocity(i)).normalize();
+            const min::vec3<float> dir = es.velocity(first + i).normalize();
             const min::vec3<float> offset = p - dir * 0.25;
             _part->set_miss_launch_position(part_id, offset);
 
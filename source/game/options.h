@@ -56,15 +56,20 @@ class options
     uint_fast16_t _width;
     uint_fast16_t _height;
     key_map_type _map;
+    bool _frame_graph;
+    bool _frame_stats;
+    bool _mem_report;
+    bool _parallel_physics;
     bool _persist;
     bool _resize;
+    bool _trace;
 
   public:
     options()
         : _chunk(8), _frames(60), _grid(64),
           _mode(game_type::NORMAL), _slot(0), _view(5),
           _width(1024), _height(768),
-          _map(key_map_type::QWERTY), _persist(true), _resize(true) {}
+          _map(key_map_type::QWERTY), _frame_graph(false), _frame_stats(false), _mem_report(false), _parallel_physics(false), _persist(true), _resize(true), _trace(false) {}
 
     inline bool check_error() const
     {
@@ -120,6 +125,14 @@ class options
     {
         return _height;
     }
+    inline bool is_frame_graph() const
+    {
+        return _frame_graph;
+    }
+    inline bool is_frame_stats() const
+    {
+        return _frame_stats;
+    }
     inline bool is_key_map_dvorak() const
     {
         return _map == key_map_type::DVORAK;
@@ -132,10 +145,22 @@ class options
     {
         return _map == key_map_type::QWERTY;
     }
+    inline bool is_mem_report() const
+    {
+        return _mem_report;
+    }
+    inline bool is_parallel_physics() const
+    {
+        return _parallel_physics;
+    }
     inline bool resize() const
     {
         return _resize;
     }
+    inline bool is_trace() const
+    {
+        return _trace;
+    }
     inline void set_chunk(const size_t chunk)
     {
         _chunk = chunk;
@@ -148,10 +173,26 @@ class options
     {
         _grid = grid;
     }
+    inline void set_frame_graph()
+    {
+        _frame_graph = true;
+    }
+    inline void set_frame_stats()
+    {
+        _frame_stats = true;
+    }
     inline void set_game_mode(const game_type mode)
     {
         _mode = mode;
     }
+    inline void set_mem_report()
+    {
+        _mem_report = true;
+    }
+    inline void set_parallel_physics()
+    {
+        _parallel_physics = true;
+    }
     inline void set_no_persist()
     {
         _persist = false;
@@ -180,6 +221,10 @@ class options
     {
         _resize = flag;
     }
+    inline void set_trace()
+    {
+        _trace = true;
+    }
 };
 }
 
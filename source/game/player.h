@@ -18,6 +18,7 @@ along with Beyond Dying Skies.  If not, see <http://www.gnu.org/licenses/>.
 #ifndef _BDS_PLAYER_BDS_
 #define _BDS_PLAYER_BDS_
 
+#include <algorithm>
 #include <game/cgrid.h>
 #include <game/def.h>
 #include <game/id.h>
@@ -124,7 +125,6 @@ class player
     physics *_sim;
     sound *_sound;
     size_t _body_id;
-    std::vector<std::pair<min::aabbox<float, min::vec3>, block_id>> _col_cells;
     inventory _inv;
     unsigned _damage_cd;
     unsigned _explode_cd;
@@ -159,10 +159,6 @@ class player
         // Cache the land velocity at time of landing
         _land_vel = velocity();
     }
-    inline void reserve_memory()
-    {
-        _col_cells.reserve(36);
-    }
     inline void swing()
     {
         // Get player position
@@ -266,7 +262,7 @@ class player
             reset_land_info();
         }
     }
-    inline void update_position(const float friction)
+    inline void update_position(const float friction, const size_t ticks)
     {
         // If hooked, add hook forces
         if (_hooked)
@@ -278,8 +274,11 @@ class player
         {
             if (_stats.can_consume_jet())
             {
-                // Consume energy
-                _stats.consume_jet();
+                // Consume energy for each tick of this step
+                for (size_t i = 0; i < ticks && _stats.can_consume_jet(); i++)
+                {
+                    _stats.consume_jet();
+                }
 
                 // Apply force to player body
                 force(min::vec3<float>(0.0, 11.0, 0.0));
@@ -308,7 +307,14 @@ class player
             }
         }
     }
-    inline void update_stats()
+    inline void update_stats(const size_t ticks)
+    {
+        for (size_t i = 0; i < ticks; i++)
+        {
+            update_tick();
+        }
+    }
+    inline void update_tick()
     {
         // Regen energy
         if (!_skills.is_locked())
@@ -338,9 +344,6 @@ class player
           _land_count(0), _jump_count(0), _landed(false), _jet(false),
           _mode(play_mode::none)
     {
-        // Reserve space for collision cells
-        reserve_memory();
-
         // If resuming game
         if (!state.is_new_game())
         {
@@ -659,28 +662,11 @@ class player
     {
         _mode = mode;
     }
-    inline target target_ray(const cgrid &grid, const min::ray<float, min::vec3> &r, const size_t max_dist) const
+    inline void target_body(const min::ray<float, min::vec3> &r, target &out) const
     {
-        // Output target
-        target out;
-
         // Get ray origin
         const min::vec3<float> &ray_pos = r.get_origin();
 
-        // Trace a ray to the destination point to find placement position, return point is snapped
-        const bool target_valid = grid.ray_trace_last_key(r, max_dist, out.position(), out.key(), out.atlas());
-
-        // If ray is invalid or doesn't hit any blocks
-        if (!target_valid || !not_empty(out.get_atlas()))
-        {
-            out.set_id(target_id::INVALID);
-        }
-        else
-        {
-            // Set target id to block
-            out.set_id(target_id::BLOCK);
-        }
-
         // Calculate distance to block
         const min::vec3<float> block_diff = out.position() - ray_pos;
         float min_dist = block_diff.dot(block_diff);
@@ -721,6 +707,28 @@ class player
                 }
             }
         }
+    }
+    inline target target_ray(const cgrid &grid, const min::ray<float, min::vec3> &r, const size_t max_dist) const
+    {
+        // Output target
+        target out;
+
+        // Trace a ray to the destination point to find placement position, return point is snapped
+        const bool target_valid = grid.ray_trace_last_key(r, max_dist, out.position(), out.key(), out.atlas());
+
+        // If ray is invalid or doesn't hit any blocks
+        if (!target_valid || !not_empty(out.get_atlas()))
+        {
+            out.set_id(target_id::INVALID);
+        }
+        else
+        {
+            // Set target id to block
+            out.set_id(target_id::BLOCK);
+        }
+
+        // Check for a closer physics body
+        target_body(r, out);
 
         // Return this target
         return out;
@@ -740,23 +748,17 @@ class player
         // Warp character to new position
         body().set_position(p);
     }
-    inline void update_pre_frame(const float friction)
+    inline void update_pre_frame(const float friction, const size_t ticks)
     {
         // Proces damage and explode cooldowns
-        if (_damage_cd > 0)
-        {
-            _damage_cd--;
-        }
-        if (_explode_cd > 0)
-        {
-            _explode_cd--;
-        }
+        _damage_cd -= std::min(_damage_cd, static_cast<unsigned>(ticks));
+        _explode_cd -= std::min(_explode_cd, static_cast<unsigned>(ticks));
 
         // Update the player position
-        update_position(friction);
+        update_position(friction, ticks);
 
         // Update the player stats
-        update_stats();
+        update_stats(ticks);
     }
     template <typename E>
     inline void update_post_frame(const cgrid &grid, const E &ex_call)
@@ -764,21 +766,17 @@ class player
         // Check if player is still in the grid
         const min::vec3<float> &p = position();
 
-        // Get all cells that could collide
-        grid.player_collision_cells(_col_cells, p);
-
-        // Solve static collisions
+        // Solve static collisions against all cells that could collide
         bool landed = false;
-        for (const auto &cell : _col_cells)
-        {
+        grid.for_each_solid_cell(cgrid::player_box(p), [this, &ex_call, &landed, &p](const min::aabbox<float, min::vec3> &cell, const block_id atlas) {
             // Did we collide with block?
-            const bool collide = _sim->collide(_body_id, cell.first);
+            const bool collide = _sim->collide(_body_id, cell);
 
             // Detect if player has landed
             if (collide)
             {
                 // Check if we landed
-                const min::vec3<float> center = cell.first.get_center();
+                const min::vec3<float> center = cell.get_center();
 
                 // Calculate minimum gap between player
                 constexpr float min_dist = cgrid::_player_dy + 0.475;
@@ -790,13 +788,15 @@ class player
                 }
 
                 // If we collided with a sodium cell and we haven't exploded yet
-                if (!is_exploded() && cell.second == block_id::SODIUM)
+                if (!is_exploded() && atlas == block_id::SODIUM)
                 {
                     // Call explosion callback
-                    ex_call(cell.first.get_center(), cell.second);
+                    ex_call(center, atlas);
                 }
             }
-        }
+
+            return true;
+        });
 
         // Cast a ray to see hovering over a cell
         if (!landed)
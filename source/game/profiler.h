@@ -0,0 +1,233 @@
+/* Copyright [2013-2018] [Aaron Springstroh, Minimal Graphics Library]
+
+This file is part of the Beyond Dying Skies.
+
+Beyond Dying Skies is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+Beyond Dying Skies is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with Beyond Dying Skies.  If not, see <http://www.gnu.org/licenses/>.
+*/
+#ifndef _BDS_PROFILER_BDS_
+#define _BDS_PROFILER_BDS_
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <memory>
+#include <mutex>
+#include <ostream>
+#include <string>
+#include <vector>
+
+namespace game
+{
+
+class profile_event
+{
+  public:
+    const char *name;
+    uint64_t start;
+    uint64_t stop;
+    uint64_t value;
+    bool counter;
+};
+
+// Fixed size ring buffer owned by one thread, oldest events are overwritten
+class profile_buffer
+{
+  private:
+    static constexpr size_t _size = 1 << 15;
+    std::vector<profile_event> _events;
+    std::atomic<size_t> _head;
+    const size_t _tid;
+
+  public:
+    profile_buffer(const size_t tid) : _events(_size), _head(0), _tid(tid) {}
+
+    inline void push(const char *name, const uint64_t start, const uint64_t stop)
+    {
+        // Only the owning thread writes
+        const size_t head = _head.load(std::memory_order_relaxed);
+        profile_event &e = _events[head % _size];
+        e.name = name;
+        e.start = start;
+        e.stop = stop;
+        e.value = 0;
+        e.counter = false;
+        _head.store(head + 1, std::memory_order_release);
+    }
+    inline void push_counter(const char *name, const uint64_t time, const uint64_t value)
+    {
+        // Counters are samples at a single time
+        const size_t head = _head.load(std::memory_order_relaxed);
+        profile_event &e = _events[head % _size];
+        e.name = name;
+        e.start = e.stop = time;
+        e.value = value;
+        e.counter = true;
+        _head.store(head + 1, std::memory_order_release);
+    }
+    template <typename F>
+    inline void for_each(const F &f) const
+    {
+        // Visit the events still held in the ring, oldest first
+        const size_t head = _head.load(std::memory_order_acquire);
+        const size_t begin = (head > _size) ? head - _size : 0;
+        for (size_t i = begin; i < head; i++)
+        {
+            f(_events[i % _size]);
+        }
+    }
+    inline size_t tid() const
+    {
+        return _tid;
+    }
+};
+
+class profiler
+{
+  private:
+    static std::atomic<bool> _enabled;
+    static std::mutex _lock;
+    static std::vector<std::unique_ptr<profile_buffer>> _buffers;
+    static const std::chrono::steady_clock::time_point _epoch;
+
+    static inline profile_buffer &local_buffer()
+    {
+        // Buffers are created on first use and live until exit, so exiting threads never dangle
+        static thread_local profile_buffer *buffer = nullptr;
+        if (!buffer)
+        {
+            std::lock_guard<std::mutex> lock(_lock);
+            _buffers.emplace_back(new profile_buffer(_buffers.size()));
+            buffer = _buffers.back().get();
+        }
+
+        return *buffer;
+    }
+
+  public:
+    static inline void enable(const bool flag)
+    {
+        _enabled.store(flag, std::memory_order_relaxed);
+    }
+    static inline bool enabled()
+    {
+        return _enabled.load(std::memory_order_relaxed);
+    }
+    static inline uint64_t now()
+    {
+        return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - _epoch).count();
+    }
+    static inline void record(const char *name, const uint64_t start, const uint64_t stop)
+    {
+        local_buffer().push(name, start, stop);
+    }
+    static inline void counter(const char *name, const uint64_t value)
+    {
+        // Record a counter sample when enabled, name must outlive the trace
+        if (enabled())
+        {
+            local_buffer().push_counter(name, now(), value);
+        }
+    }
+    static inline void write_chrome_trace(std::ostream &out)
+    {
+        std::lock_guard<std::mutex> lock(_lock);
+
+        // Chrome and Perfetto expect microsecond timestamps
+        out << std::fixed << std::setprecision(3);
+        out << "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[" << std::endl;
+
+        // Write complete and counter events for every thread
+        bool first = true;
+        for (const auto &b : _buffers)
+        {
+            const size_t tid = b->tid();
+            b->for_each([&out, &first, tid](const profile_event &e) {
+                out << (first ? "" : ",\n")
+                    << "{\"name\":\"" << e.name << "\",\"cat\":\"bds\",\"ph\":\"" << (e.counter ? "C" : "X") << "\""
+                    << ",\"ts\":" << (e.start / 1000.0);
+                if (e.counter)
+                {
+                    out << ",\"args\":{\"value\":" << e.value << "}";
+                }
+                else
+                {
+                    out << ",\"dur\":" << ((e.stop - e.start) / 1000.0);
+                }
+                out << ",\"pid\":1,\"tid\":" << tid << "}";
+                first = false;
+            });
+        }
+
+        out << std::endl
+            << "]}" << std::endl;
+    }
+    static inline void save_chrome_trace(const std::string &file_name)
+    {
+        // Stop recording so the buffers are stable
+        enable(false);
+
+        // Save the trace to file
+        std::ofstream file(file_name, std::ios::out);
+        if (file.is_open())
+        {
+            // Print diagnostic message
+            std::cout << "profiler: saving trace to " << file_name << std::endl;
+
+            write_chrome_trace(file);
+            file.close();
+        }
+        else
+        {
+            std::cout << "profiler: could not save trace '" << file_name << "'" << std::endl;
+        }
+    }
+};
+
+std::atomic<bool> profiler::_enabled(false);
+std::mutex profiler::_lock;
+std::vector<std::unique_ptr<profile_buffer>> profiler::_buffers;
+const std::chrono::steady_clock::time_point profiler::_epoch = std::chrono::steady_clock::now();
+
+// Records the lifetime of this object when the profiler is enabled, name must outlive the trace
+class profile_scope
+{
+  private:
+    const char *const _name;
+    const bool _active;
+    uint64_t _start;
+
+  public:
+    profile_scope(const char *name) : _name(name), _active(profiler::enabled()), _start(0)
+    {
+        if (_active)
+        {
+            _start = profiler::now();
+        }
+    }
+    ~profile_scope()
+    {
+        if (_active)
+        {
+            profiler::record(_name, _start, profiler::now());
+        }
+    }
+    profile_scope(const profile_scope &) = delete;
+    profile_scope &operator=(const profile_scope &) = delete;
+};
+}
+
+#endif
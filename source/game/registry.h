@@ -0,0 +1,200 @@
+/* Copyright [2013-2018] [Aaron Springstroh, Minimal Graphics Library]
+
+This file is part of the Beyond Dying Skies.
+
+Beyond Dying Skies is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+Beyond Dying Skies is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with Beyond Dying Skies.  If not, see <http://www.gnu.org/licenses/>.
+*/
+#ifndef _BDS_REGISTRY_BDS_
+#define _BDS_REGISTRY_BDS_
+
+#include <cstddef>
+#include <utility>
+#include <vector>
+
+namespace game
+{
+
+// Dense array addressed by stable generational handles, removal swaps the last element into the hole
+template <typename T>
+class registry
+{
+  private:
+    static constexpr size_t _slot_bits = 24;
+    static constexpr size_t _slot_mask = (static_cast<size_t>(1) << _slot_bits) - 1;
+    std::vector<T> _dense;
+    std::vector<size_t> _owner;
+    std::vector<size_t> _index;
+    std::vector<size_t> _gen;
+    std::vector<size_t> _free;
+
+    static inline size_t pack(const size_t slot, const size_t gen)
+    {
+        return (gen << _slot_bits) | slot;
+    }
+    static inline size_t slot(const size_t h)
+    {
+        return h & _slot_mask;
+    }
+    inline void move(const size_t from, const size_t to)
+    {
+        // Move the element and point its slot at the new position
+        _dense[to] = std::move(_dense[from]);
+        const size_t s = _owner[from];
+        _owner[to] = s;
+        _index[s] = to;
+    }
+    inline void release(const size_t i)
+    {
+        // Stale the handle and recycle the slot
+        const size_t s = _owner[i];
+        _gen[s]++;
+        _free.push_back(s);
+    }
+
+  public:
+    registry() {}
+
+    template <class... Args>
+    inline size_t add(Args &&... args)
+    {
+        // Reuse a free slot or make a new one
+        size_t s;
+        if (_free.empty())
+        {
+            s = _gen.size();
+            _gen.push_back(0);
+            _index.push_back(0);
+        }
+        else
+        {
+            s = _free.back();
+            _free.pop_back();
+        }
+
+        // Append the element to the dense array
+        _index[s] = _dense.size();
+        _owner.push_back(s);
+        _dense.emplace_back(std::forward<Args>(args)...);
+
+        // Return the handle
+        return pack(s, _gen[s]);
+    }
+    inline T &operator[](const size_t i)
+    {
+        return _dense[i];
+    }
+    inline const T &operator[](const size_t i) const
+    {
+        return _dense[i];
+    }
+    inline typename std::vector<T>::iterator begin()
+    {
+        return _dense.begin();
+    }
+    inline typename std::vector<T>::const_iterator begin() const
+    {
+        return _dense.begin();
+    }
+    inline void clear()
+    {
+        // Stale every live handle at once
+        const size_t size = _dense.size();
+        for (size_t i = 0; i < size; i++)
+        {
+            release(i);
+        }
+        _dense.clear();
+        _owner.clear();
+    }
+    inline typename std::vector<T>::iterator end()
+    {
+        return _dense.end();
+    }
+    inline typename std::vector<T>::const_iterator end() const
+    {
+        return _dense.end();
+    }
+    inline size_t handle(const size_t i) const
+    {
+        return pack(_owner[i], _gen[_owner[i]]);
+    }
+    inline size_t index(const size_t h) const
+    {
+        return _index[slot(h)];
+    }
+    inline void remove(const size_t i)
+    {
+        release(i);
+
+        // Swap the last element into the hole
+        const size_t last = _dense.size() - 1;
+        if (i != last)
+        {
+            move(last, i);
+        }
+        _dense.pop_back();
+        _owner.pop_back();
+    }
+    template <typename F, typename M>
+    inline size_t remove_if(const F &f, const M &moved)
+    {
+        // Compact the survivors in one pass, moved(from, to) mirrors each move in parallel arrays
+        const size_t size = _dense.size();
+        size_t out = 0;
+        for (size_t i = 0; i < size; i++)
+        {
+            if (f(_dense[i]))
+            {
+                release(i);
+            }
+            else
+            {
+                if (out != i)
+                {
+                    move(i, out);
+                    moved(i, out);
+                }
+                out++;
+            }
+        }
+
+        // Drop the tail
+        const size_t removed = size - out;
+        _dense.erase(_dense.begin() + out, _dense.end());
+        _owner.resize(out);
+
+        return removed;
+    }
+    inline void reserve(const size_t size)
+    {
+        _dense.reserve(size);
+        _owner.reserve(size);
+        _index.reserve(size);
+        _gen.reserve(size);
+        _free.reserve(size);
+    }
+    inline size_t size() const
+    {
+        return _dense.size();
+    }
+    inline bool valid(const size_t h) const
+    {
+        // The handle is live if its generation matches the slot
+        const size_t s = slot(h);
+        return s < _gen.size() && pack(s, _gen[s]) == h;
+    }
+};
+}
+
+#endif
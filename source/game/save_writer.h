@@ -0,0 +1,250 @@
+/* Copyright [2013-2018] [Aaron Springstroh, Minimal Graphics Library]
+
+This file is part of the Beyond Dying Skies.
+
+Beyond Dying Skies is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+Beyond Dying Skies is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with Beyond Dying Skies.  If not, see <http://www.gnu.org/licenses/>.
+*/
+#ifndef _BDS_SAVE_WRITER_BDS_
+#define _BDS_SAVE_WRITER_BDS_
+
+#include <atomic>
+#include <cstdint>
+#include <game/file.h>
+#include <game/id.h>
+#include <game/profiler.h>
+#include <game/world_format.h>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+
+namespace game
+{
+
+// Writes a world save on a background thread from a copy on write snapshot of the live grid
+// Chunks are shared with the grid until the game edits one, the first edit copies the chunk for the writer
+class save_writer
+{
+  private:
+    static constexpr uint8_t _live = 0;
+    static constexpr uint8_t _reading = 1;
+    static constexpr uint8_t _copying = 2;
+    static constexpr uint8_t _copied = 3;
+    static constexpr uint8_t _done = 4;
+
+    const std::vector<block_id> *_grid;
+    size_t _scale;
+    size_t _chunk;
+    size_t _axis;
+    size_t _chunks;
+    std::unique_ptr<std::atomic<uint8_t>[]> _state;
+    std::vector<std::vector<uint8_t>> _copy;
+    world_format _format;
+    std::thread _thread;
+    std::atomic<size_t> _encoded;
+    std::atomic<bool> _snapshot;
+    std::atomic<bool> _busy;
+    std::atomic<bool> _failed;
+    std::string _error;
+
+    inline void read_chunk(const size_t index, std::vector<uint8_t> &cells)
+    {
+        // Read untouched chunks straight from the live grid
+        uint8_t state = _live;
+        if (_state[index].compare_exchange_strong(state, _reading, std::memory_order_acq_rel))
+        {
+            world_format::gather(*_grid, _scale, _chunk, index, cells);
+        }
+        else
+        {
+            // The game edited the chunk, take the copy made before the edit
+            while (_state[index].load(std::memory_order_acquire) != _copied)
+            {
+                std::this_thread::yield();
+            }
+            cells.swap(_copy[index]);
+            std::vector<uint8_t>().swap(_copy[index]);
+        }
+
+        // The chunk is no longer part of the snapshot
+        _state[index].store(_done, std::memory_order_release);
+        _encoded.fetch_add(1, std::memory_order_relaxed);
+    }
+
+  public:
+    save_writer()
+        : _grid(nullptr), _scale(0), _chunk(0), _axis(0), _chunks(0),
+          _encoded(0), _snapshot(false), _busy(false), _failed(false) {}
+    ~save_writer()
+    {
+        wait();
+    }
+    save_writer(const save_writer &) = delete;
+    save_writer &operator=(const save_writer &) = delete;
+
+    inline void before_write(const size_t key)
+    {
+        // Nothing to preserve without a save in flight
+        if (!_snapshot.load(std::memory_order_acquire))
+        {
+            return;
+        }
+
+        // Chunk of the cell
+        const size_t x = key / (_scale * _scale);
+        const size_t y = (key / _scale) % _scale;
+        const size_t z = key % _scale;
+        const size_t index = ((x / _chunk) * _axis + y / _chunk) * _axis + z / _chunk;
+
+        // Copy the chunk on its first edit, the writer encodes the copy
+        uint8_t state = _live;
+        if (_state[index].compare_exchange_strong(state, _copying, std::memory_order_acq_rel))
+        {
+            world_format::gather(*_grid, _scale, _chunk, index, _copy[index]);
+            _state[index].store(_copied, std::memory_order_release);
+        }
+        else
+        {
+            // The writer is reading this chunk, one chunk takes microseconds
+            while (_state[index].load(std::memory_order_acquire) == _reading)
+            {
+                std::this_thread::yield();
+            }
+        }
+    }
+    template <typename F>
+    inline void begin(const std::vector<block_id> &grid, const size_t scale, const size_t chunk, const uint32_t base,
+                      const std::string &world, const std::string &state_file, std::vector<uint8_t> &&state, F &&done)
+    {
+        wait();
+
+        // Every chunk starts shared with the live grid
+        const size_t axis = scale / chunk;
+        const size_t chunks = axis * axis * axis;
+        if (chunks != _chunks)
+        {
+            _state.reset(new std::atomic<uint8_t>[chunks]);
+            _copy.resize(chunks);
+            _chunks = chunks;
+        }
+        for (size_t i = 0; i < chunks; i++)
+        {
+            _state[i].store(_live, std::memory_order_relaxed);
+        }
+        _grid = &grid;
+        _scale = scale;
+        _chunk = chunk;
+        _axis = axis;
+        _encoded = 0;
+        _failed = false;
+        _busy = true;
+        _snapshot = true;
+
+        // Print diagnostic message here, the writer thread never prints
+        std::cout << "save_writer: saving to " << world << std::endl;
+
+        // Encode the snapshot, then swap in the world and the state it was taken with
+        _thread = std::thread([this, base, world, state_file, state = std::move(state), done = std::forward<F>(done)]() {
+            const profile_scope scope("save_writer::write");
+
+            // Chunks are encoded in index order while the game keeps editing the grid
+            std::vector<uint8_t> stream;
+            _format.encode_serial(_scale, _chunk, true, base, stream, [this](const size_t i, std::vector<uint8_t> &cells) {
+                read_chunk(i, cells);
+            });
+            _snapshot = false;
+
+            // The state is written after the world so it never describes a newer world than the one on disk
+            bool ok = file::replace_file(world, stream, _error);
+            if (ok && !state_file.empty())
+            {
+                ok = file::replace_file(state_file, state, _error);
+            }
+            if (ok)
+            {
+                done();
+            }
+            _failed = !ok;
+            _busy = false;
+        });
+    }
+    inline bool failed() const
+    {
+        return _failed;
+    }
+    inline bool is_active() const
+    {
+        return _busy;
+    }
+    inline size_t memory_reserved() const
+    {
+        // The writer owns the buffers while a save is in flight
+        if (_busy)
+        {
+            return 0;
+        }
+
+        size_t out = _format.memory_reserved() + _chunks * sizeof(std::atomic<uint8_t>) + _copy.capacity() * sizeof(std::vector<uint8_t>);
+        for (const auto &c : _copy)
+        {
+            out += c.capacity();
+        }
+
+        return out;
+    }
+    inline size_t memory_resident() const
+    {
+        // The writer owns the buffers while a save is in flight
+        if (_busy)
+        {
+            return 0;
+        }
+
+        size_t out = _format.memory_resident() + _chunks * sizeof(std::atomic<uint8_t>) + _copy.size() * sizeof(std::vector<uint8_t>);
+        for (const auto &c : _copy)
+        {
+            out += c.size();
+        }
+
+        return out;
+    }
+    inline float progress() const
+    {
+        // Negative when idle, otherwise the fraction of chunks encoded
+        if (!_busy)
+        {
+            return -1.0;
+        }
+
+        return static_cast<float>(_encoded) / static_cast<float>(_chunks);
+    }
+    inline void wait()
+    {
+        if (_thread.joinable())
+        {
+            _thread.join();
+
+            // The writer never prints, report a failed save on the joining thread
+            if (_failed)
+            {
+                std::cout << "save_writer: " << _error << std::endl;
+            }
+        }
+    }
+};
+}
+
+#endif
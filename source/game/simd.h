@@ -0,0 +1,56 @@
+/* Copyright [2013-2018] [Aaron Springstroh, Minimal Graphics Library]
+
+This file is part of the Beyond Dying Skies.
+
+Beyond Dying Skies is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+Beyond Dying Skies is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with Beyond Dying Skies.  If not, see <http://www.gnu.org/licenses/>.
+*/
+#ifndef _BDS_SIMD_BDS_
+#define _BDS_SIMD_BDS_
+
+// GCC and Clang compile AVX2 kernels with a target attribute so every x86 build carries them
+// MSVC only compiles them when the build targets AVX2, see the BDS_MSVC_AVX2 CMake option
+#if defined(__AVX2__)
+#define BDS_AVX2
+#define BDS_AVX2_TARGET
+#elif (defined(__GNUC__) || defined(__clang__)) && (defined(__x86_64__) || defined(__i386__))
+#define BDS_AVX2
+#define BDS_AVX2_TARGET __attribute__((target("avx2")))
+#endif
+
+#ifdef BDS_AVX2
+#include <immintrin.h>
+#endif
+
+namespace game
+{
+
+class simd
+{
+  public:
+    static inline bool avx2()
+    {
+        // Kernels built with the target attribute only run if the CPU has AVX2
+#if defined(__AVX2__)
+        return true;
+#elif defined(BDS_AVX2)
+        static const bool out = __builtin_cpu_supports("avx2");
+        return out;
+#else
+        return false;
+#endif
+    }
+};
+}
+
+#endif
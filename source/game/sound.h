@@ -20,11 +20,13 @@ along with Beyond Dying Skies.  If not, see <http://www.gnu.org/licenses/>.
 
 #include <chrono>
 #include <game/memory_map.h>
+#include <game/memory_report.h>
 #include <min/camera.h>
 #include <min/ogg.h>
 #include <min/sound_buffer.h>
 #include <min/wave.h>
 #include <random>
+#include <string>
 #include <thread>
 
 namespace game
@@ -203,6 +205,7 @@ class sound
     std::uniform_int_distribution<size_t> _int_dist;
     std::uniform_real_distribution<float> _real_dist;
     std::mt19937 _gen;
+    size_t _encoded;
 
     inline sound_info &bg_info()
     {
@@ -340,6 +343,14 @@ class sound
         // Adjust the reference distance
         _buffer.set_source_ref_dist(s, _ex_ref_dist);
     }
+    inline const min::mem_file &get_file(const std::string &name)
+    {
+        // Track the encoded bytes of all loaded sounds
+        const min::mem_file &file = memory_map::memory.get_file(name);
+        _encoded += file.size();
+
+        return file;
+    }
     inline void load_sound(const size_t b, const float gain, const float fade_speed = _fade_speed)
     {
         // Create a source
@@ -373,11 +384,11 @@ class sound
     inline void load_bg_sound()
     {
         // Load a music OGG files
-        const min::mem_file &ogg_file1 = memory_map::memory.get_file("data/sound/music1_s.ogg");
+        const min::mem_file &ogg_file1 = get_file("data/sound/music1_s.ogg");
         const min::ogg sound1(ogg_file1);
-        const min::mem_file &ogg_file2 = memory_map::memory.get_file("data/sound/music2_s.ogg");
+        const min::mem_file &ogg_file2 = get_file("data/sound/music2_s.ogg");
         const min::ogg sound2(ogg_file2);
-        const min::mem_file &ogg_file3 = memory_map::memory.get_file("data/sound/music3_s.ogg");
+        const min::mem_file &ogg_file3 = get_file("data/sound/music3_s.ogg");
         const min::ogg sound3(ogg_file3);
 
         // Create music buffers
@@ -391,7 +402,7 @@ class sound
     inline void load_charge_sound()
     {
         // Load a OGG file
-        const min::mem_file &ogg = memory_map::memory.get_file("data/sound/charge_s.ogg");
+        const min::mem_file &ogg = get_file("data/sound/charge_s.ogg");
         const min::ogg sound(ogg);
         load_ogg_sound(sound, _charge_gain, _charge_fade);
 
@@ -401,14 +412,14 @@ class sound
     inline void load_click_sound()
     {
         // Load a WAVE file
-        const min::mem_file &wave = memory_map::memory.get_file("data/sound/click_s.wav");
+        const min::mem_file &wave = get_file("data/sound/click_s.wav");
         const min::wave sound(wave);
         load_wave_sound(sound, _click_gain);
     }
     inline void load_drone_sound()
     {
         // Load a OGG file
-        const min::mem_file &ogg = memory_map::memory.get_file("data/sound/drone_m.ogg");
+        const min::mem_file &ogg = get_file("data/sound/drone_m.ogg");
         const min::ogg sound(ogg);
 
         // Load a OGG file into buffer
@@ -442,7 +453,7 @@ class sound
     inline void load_blast_mono_sound()
     {
         // Load a OGG file
-        const min::mem_file &ogg = memory_map::memory.get_file("data/sound/blast_m.ogg");
+        const min::mem_file &ogg = get_file("data/sound/blast_m.ogg");
         const min::ogg sound(ogg);
         load_ogg_sound(sound, _blast_gain);
 
@@ -452,7 +463,7 @@ class sound
     inline void load_blast_stereo_sound()
     {
         // Load a OGG file
-        const min::mem_file &ogg = memory_map::memory.get_file("data/sound/blast_s.ogg");
+        const min::mem_file &ogg = get_file("data/sound/blast_s.ogg");
         const min::ogg sound(ogg);
         load_ogg_sound(sound, _blast_gain);
 
@@ -462,14 +473,14 @@ class sound
     inline void load_focus_sound()
     {
         // Load a OGG file
-        const min::mem_file &ogg = memory_map::memory.get_file("data/sound/focus_s.ogg");
+        const min::mem_file &ogg = get_file("data/sound/focus_s.ogg");
         const min::ogg sound(ogg);
         load_ogg_sound(sound, _focus_gain);
     }
     inline void load_grapple_sound()
     {
         // Load a OGG file
-        const min::mem_file &ogg = memory_map::memory.get_file("data/sound/grapple_s.ogg");
+        const min::mem_file &ogg = get_file("data/sound/grapple_s.ogg");
         const min::ogg sound(ogg);
         load_ogg_sound(sound, _grap_gain, _grap_fade);
 
@@ -491,7 +502,7 @@ class sound
     inline void load_jet_sound()
     {
         // Load a OGG file
-        const min::mem_file &ogg = memory_map::memory.get_file("data/sound/jet_s.ogg");
+        const min::mem_file &ogg = get_file("data/sound/jet_s.ogg");
         const min::ogg sound(ogg);
         load_ogg_sound(sound, _jet_gain, _jet_fade);
 
@@ -501,14 +512,14 @@ class sound
     inline void load_land_sound()
     {
         // Load a WAVE file
-        const min::mem_file &wave = memory_map::memory.get_file("data/sound/land_s.wav");
+        const min::mem_file &wave = get_file("data/sound/land_s.wav");
         const min::wave sound(wave);
         load_wave_sound(sound, _land_gain);
     }
     inline void load_explode_sound()
     {
         // Load a OGG file
-        const min::mem_file &ogg = memory_map::memory.get_file("data/sound/explode_m.ogg");
+        const min::mem_file &ogg = get_file("data/sound/explode_m.ogg");
         const min::ogg sound(ogg);
 
         // Load a OGG file into buffer
@@ -539,7 +550,7 @@ class sound
     inline void load_miss_launch_sound()
     {
         // Load a OGG file
-        const min::mem_file &ogg = memory_map::memory.get_file("data/sound/jet_m.ogg");
+        const min::mem_file &ogg = get_file("data/sound/jet_m.ogg");
         const min::ogg sound(ogg);
 
         // Load a OGG file into buffer
@@ -573,7 +584,7 @@ class sound
     inline void load_oxygen_sound()
     {
         // Load a OGG file
-        const min::mem_file &ogg = memory_map::memory.get_file("data/sound/oxygen_s.ogg");
+        const min::mem_file &ogg = get_file("data/sound/oxygen_s.ogg");
         const min::ogg sound(ogg);
         load_ogg_sound(sound, _oxygen_gain, _oxygen_fade);
 
@@ -583,21 +594,21 @@ class sound
     inline void load_pickup_sound()
     {
         // Load a OGG file
-        const min::mem_file &ogg = memory_map::memory.get_file("data/sound/pickup_s.ogg");
+        const min::mem_file &ogg = get_file("data/sound/pickup_s.ogg");
         const min::ogg sound(ogg);
         load_ogg_sound(sound, _pickup_gain);
     }
     inline void load_shot_sound()
     {
         // Load a OGG file
-        const min::mem_file &ogg = memory_map::memory.get_file("data/sound/shot_s.ogg");
+        const min::mem_file &ogg = get_file("data/sound/shot_s.ogg");
         const min::ogg sound(ogg);
         load_ogg_sound(sound, _shot_gain);
     }
     inline void load_shot_ex_sound()
     {
         // Load a OGG file
-        const min::mem_file &ogg = memory_map::memory.get_file("data/sound/shot_ex_m.ogg");
+        const min::mem_file &ogg = get_file("data/sound/shot_ex_m.ogg");
         const min::ogg sound(ogg);
         load_ogg_sound(sound, _shot_ex_gain);
 
@@ -607,37 +618,37 @@ class sound
     inline void load_thrust_sound()
     {
         // Load a OGG file
-        const min::mem_file &ogg = memory_map::memory.get_file("data/sound/thrust_s.ogg");
+        const min::mem_file &ogg = get_file("data/sound/thrust_s.ogg");
         const min::ogg sound(ogg);
         load_ogg_sound(sound, _thrust_gain);
     }
     inline void load_zap_sound()
     {
         // Load a OGG file
-        const min::mem_file &ogg = memory_map::memory.get_file("data/sound/zap_m.ogg");
+        const min::mem_file &ogg = get_file("data/sound/zap_m.ogg");
         const min::ogg sound(ogg);
         load_ogg_sound(sound, _zap_gain);
     }
     inline void load_voice_sound()
     {
         // Load a music OGG files
-        const min::mem_file &ogg1 = memory_map::memory.get_file("data/sound/voice_comply_s.ogg");
+        const min::mem_file &ogg1 = get_file("data/sound/voice_comply_s.ogg");
         const min::ogg sound1(ogg1);
-        const min::mem_file &ogg2 = memory_map::memory.get_file("data/sound/voice_critical_s.ogg");
+        const min::mem_file &ogg2 = get_file("data/sound/voice_critical_s.ogg");
         const min::ogg sound2(ogg2);
-        const min::mem_file &ogg3 = memory_map::memory.get_file("data/sound/voice_level_s.ogg");
+        const min::mem_file &ogg3 = get_file("data/sound/voice_level_s.ogg");
         const min::ogg sound3(ogg3);
-        const min::mem_file &ogg4 = memory_map::memory.get_file("data/sound/voice_portal_alert_s.ogg");
+        const min::mem_file &ogg4 = get_file("data/sound/voice_portal_alert_s.ogg");
         const min::ogg sound4(ogg4);
-        const min::mem_file &ogg5 = memory_map::memory.get_file("data/sound/voice_power_s.ogg");
+        const min::mem_file &ogg5 = get_file("data/sound/voice_power_s.ogg");
         const min::ogg sound5(ogg5);
-        const min::mem_file &ogg6 = memory_map::memory.get_file("data/sound/voice_repair_s.ogg");
+        const min::mem_file &ogg6 = get_file("data/sound/voice_repair_s.ogg");
         const min::ogg sound6(ogg6);
-        const min::mem_file &ogg7 = memory_map::memory.get_file("data/sound/voice_resource_s.ogg");
+        const min::mem_file &ogg7 = get_file("data/sound/voice_resource_s.ogg");
         const min::ogg sound7(ogg7);
-        const min::mem_file &ogg8 = memory_map::memory.get_file("data/sound/voice_shutdown_s.ogg");
+        const min::mem_file &ogg8 = get_file("data/sound/voice_shutdown_s.ogg");
         const min::ogg sound8(ogg8);
-        const min::mem_file &ogg9 = memory_map::memory.get_file("data/sound/voice_thrust_alert_s.ogg");
+        const min::mem_file &ogg9 = get_file("data/sound/voice_thrust_alert_s.ogg");
         const min::ogg sound9(ogg9);
 
         // Create music buffers
@@ -668,8 +679,11 @@ class sound
           _miss_launch(_miss_launch_limit), _miss_launch_old(0),
           _voice(_voice_sounds), _v_head(0), _v_delay(1.0), _v_enable(true),
           _int_dist(0, _bg_sounds - 1), _real_dist(0.0, _max_delay),
-          _gen(std::chrono::high_resolution_clock::now().time_since_epoch().count())
+          _gen(std::chrono::high_resolution_clock::now().time_since_epoch().count()),
+          _encoded(0)
     {
+        const memory_scope mem(mem_tag::SOUND);
+
         // Reserve memory for sources and buffers
         reserve_memory();
 
@@ -779,6 +793,11 @@ class sound
     {
         return _buffer.check_error();
     }
+    inline void memory(memory_report &report) const
+    {
+        // OpenAL buffers cannot be queried, report the encoded size of all sounds
+        report.add("sound::buffers", _encoded, _encoded);
+    }
     inline size_t get_idle_drone_id()
     {
         // Output id
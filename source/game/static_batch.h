@@ -0,0 +1,408 @@
+/* Copyright [2013-2018] [Aaron Springstroh, Minimal Graphics Library]
+
+This file is part of the Beyond Dying Skies.
+
+Beyond Dying Skies is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+Beyond Dying Skies is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with Beyond Dying Skies.  If not, see <http://www.gnu.org/licenses/>.
+*/
+#ifndef _BDS_STATIC_BATCH_BDS_
+#define _BDS_STATIC_BATCH_BDS_
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <game/cgrid.h>
+#include <game/def.h>
+#include <game/id.h>
+#include <game/task_pool.h>
+#include <min/aabbox.h>
+#include <min/vec3.h>
+#include <utility>
+#include <vector>
+
+namespace game
+{
+
+class static_batch;
+
+// Candidate cells and contacts for the bodies of one group of grid chunks
+class static_island
+{
+    friend class static_batch;
+
+  private:
+    // Range of the batch body order
+    size_t _begin;
+    size_t _end;
+
+    // Candidate solid cells
+    std::vector<size_t> _cb;
+    std::vector<float> _cx;
+    std::vector<float> _cy;
+    std::vector<float> _cz;
+    std::vector<block_id> _ca;
+    std::vector<uint_fast8_t> _co;
+
+    // Resolved contacts as candidate indices
+    std::vector<size_t> _contact;
+
+  public:
+    static_island() : _begin(0), _end(0) {}
+
+    inline void clear()
+    {
+        _cb.clear();
+        _cx.clear();
+        _cy.clear();
+        _cz.clear();
+        _ca.clear();
+        _co.clear();
+        _contact.clear();
+    }
+    inline void reserve(const size_t cells)
+    {
+        _cb.reserve(cells);
+        _cx.reserve(cells);
+        _cy.reserve(cells);
+        _cz.reserve(cells);
+        _ca.reserve(cells);
+        _co.reserve(cells);
+        _contact.reserve(cells);
+    }
+};
+
+// Resolves small dynamic bodies against the grid in structure of array batches
+class static_batch
+{
+  private:
+    static constexpr size_t _parallel_min = 256;
+
+    // Body state
+    std::vector<size_t> _id;
+    std::vector<float> _px;
+    std::vector<float> _py;
+    std::vector<float> _pz;
+    std::vector<float> _vx;
+    std::vector<float> _vy;
+    std::vector<float> _vz;
+    std::vector<float> _hx;
+    std::vector<float> _hy;
+    std::vector<float> _hz;
+    std::vector<uint_fast8_t> _hit;
+    std::vector<block_id> _first;
+
+    // Bodies sorted by chunk and split into islands
+    std::vector<std::pair<size_t, size_t>> _order;
+    std::vector<static_island> _islands;
+    size_t _island_size;
+    task_pool *_pool;
+
+    inline void broadphase(const cgrid &grid, static_island &is)
+    {
+        // Gather solid cells overlapped by each body
+        for (size_t o = is._begin; o < is._end; o++)
+        {
+            const size_t i = _order[o].second;
+            const min::vec3<float> p(_px[i], _py[i], _pz[i]);
+            const min::vec3<float> half(_hx[i], _hy[i], _hz[i]);
+            const min::aabbox<float, min::vec3> box(p - half, p + half);
+            grid.for_each_solid_cell(box, [&is, i](const min::aabbox<float, min::vec3> &cell, const block_id atlas) {
+                const min::vec3<float> c = cell.get_center();
+                is._cb.push_back(i);
+                is._cx.push_back(c.x());
+                is._cy.push_back(c.y());
+                is._cz.push_back(c.z());
+                is._ca.push_back(atlas);
+                return true;
+            });
+        }
+    }
+    inline void narrowphase(static_island &is)
+    {
+        // Branch free overlap test over all candidates
+        const size_t size = is._cb.size();
+        is._co.resize(size);
+        for (size_t k = 0; k < size; k++)
+        {
+            const size_t b = is._cb[k];
+            const float ox = _hx[b] + 0.5f - std::abs(_px[b] - is._cx[k]);
+            const float oy = _hy[b] + 0.5f - std::abs(_py[b] - is._cy[k]);
+            const float oz = _hz[b] + 0.5f - std::abs(_pz[b] - is._cz[k]);
+            is._co[k] = (ox > 0.0f) & (oy > 0.0f) & (oz > 0.0f);
+        }
+    }
+    inline void partition(const cgrid &grid, const size_t parts)
+    {
+        // Sort bodies by chunk so each island reads a compact part of the grid
+        const size_t size = _id.size();
+        _order.clear();
+        for (size_t i = 0; i < size; i++)
+        {
+            _order.emplace_back(grid.get_chunk_key(min::vec3<float>(_px[i], _py[i], _pz[i])), i);
+        }
+        std::sort(_order.begin(), _order.end());
+
+        // Split into islands of whole chunks, the same bodies and parts give the same islands
+        const size_t target = (size + parts - 1) / parts;
+        _island_size = 0;
+        size_t begin = 0;
+        for (size_t o = 1; o <= size; o++)
+        {
+            const bool cut = (o == size) || (o - begin >= target && _order[o].first != _order[o - 1].first);
+            if (cut)
+            {
+                // Reuse island buffers between frames
+                if (_island_size == _islands.size())
+                {
+                    _islands.emplace_back();
+                }
+                static_island &is = _islands[_island_size++];
+                is.clear();
+                is._begin = begin;
+                is._end = o;
+                begin = o;
+            }
+        }
+    }
+    inline void resolve(static_island &is, const float elasticity)
+    {
+        // Resolve overlapping candidates in order, earlier contacts move the body
+        const size_t size = is._cb.size();
+        for (size_t k = 0; k < size; k++)
+        {
+            if (!is._co[k])
+            {
+                continue;
+            }
+
+            // Recalculate penetration with the corrected position
+            const size_t b = is._cb[k];
+            const float dx = _px[b] - is._cx[k];
+            const float dy = _py[b] - is._cy[k];
+            const float dz = _pz[b] - is._cz[k];
+            const float ox = _hx[b] + 0.5f - std::abs(dx);
+            const float oy = _hy[b] + 0.5f - std::abs(dy);
+            const float oz = _hz[b] + 0.5f - std::abs(dz);
+            if (ox <= 0.0f || oy <= 0.0f || oz <= 0.0f)
+            {
+                continue;
+            }
+
+            // Push out along the axis of least penetration and reflect velocity into the cell
+            if (ox <= oy && ox <= oz)
+            {
+                const float s = (dx >= 0.0f) ? 1.0f : -1.0f;
+                _px[b] += s * ox;
+                _vx[b] = (_vx[b] * s < 0.0f) ? -_vx[b] * elasticity : _vx[b];
+            }
+            else if (oy <= oz)
+            {
+                const float s = (dy >= 0.0f) ? 1.0f : -1.0f;
+                _py[b] += s * oy;
+                _vy[b] = (_vy[b] * s < 0.0f) ? -_vy[b] * elasticity : _vy[b];
+            }
+            else
+            {
+                const float s = (dz >= 0.0f) ? 1.0f : -1.0f;
+                _pz[b] += s * oz;
+                _vz[b] = (_vz[b] * s < 0.0f) ? -_vz[b] * elasticity : _vz[b];
+            }
+
+            // Record the contact and the first cell hit
+            if (!_hit[b])
+            {
+                _first[b] = is._ca[k];
+            }
+            _hit[b] = 1;
+            is._contact.push_back(k);
+        }
+    }
+    inline void solve_island(const cgrid &grid, static_island &is, const float elasticity)
+    {
+        // Find candidate cells, test them in bulk, then resolve the overlaps
+        broadphase(grid, is);
+        narrowphase(is);
+        resolve(is, elasticity);
+    }
+
+  public:
+    static_batch() : _island_size(0), _pool(nullptr) {}
+
+    inline void add(const size_t id, const min::vec3<float> &p, const min::vec3<float> &v, const min::vec3<float> &half)
+    {
+        _id.push_back(id);
+        _px.push_back(p.x());
+        _py.push_back(p.y());
+        _pz.push_back(p.z());
+        _vx.push_back(v.x());
+        _vy.push_back(v.y());
+        _vz.push_back(v.z());
+        _hx.push_back(half.x());
+        _hy.push_back(half.y());
+        _hz.push_back(half.z());
+        _hit.push_back(0);
+        _first.push_back(block_id::EMPTY);
+    }
+    inline void clear()
+    {
+        // Keep capacity so steady state batches do not allocate
+        _id.clear();
+        _px.clear();
+        _py.clear();
+        _pz.clear();
+        _vx.clear();
+        _vy.clear();
+        _vz.clear();
+        _hx.clear();
+        _hy.clear();
+        _hz.clear();
+        _hit.clear();
+        _first.clear();
+        _order.clear();
+        _island_size = 0;
+    }
+    inline size_t contacts() const
+    {
+        size_t out = 0;
+        for (size_t i = 0; i < _island_size; i++)
+        {
+            out += _islands[i]._contact.size();
+        }
+
+        return out;
+    }
+    template <typename F>
+    inline void for_each_contact(const F &f) const
+    {
+        // Visit each resolved contact with the body index, cell center and cell atlas, in island order
+        for (size_t i = 0; i < _island_size; i++)
+        {
+            const static_island &is = _islands[i];
+            for (const size_t k : is._contact)
+            {
+                f(is._cb[k], min::vec3<float>(is._cx[k], is._cy[k], is._cz[k]), is._ca[k]);
+            }
+        }
+    }
+    inline block_id first_atlas(const size_t index) const
+    {
+        return _first[index];
+    }
+    inline void gather(physics &sim, const size_t id, const min::vec3<float> &half)
+    {
+        const min::body<float, min::vec3> &b = sim.get_body(id);
+        add(id, b.get_position(), b.get_linear_velocity(), half);
+    }
+    inline bool is_hit(const size_t index) const
+    {
+        return _hit[index];
+    }
+    inline size_t islands() const
+    {
+        return _island_size;
+    }
+    inline min::vec3<float> position(const size_t index) const
+    {
+        return min::vec3<float>(_px[index], _py[index], _pz[index]);
+    }
+    inline void reserve(const size_t bodies)
+    {
+        // Bodies overlap at most a few cells per axis
+        const size_t cells = bodies * 27;
+        _id.reserve(bodies);
+        _px.reserve(bodies);
+        _py.reserve(bodies);
+        _pz.reserve(bodies);
+        _vx.reserve(bodies);
+        _vy.reserve(bodies);
+        _vz.reserve(bodies);
+        _hx.reserve(bodies);
+        _hy.reserve(bodies);
+        _hz.reserve(bodies);
+        _hit.reserve(bodies);
+        _first.reserve(bodies);
+        _order.reserve(bodies);
+
+        // The serial island holds every candidate
+        if (_islands.empty())
+        {
+            _islands.emplace_back();
+        }
+        _islands[0].reserve(cells);
+    }
+    inline void scatter(physics &sim) const
+    {
+        // Write back only the bodies that were moved
+        const size_t size = _id.size();
+        for (size_t i = 0; i < size; i++)
+        {
+            if (_hit[i])
+            {
+                min::body<float, min::vec3> &b = sim.get_body(_id[i]);
+                b.set_position(min::vec3<float>(_px[i], _py[i], _pz[i]));
+                b.set_linear_velocity(min::vec3<float>(_vx[i], _vy[i], _vz[i]));
+            }
+        }
+    }
+    inline size_t size() const
+    {
+        return _id.size();
+    }
+    inline void set_pool(task_pool *const pool)
+    {
+        _pool = pool;
+    }
+    inline void solve(const cgrid &grid, const float elasticity)
+    {
+        // Small batches or no pool, solve every body in one island
+        const size_t size = _id.size();
+        if (!_pool || size < _parallel_min)
+        {
+            // Bodies keep their batch order
+            _order.clear();
+            for (size_t i = 0; i < size; i++)
+            {
+                _order.emplace_back(0, i);
+            }
+
+            // Solve on the calling thread
+            if (_islands.empty())
+            {
+                _islands.emplace_back();
+            }
+            static_island &is = _islands[0];
+            is.clear();
+            is._begin = 0;
+            is._end = size;
+            _island_size = 1;
+            solve_island(grid, is, elasticity);
+            return;
+        }
+
+        // Split bodies into a few islands per thread, islands only write their own bodies
+        partition(grid, (_pool->size() + 1) * 2);
+
+        // Solve islands in parallel, the grid is read only
+        const auto work = [this, &grid, elasticity](std::mt19937 &gen, const size_t i) {
+            solve_island(grid, _islands[i], elasticity);
+        };
+        _pool->run(std::cref(work), 0, _island_size);
+    }
+    inline min::vec3<float> velocity(const size_t index) const
+    {
+        return min::vec3<float>(_vx[index], _vy[index], _vz[index]);
+    }
+};
+}
+
+#endif
@@ -18,11 +18,16 @@ along with Beyond Dying Skies.  If not, see <http://www.gnu.org/licenses/>.
 #ifndef _BDS_STATIC_INSTANCE_BDS_
 #define _BDS_STATIC_INSTANCE_BDS_
 
+#include <algorithm>
+#include <game/broadphase.h>
 #include <game/cgrid.h>
 #include <game/def.h>
+#include <game/frustum_cull.h>
 #include <game/geometry.h>
 #include <game/id.h>
 #include <game/memory_map.h>
+#include <game/memory_report.h>
+#include <game/profiler.h>
 #include <game/uniforms.h>
 #include <min/aabbox.h>
 #include <min/camera.h>
@@ -43,50 +48,57 @@ along with Beyond Dying Skies.  If not, see <http://www.gnu.org/licenses/>.
 namespace game
 {
 
-enum class static_id : size_t
-{
-    PLAYER = 0,
-    CHEST = 1,
-    DRONE = 2,
-    DROP = 3,
-    EXPLOSIVE = 4,
-    MISSILE = 5,
-    ASSET_SIZE = MISSILE
-};
-
-inline constexpr size_t id_value(const static_id id)
-{
-    return static_cast<size_t>(id);
-}
-
 class static_asset
 {
   private:
     const size_t _iid;
     const GLuint _tid;
     const size_t _start_index;
+    const size_t _slots;
     const size_t _limit;
     const min::aabbox<float, min::vec3> _box;
     std::vector<size_t> _index;
     std::vector<min::mat4<float>> _mat;
     std::vector<min::mat4<float>> _mat_out;
 
-    inline void reserve_memory(const size_t limit)
+    // Instances written since the last copy, last frame output and the changed output range
+    std::vector<uint_fast8_t> _dirty;
+    std::vector<size_t> _prev;
+    size_t _out_begin;
+    size_t _out_end;
+    size_t _copied;
+
+    inline void grow()
     {
-        _index.reserve(limit);
-        _mat.reserve(limit);
-        _mat_out.reserve(limit);
+        // Double the pool in whole draw chunks so growth is amortized, never past the budget
+        const size_t capacity = _mat.capacity();
+        if (_mat.size() == capacity)
+        {
+            const size_t chunks = (capacity > 0) ? (capacity / _slots) * 2 : 1;
+            const size_t size = chunks * _slots;
+            _mat.reserve((size < _limit) ? size : _limit);
+            _dirty.reserve(_mat.capacity());
+        }
+    }
+    inline void reserve_memory(const size_t slots)
+    {
+        _index.reserve(slots);
+        _mat.reserve(slots);
+        _mat_out.reserve(slots);
+        _dirty.reserve(slots);
+        _prev.reserve(slots);
     }
 
   public:
     static_asset(
         const GLuint iid, const size_t tid,
-        const size_t index, const size_t limit,
+        const size_t index, const size_t slots, const size_t limit,
         const min::aabbox<float, min::vec3> &box)
-        : _iid(iid), _tid(tid), _start_index(index), _limit(limit), _box(box)
+        : _iid(iid), _tid(tid), _start_index(index), _slots(slots), _limit(limit), _box(box),
+          _out_begin(0), _out_end(0), _copied(0)
     {
-        // Reserve memory
-        reserve_memory(limit);
+        // Reserve one draw chunk, the pool grows up to the limit
+        reserve_memory(slots);
     }
 
     inline void add_index(const size_t index)
@@ -102,7 +114,9 @@ class static_asset
         }
 
         // Push back location
+        grow();
         _mat.push_back(p);
+        _dirty.push_back(1);
 
         // Return chest id
         return _mat.size() - 1;
@@ -116,7 +130,9 @@ class static_asset
         }
 
         // Push back location
+        grow();
         _mat.push_back(p);
+        _dirty.push_back(1);
 
         // Pack the matrix with the atlas id
         const float float_atlas = static_cast<float>(atlas);
@@ -128,51 +144,67 @@ class static_asset
     }
     inline void clear(const size_t index)
     {
-        _mat.erase(_mat.begin() + index);
+        // Swap the last matrix into the hole, owners must mirror the move
+        _mat[index] = _mat.back();
+        _mat.pop_back();
+        _dirty[index] = 1;
+        _dirty.pop_back();
     }
     inline void clear()
     {
         _mat.clear();
+        _dirty.clear();
     }
     inline void clear_index()
     {
         _index.clear();
     }
-    inline void copy_mat_index()
+    inline void copy_mat_index(const min::vec3<float> &eye)
     {
-        // Cull empty index buffer
-        const size_t size = _index.size();
-        if (size > 0)
-        {
-            // Resize output buffer
-            _mat_out.resize(size);
-
-            // Copy elements from index buffer
-            for (size_t i = 0; i < size; i++)
-            {
-                _mat_out[i] = _mat[_index[i]];
-            }
-        }
-        else
+        // Only the nearest instances get a draw slot
+        if (_index.size() > _slots)
         {
-            _mat_out.clear();
+            const auto nearer = [this, &eye](const size_t a, const size_t b) {
+                const min::vec3<float> da = _mat[a].get_translation() - eye;
+                const min::vec3<float> db = _mat[b].get_translation() - eye;
+                return da.dot(da) < db.dot(db);
+            };
+            std::nth_element(_index.begin(), _index.begin() + _slots, _index.end(), nearer);
+            _index.resize(_slots);
+
+            // Keep the slot order stable between frames
+            std::sort(_index.begin(), _index.end());
         }
-    }
-    inline void cull_frustum(const cgrid &grid, const min::camera<float> &cam)
-    {
-        // Cull chests
-        const size_t size = _mat.size();
+
+        // Resize output buffer
+        const size_t size = _index.size();
+        const size_t prev = _prev.size();
+        _mat_out.resize(size);
+
+        // Copy only slots whose instance changed or was written since last frame
+        _out_begin = size;
+        _out_end = 0;
+        size_t copies = 0;
         for (size_t i = 0; i < size; i++)
         {
-            // Create chest bounding box from matrix position
-            const min::aabbox<float, min::vec3> box = get_box(i);
-
-            // If the box is within the frustum
-            if (grid.is_viewable(cam, box))
+            const size_t index = _index[i];
+            if (i >= prev || _prev[i] != index || _dirty[index])
             {
-                _index.push_back(i);
+                _mat_out[i] = _mat[index];
+                _out_begin = std::min(_out_begin, i);
+                _out_end = i + 1;
+                copies++;
             }
         }
+        _copied = copies * sizeof(min::mat4<float>);
+
+        // Remember this frame output and clear the written flags
+        _prev.assign(_index.begin(), _index.end());
+        std::fill(_dirty.begin(), _dirty.end(), 0);
+    }
+    inline bool is_dirty(const size_t index) const
+    {
+        return _dirty[index];
     }
     inline bool is_full() const
     {
@@ -189,14 +221,40 @@ class static_asset
         // Return this box for collisions
         return box;
     }
+    inline const min::aabbox<float, min::vec3> &get_model_box() const
+    {
+        return _box;
+    }
     inline size_t get_iid() const
     {
         return _iid;
     }
+    inline float get_reach() const
+    {
+        // Largest half extent of the model box
+        const min::vec3<float> e = (_box.get_max() - _box.get_min()) * 0.5;
+        return std::max(e.x(), std::max(e.y(), e.z()));
+    }
     inline const std::vector<min::mat4<float>> &get_in_matrix() const
     {
         return _mat;
     }
+    inline size_t get_copied() const
+    {
+        return _copied;
+    }
+    inline size_t get_out_begin() const
+    {
+        return _out_begin;
+    }
+    inline size_t get_out_changed() const
+    {
+        return (_out_end > _out_begin) ? _out_end - _out_begin : 0;
+    }
+    inline size_t get_out_end() const
+    {
+        return _out_end;
+    }
     inline const std::vector<min::mat4<float>> &get_out_matrix() const
     {
         return _mat_out;
@@ -213,6 +271,18 @@ class static_asset
     {
         return _limit;
     }
+    inline size_t slots() const
+    {
+        return _slots;
+    }
+    inline size_t memory_reserved() const
+    {
+        return memory_report::reserved(_index) + memory_report::reserved(_mat) + memory_report::reserved(_mat_out) + memory_report::reserved(_dirty) + memory_report::reserved(_prev);
+    }
+    inline size_t memory_resident() const
+    {
+        return memory_report::bytes(_index) + memory_report::bytes(_mat) + memory_report::bytes(_mat_out) + memory_report::bytes(_dirty) + memory_report::bytes(_prev);
+    }
     inline size_t view_size() const
     {
         return _mat_out.size();
@@ -237,16 +307,19 @@ class static_asset
     inline void update_position(const size_t index, const min::vec3<float> &p)
     {
         _mat[index].set_translation(p);
+        _dirty[index] = 1;
     }
     inline void update_rotation(const size_t index, const min::quat<float> &r)
     {
         _mat[index].set_rotation(r);
+        _dirty[index] = 1;
     }
     inline void update_atlas(const size_t index, const block_id atlas)
     {
         const float float_atlas = static_cast<float>(atlas);
         const float w = float_atlas + 2.1;
         _mat[index].w(w);
+        _dirty[index] = 1;
     }
 };
 
@@ -259,6 +332,9 @@ class static_instance
     static constexpr size_t _EXPLODE_LIMIT = 10;
     static constexpr size_t _MISS_LIMIT = 10;
 
+    // Instance pool budgets, the limits above are the draw slots in the uniform buffer
+    static constexpr size_t _DROP_BUDGET = _DROP_LIMIT * 10;
+
     min::shader _vertex;
     min::shader _fragment;
     min::program _prog;
@@ -270,44 +346,85 @@ class static_instance
     std::vector<static_asset> _assets;
     std::vector<size_t> _sort_index;
 
-    inline void cull_frustum(const cgrid &grid, const min::camera<float> &cam)
-    {
-        const size_t size = _assets.size();
-        for (size_t i = 0; i < size; i++)
+    // Instances hashed by grid chunk, ids are the asset base plus instance index
+    broadphase _broad;
+    std::vector<size_t> _base;
+    std::vector<size_t> _hashed;
+    std::vector<size_t> _id_asset;
+    float _reach;
+
+    // Boxes of occupied chunks and candidate instances, tested in batches
+    frustum_cull _cull;
+    std::vector<const std::vector<uint_fast16_t> *> _cull_cells;
+    std::vector<uint_fast16_t> _cull_ids;
+
+    inline void cull_broadphase(const cgrid &grid, const min::camera<float> &cam)
+    {
+        const profile_scope scope("static_instance::cull_broadphase");
+
+        // Collect each occupied chunk once, grown by the model reach so border instances are kept
+        const size_t outside = grid.get_chunks();
+        const min::vec3<float> reach(_reach, _reach, _reach);
+        _cull.clear();
+        _cull_cells.clear();
+        _cull_ids.clear();
+        _broad.for_each_cell([this, &grid, outside, &reach](const size_t key, const std::vector<uint_fast16_t> &items) {
+            if (key == outside)
+            {
+                // Instances outside the grid skip the chunk test
+                this->_cull_ids.insert(this->_cull_ids.end(), items.begin(), items.end());
+            }
+            else
+            {
+                const min::aabbox<float, min::vec3> chunk = grid.get_chunk_box(key);
+                this->_cull.add(min::aabbox<float, min::vec3>(chunk.get_min() - reach, chunk.get_max() + reach));
+                this->_cull_cells.push_back(&items);
+            }
+        });
+
+        // Test all chunks at once and gather the instances of visible chunks
+        _cull.set_camera(cam);
+        _cull.clear_range();
+        for (const size_t i : _cull.cull())
         {
-            _assets[i].cull_frustum(grid, cam);
+            const std::vector<uint_fast16_t> &items = *_cull_cells[i];
+            _cull_ids.insert(_cull_ids.end(), items.begin(), items.end());
         }
-    }
-    inline void cull_physics(const physics &sim, const cgrid &grid)
-    {
-        // Get the view chunks from grid
-        const std::vector<view_chunk> &view_chunks = grid.get_view_chunks();
-
-        // Get the index map
-        const std::vector<uint_fast16_t> &map = sim.get_index_map();
 
-        // For each view chunk
-        for (const view_chunk &vc : view_chunks)
+        // Test the instances of every asset at once, also against the view distance
+        _cull.clear();
+        for (const uint_fast16_t id : _cull_ids)
+        {
+            const size_t asset = _id_asset[id];
+            _cull.add(_assets[asset].get_box(id - _base[asset]));
+        }
+        grid.load_view_range(_cull);
+        for (const size_t i : _cull.cull())
         {
-            // Perform overlapping of physics bodies
-            const std::vector<std::pair<uint_fast16_t, uint_fast16_t>> &over = sim.get_overlap(vc.get_box());
+            const uint_fast16_t id = _cull_ids[i];
+            const size_t asset = _id_asset[id];
+            _assets[asset].add_index(id - _base[asset]);
+        }
 
-            // For each body in view chunk
-            const size_t size = over.size();
-            for (size_t i = 0; i < size; i++)
+        // Record the cells queried
+        profiler::counter("broadphase::cells", _broad.cells());
+    }
+    inline void load_bases()
+    {
+        // Give every instance slot of every asset its own broadphase id
+        size_t base = 0;
+        _reach = 0.0;
+        const size_t size = _assets.size();
+        for (size_t i = 0; i < size; i++)
+        {
+            _base.push_back(base);
+            _hashed.push_back(0);
+            for (size_t j = 0; j < _assets[i].max(); j++)
             {
-                // Get the body from the simulation
-                const min::body<float, min::vec3> &b = sim.get_body(map[over[i].first]);
-
-                // Get the type of body
-                const size_t id = b.get_id();
-
-                // If the body is not dead
-                if (!b.is_dead() && id != id_value(static_id::PLAYER))
-                {
-                    _assets[id - 1].add_index(b.get_data().index);
-                }
+                _id_asset.push_back(i);
             }
+            base += _assets[i].max();
+            _reach = std::max(_reach, _assets[i].get_reach());
         }
     }
     inline void load_chest_model()
@@ -333,7 +450,7 @@ class static_instance
 
         // Add to asset buffer
         const size_t limit = _CHEST_LIMIT;
-        _assets.emplace_back(iid, tid, 245, limit, box3);
+        _assets.emplace_back(iid, tid, 245, limit, limit, box3);
     }
     inline void load_drone_model()
     {
@@ -358,7 +475,7 @@ class static_instance
 
         // Add to asset buffer
         const size_t limit = _DRONE_LIMIT;
-        _assets.emplace_back(iid, tid, 255, limit, box3);
+        _assets.emplace_back(iid, tid, 255, limit, limit, box3);
     }
     inline void load_drop_explode_model()
     {
@@ -405,9 +522,10 @@ class static_instance
 
         // Add to asset buffer
         const size_t drop_limit = _DROP_LIMIT;
-        _assets.emplace_back(iid, tid, 265, drop_limit, box);
+        const size_t drop_budget = _DROP_BUDGET;
+        _assets.emplace_back(iid, tid, 265, drop_limit, drop_budget, box);
         const size_t explode_limit = _EXPLODE_LIMIT;
-        _assets.emplace_back(iid, tid, 315, explode_limit, box);
+        _assets.emplace_back(iid, tid, 315, explode_limit, explode_limit, box);
     }
     inline void load_missile_model()
     {
@@ -432,7 +550,7 @@ class static_instance
 
         // Add to asset buffer
         const size_t limit = _MISS_LIMIT;
-        _assets.emplace_back(iid, tid, 325, limit, box3);
+        _assets.emplace_back(iid, tid, 325, limit, limit, box3);
     }
     inline void load_models()
     {
@@ -472,8 +590,11 @@ class static_instance
     }
     inline void reserve_memory()
     {
-        _sort_index.reserve(_DROP_LIMIT);
+        _sort_index.reserve(_DROP_BUDGET);
         _assets.reserve(id_value(static_id::ASSET_SIZE));
+        _cull.reserve(max_alloc());
+        _cull_cells.reserve(max_alloc());
+        _cull_ids.reserve(max_alloc());
     }
     inline void set_start_index(const GLint start_index) const
     {
@@ -485,7 +606,8 @@ class static_instance
     static_instance(const game::uniforms &uniforms)
         : _vertex(memory_map::memory.get_file("data/shader/instance.vertex"), GL_VERTEX_SHADER),
           _fragment(memory_map::memory.get_file("data/shader/instance.fragment"), GL_FRAGMENT_SHADER),
-          _prog(_vertex, _fragment), _index_location(load_program_index(uniforms))
+          _prog(_vertex, _fragment), _index_location(load_program_index(uniforms)),
+          _broad(max_alloc()), _reach(0.0)
     {
         // Since we are using a BMESH, assert floating point compatibility
         static_assert(std::numeric_limits<float>::is_iec559, "IEEE 754 float required");
@@ -496,6 +618,9 @@ class static_instance
 
         // Load instance model
         load_models();
+
+        // Assign broadphase ids to instance slots
+        load_bases();
     }
     inline void draw(const game::uniforms &uniforms) const
     {
@@ -525,6 +650,10 @@ class static_instance
             _buffer.draw_many(GL_TRIANGLES, iid, asset_size);
         }
     }
+    inline static_asset &get_asset(const static_id id)
+    {
+        return _assets[id_value(id) - 1];
+    }
     inline static_asset &get_chest()
     {
         const size_t id = id_value(static_id::CHEST);
@@ -591,7 +720,7 @@ class static_instance
     }
     inline static constexpr size_t max_alloc()
     {
-        return _CHEST_LIMIT + _DRONE_LIMIT + _DROP_LIMIT + _EXPLODE_LIMIT + _MISS_LIMIT;
+        return _CHEST_LIMIT + _DRONE_LIMIT + _DROP_BUDGET + _EXPLODE_LIMIT + _MISS_LIMIT;
     }
     inline static constexpr size_t max_chests()
     {
@@ -603,7 +732,7 @@ class static_instance
     }
     inline static constexpr size_t max_drops()
     {
-        return _DROP_LIMIT;
+        return _DROP_BUDGET;
     }
     inline static constexpr size_t max_explosives()
     {
@@ -613,34 +742,80 @@ class static_instance
     {
         return _MISS_LIMIT;
     }
-    inline void update(const physics &sim, const cgrid &grid, const min::camera<float> &cam)
+    inline void memory(memory_report &report) const
     {
-        // Clear out the asset index buffer
+        // Sum the matrix and index buffers of all assets
+        size_t resident = 0;
+        size_t reserved = 0;
+        for (const auto &a : _assets)
+        {
+            resident += a.memory_resident();
+            reserved += a.memory_reserved();
+        }
+        report.add("static_instance::matrices", resident, reserved);
+        report.add("static_instance::broadphase", _broad.memory_resident(), _broad.memory_reserved());
+        report.add("static_instance::cull", _cull.memory_resident(), _cull.memory_reserved());
+    }
+    inline void update_broadphase(const cgrid &grid)
+    {
+        // Rehash instances written since the last copy, sleeping drops and chests keep their chunk
+        _broad.reset_moves();
         const size_t size = _assets.size();
         for (size_t i = 0; i < size; i++)
         {
-            _assets[i].clear_index();
-        }
+            const std::vector<min::mat4<float>> &mat = _assets[i].get_in_matrix();
+            const size_t count = mat.size();
+            for (size_t j = 0; j < count; j++)
+            {
+                if (_assets[i].is_dirty(j))
+                {
+                    _broad.update(_base[i] + j, grid.get_chunk_key(mat[j].get_translation()));
+                }
+            }
 
-        // Decide culling strategy
-        if (sim.get_scale() >= grid.get_chunk_scale())
-        {
-            cull_physics(sim, grid);
+            // Removed instances leave their slots
+            for (size_t j = count; j < _hashed[i]; j++)
+            {
+                _broad.remove(_base[i] + j);
+            }
+            _hashed[i] = count;
         }
-        else
+
+        // Record the instances that moved chunk
+        profiler::counter("broadphase::moves", _broad.moves());
+    }
+    inline void update(const cgrid &grid, const min::camera<float> &cam)
+    {
+        const profile_scope scope("static_instance::update");
+        const memory_scope mem(mem_tag::INSTANCE);
+
+        // Clear out the asset index buffer
+        const size_t size = _assets.size();
+        for (size_t i = 0; i < size; i++)
         {
-            cull_frustum(grid, cam);
+            _assets[i].clear_index();
         }
 
+        // Move instances that changed chunk
+        update_broadphase(grid);
+
+        // Cull instances with one query of the occupied chunks
+        cull_broadphase(grid, cam);
+
         // Sort all assets and copy matrix output buffers
+        size_t copied = 0;
         for (size_t i = 0; i < size; i++)
         {
             // Sort and remove duplicates
             _assets[i].sort_prune_index(_sort_index);
 
-            // Copy to output buffer
-            _assets[i].copy_mat_index();
+            // Copy the changed nearest instances to the output buffer
+            _assets[i].copy_mat_index(cam.get_position());
+            copied += _assets[i].get_copied();
         }
+
+        // Record the matrix bytes copied this frame
+        profiler::counter("static_instance::copy_bytes", copied);
     }
 };
 }
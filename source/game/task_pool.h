@@ -0,0 +1,415 @@
+/* Copyright [2013-2018] [Aaron Springstroh, Minimal Graphics Library]
+
+This file is part of the Beyond Dying Skies.
+
+Beyond Dying Skies is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+Beyond Dying Skies is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with Beyond Dying Skies.  If not, see <http://www.gnu.org/licenses/>.
+*/
+#ifndef _BDS_TASK_POOL_BDS_
+#define _BDS_TASK_POOL_BDS_
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <random>
+#include <thread>
+#include <utility>
+#include <vector>
+
+namespace game
+{
+
+class task_pool;
+
+// Counts outstanding tasks, tasks are joined by waiting on the group or chaining a continuation
+class task_group
+{
+    friend class task_pool;
+
+  private:
+    std::atomic<size_t> _count;
+    std::atomic<bool> _done;
+    std::function<void(std::mt19937 &)> _next;
+    task_group *_next_group;
+
+  public:
+    task_group() : _count(1), _done(false), _next(nullptr), _next_group(nullptr) {}
+    task_group(const task_group &) = delete;
+    task_group &operator=(const task_group &) = delete;
+
+    inline bool is_done() const
+    {
+        return _done.load(std::memory_order_acquire);
+    }
+    inline void reset()
+    {
+        // Only valid after the group has been joined
+        _count.store(1, std::memory_order_relaxed);
+        _done.store(false, std::memory_order_relaxed);
+        _next = nullptr;
+        _next_group = nullptr;
+    }
+};
+
+// Work stealing scheduler, each thread owns a deque and steals from the others when empty
+class task_pool
+{
+  private:
+    class task
+    {
+      public:
+        std::function<void(std::mt19937 &)> f;
+        task_group *group;
+
+        task() : group(nullptr) {}
+        task(std::function<void(std::mt19937 &)> &&func, task_group *const g)
+            : f(std::move(func)), group(g) {}
+    };
+    class task_queue
+    {
+      public:
+        std::mutex lock;
+        std::deque<task> tasks;
+    };
+    class thread_slot
+    {
+      public:
+        const task_pool *pool;
+        size_t index;
+    };
+
+    const size_t _size;
+    std::vector<std::unique_ptr<task_queue>> _queues;
+    std::vector<std::mt19937> _gens;
+    std::vector<std::thread> _threads;
+    std::mutex _sleep_lock;
+    std::condition_variable _sleep_cv;
+    std::atomic<size_t> _queued;
+    std::atomic<size_t> _awake;
+    std::atomic<bool> _kill;
+
+    static inline size_t calculate_threads()
+    {
+        // The calling thread also works while it waits so leave it a core
+        const size_t hw = std::thread::hardware_concurrency();
+        return (hw > 1) ? hw - 1 : 1;
+    }
+    static inline thread_slot &local_slot()
+    {
+        static thread_local thread_slot slot = {nullptr, 0};
+        return slot;
+    }
+    static inline std::mt19937 &local_gen()
+    {
+        // Generator for threads that do not belong to the pool
+        static thread_local std::mt19937 gen(std::hash<std::thread::id>()(std::this_thread::get_id()));
+        return gen;
+    }
+    inline size_t current_queue() const
+    {
+        // Pool threads own a queue, external threads share the injection queue
+        const thread_slot &slot = local_slot();
+        return (slot.pool == this) ? slot.index : _size;
+    }
+    inline std::mt19937 &current_gen()
+    {
+        const thread_slot &slot = local_slot();
+        return (slot.pool == this) ? _gens[slot.index] : local_gen();
+    }
+    inline void execute(task &t, std::mt19937 &gen)
+    {
+        // Run the task
+        t.f(gen);
+
+        // Release this task from its group
+        release(*t.group);
+    }
+    inline void finish(task_group &g)
+    {
+        // Schedule the continuation if one was chained
+        if (g._next)
+        {
+            push(std::move(g._next), g._next_group);
+        }
+
+        // Last access to the group, waiters may destroy it after this
+        g._done.store(true, std::memory_order_release);
+    }
+    inline bool pop(const size_t index, task &out)
+    {
+        // Owner takes the most recent task for cache locality
+        task_queue &q = *_queues[index];
+        std::lock_guard<std::mutex> lock(q.lock);
+        if (q.tasks.empty())
+        {
+            return false;
+        }
+
+        // Pop the back of the deque
+        out = std::move(q.tasks.back());
+        q.tasks.pop_back();
+        _queued.fetch_sub(1, std::memory_order_relaxed);
+
+        return true;
+    }
+    inline void push(std::function<void(std::mt19937 &)> &&f, task_group *const g)
+    {
+        // Push onto the back of the current thread queue
+        task_queue &q = *_queues[current_queue()];
+        {
+            std::lock_guard<std::mutex> lock(q.lock);
+            q.tasks.emplace_back(std::move(f), g);
+        }
+        _queued.fetch_add(1, std::memory_order_release);
+
+        // Wake one sleeping worker, lock prevents a lost wakeup
+        {
+            std::lock_guard<std::mutex> lock(_sleep_lock);
+        }
+        _sleep_cv.notify_one();
+    }
+    inline void release(task_group &g)
+    {
+        // The thread that drops the count to zero finishes the group
+        if (g._count.fetch_sub(1, std::memory_order_acq_rel) == 1)
+        {
+            finish(g);
+        }
+    }
+    inline bool steal(const size_t index, task &out)
+    {
+        // Thieves take the oldest task, which tends to be the largest
+        task_queue &q = *_queues[index];
+        std::lock_guard<std::mutex> lock(q.lock);
+        if (q.tasks.empty())
+        {
+            return false;
+        }
+
+        // Pop the front of the deque
+        out = std::move(q.tasks.front());
+        q.tasks.pop_front();
+        _queued.fetch_sub(1, std::memory_order_relaxed);
+
+        return true;
+    }
+    inline bool try_run_one()
+    {
+        // Nothing queued anywhere
+        if (_queued.load(std::memory_order_acquire) == 0)
+        {
+            return false;
+        }
+
+        // Try own queue first, then steal round robin
+        const size_t index = current_queue();
+        const size_t queues = _queues.size();
+        task t;
+        bool found = pop(index, t);
+        for (size_t i = 1; i < queues && !found; i++)
+        {
+            found = steal((index + i) % queues, t);
+        }
+
+        // Run the task if we got one
+        if (found)
+        {
+            execute(t, current_gen());
+        }
+
+        return found;
+    }
+    inline void work(const size_t index)
+    {
+        // Register this thread with the pool
+        thread_slot &slot = local_slot();
+        slot.pool = this;
+        slot.index = index;
+
+        // Process tasks until killed
+        while (!_kill.load(std::memory_order_acquire))
+        {
+            if (try_run_one())
+            {
+                continue;
+            }
+
+            // Spin while a job batch is active, otherwise go to sleep
+            if (_awake.load(std::memory_order_acquire) > 0)
+            {
+                std::this_thread::yield();
+            }
+            else
+            {
+                std::unique_lock<std::mutex> lock(_sleep_lock);
+                _sleep_cv.wait(lock, [this]() {
+                    return _kill.load(std::memory_order_acquire) || _queued.load(std::memory_order_acquire) > 0 || _awake.load(std::memory_order_acquire) > 0;
+                });
+            }
+        }
+    }
+
+  public:
+    task_pool() : task_pool(calculate_threads()) {}
+    task_pool(const size_t threads)
+        : _size(std::max(threads, static_cast<size_t>(1))), _gens(_size),
+          _queued(0), _awake(0), _kill(false)
+    {
+        // One queue per thread plus the injection queue for external threads
+        _queues.reserve(_size + 1);
+        for (size_t i = 0; i < _size + 1; i++)
+        {
+            _queues.emplace_back(new task_queue());
+        }
+
+        // Launch the worker threads
+        _threads.reserve(_size);
+        for (size_t i = 0; i < _size; i++)
+        {
+            _threads.emplace_back(&task_pool::work, this, i);
+        }
+    }
+    ~task_pool()
+    {
+        kill();
+    }
+    task_pool(const task_pool &) = delete;
+    task_pool &operator=(const task_pool &) = delete;
+
+    inline void kill()
+    {
+        // Signal all threads to exit
+        {
+            std::lock_guard<std::mutex> lock(_sleep_lock);
+            _kill.store(true, std::memory_order_release);
+        }
+        _sleep_cv.notify_all();
+
+        // Join all threads
+        for (auto &t : _threads)
+        {
+            if (t.joinable())
+            {
+                t.join();
+            }
+        }
+        _threads.clear();
+    }
+    template <typename F>
+    inline void run(const F &f, const size_t start, const size_t stop)
+    {
+        // Nothing to do
+        if (stop <= start)
+        {
+            return;
+        }
+
+        // Split the range into a few chunks per thread so idle threads can steal
+        const size_t length = stop - start;
+        const size_t chunks = std::min(length, (_size + 1) * 4);
+        const size_t grain = (length + chunks - 1) / chunks;
+
+        // Spawn a task for each chunk
+        task_group g;
+        for (size_t i = start; i < stop; i += grain)
+        {
+            const size_t end = std::min(i + grain, stop);
+            spawn(g, [&f, i, end](std::mt19937 &gen) {
+                for (size_t j = i; j < end; j++)
+                {
+                    f(gen, j);
+                }
+            });
+        }
+
+        // Work on the job until it is done
+        wait(g);
+    }
+    inline bool run_one()
+    {
+        // Execute one queued task, used by threads waiting on something other than a group
+        return try_run_one();
+    }
+    inline void seed(const size_t seed)
+    {
+        // Only safe between jobs
+        const size_t size = _gens.size();
+        for (size_t i = 0; i < size; i++)
+        {
+            _gens[i].seed(static_cast<std::mt19937::result_type>(seed + i));
+        }
+    }
+    inline size_t size() const
+    {
+        return _size;
+    }
+    inline void sleep()
+    {
+        // End of a job batch, allow the workers to block
+        if (_awake.load(std::memory_order_acquire) > 0)
+        {
+            _awake.fetch_sub(1, std::memory_order_acq_rel);
+        }
+    }
+    template <typename F>
+    inline void spawn(task_group &g, F &&f)
+    {
+        // Hold a reference for this task
+        g._count.fetch_add(1, std::memory_order_relaxed);
+
+        // Queue the task
+        push(std::function<void(std::mt19937 &)>(std::forward<F>(f)), &g);
+    }
+    template <typename F>
+    inline void then(task_group &g, task_group &next, F &&f)
+    {
+        // The continuation is a task of the next group
+        next._count.fetch_add(1, std::memory_order_relaxed);
+        g._next = std::function<void(std::mt19937 &)>(std::forward<F>(f));
+        g._next_group = &next;
+
+        // Close the group, the continuation runs once all its tasks finish
+        release(g);
+    }
+    inline void wait(task_group &g)
+    {
+        // Close the group
+        release(g);
+
+        // Help with any work until the group is finished, this makes nesting safe
+        while (!g.is_done())
+        {
+            if (!try_run_one())
+            {
+                std::this_thread::yield();
+            }
+        }
+    }
+    inline void wake()
+    {
+        // Start of a job batch, keep the workers spinning
+        _awake.fetch_add(1, std::memory_order_acq_rel);
+        {
+            std::lock_guard<std::mutex> lock(_sleep_lock);
+        }
+        _sleep_cv.notify_all();
+    }
+};
+}
+
+#endif
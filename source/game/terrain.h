@@ -18,7 +18,10 @@ along with Beyond Dying Skies.  If not, see <http://www.gnu.org/licenses/>.
 #ifndef _BDS_TERRAIN_GEOMETRY_BDS_
 #define _BDS_TERRAIN_GEOMETRY_BDS_
 
+#include <algorithm>
 #include <game/memory_map.h>
+#include <game/memory_report.h>
+#include <game/profiler.h>
 #include <game/terrain_vertex.h>
 #include <min/array_buffer.h>
 #include <min/dds.h>
@@ -26,6 +29,7 @@ along with Beyond Dying Skies.  If not, see <http://www.gnu.org/licenses/>.
 #include <min/shader.h>
 #include <min/texture_buffer.h>
 #include <stdexcept>
+#include <vector>
 
 namespace game
 {
@@ -35,9 +39,11 @@ class terrain
   private:
 #ifdef MGL_GS_RENDER
     static constexpr GLenum TERRAIN_DRAW_TYPE = GL_POINTS;
+    static constexpr size_t _vertex_bytes = sizeof(min::vec4<float>);
     min::shader _tg;
 #else
     static constexpr GLenum TERRAIN_DRAW_TYPE = GL_TRIANGLES;
+    static constexpr size_t _vertex_bytes = sizeof(min::vec4<float>) + sizeof(min::vec2<float>) + sizeof(min::vec3<float>);
 #endif
     min::shader _tv;
     min::shader _tf;
@@ -47,6 +53,9 @@ class terrain
     min::texture_buffer _tbuffer;
     GLuint _dds_id;
     GLint _pre_loc;
+    std::vector<size_t> _mirror;
+    size_t _mirror_bytes;
+    size_t _mirror_reserved;
 
     inline void load_texture()
     {
@@ -71,6 +80,10 @@ class terrain
 
         // Reserve vertex buffer memory for preview
         _pb.reserve(vertex, 1);
+
+        // Buffer sizes are not queryable so track what was reserved and uploaded
+        _mirror.resize(chunks, 0);
+        _mirror_reserved = (chunks + 1) * vertex * _vertex_bytes;
     }
 
   public:
@@ -86,7 +99,7 @@ class terrain
           _tf(memory_map::memory.get_file("data/shader/terrain.fragment"), GL_FRAGMENT_SHADER),
           _prog(_tv, _tf),
 #endif
-          _gb(chunks)
+          _gb(chunks), _mirror_bytes(0), _mirror_reserved(0)
     {
         // Load texture
         load_texture();
@@ -142,14 +155,26 @@ class terrain
             _gb.draw_all(TERRAIN_DRAW_TYPE);
         }
     }
+    inline void memory(memory_report &report) const
+    {
+        report.add("terrain::buffers", _mirror_bytes, std::max(_mirror_bytes, _mirror_reserved));
+    }
     inline void upload_geometry(const size_t index, min::mesh<float, uint32_t> &child)
     {
+        const profile_scope scope("terrain::upload_geometry");
+        const memory_scope mem(mem_tag::TERRAIN);
+
         // Swap buffer index for this chunk
         _gb.set_buffer(index);
 
         // Reset the buffer
         _gb.clear();
 
+        // Track the vertex bytes mirrored for this chunk
+        const size_t bytes = child.vertex.size() * _vertex_bytes + child.index.size() * sizeof(uint32_t);
+        _mirror_bytes = _mirror_bytes - _mirror[index] + bytes;
+        _mirror[index] = bytes;
+
         // Only add if contains faces
         if (child.vertex.size() > 0)
         {
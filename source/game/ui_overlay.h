@@ -51,8 +51,12 @@ class ui_overlay
     const std::string _peace;
     const std::string _power;
     const std::string _res;
+    const std::string _save;
+    const std::string _save_fail;
+    const std::string _saved;
     float _time;
     uint_fast8_t _mult;
+    int _save_percent;
 
     inline bool is_extendable() const
     {
@@ -99,7 +103,10 @@ class ui_overlay
           _peace("Everything seems peaceful!"),
           _power("Low Power!"),
           _res("Not enough blocks/ether for that operation!"),
-          _time(-1.0), _mult(1) {}
+          _save("Saving world... "),
+          _save_fail("World save failed, check the disk!"),
+          _saved("World saved!"),
+          _time(-1.0), _mult(1), _save_percent(-1) {}
 
     inline void reset()
     {
@@ -108,6 +115,7 @@ class ui_overlay
         _order = -1;
         _time = -1.0;
         _mult = 1;
+        _save_percent = -1;
     }
     inline void add_stream_float(const std::string &str, const float value)
     {
@@ -336,6 +344,36 @@ class ui_overlay
     {
         set_ui_alert(_res, 2.0, 1);
     }
+    inline void set_alert_save(const float progress, const bool failed)
+    {
+        // Negative progress when no save is in flight
+        const int percent = (progress < 0.0) ? -1 : static_cast<int>(progress * 100.0);
+        if (percent == _save_percent)
+        {
+            return;
+        }
+
+        // Save alerts replace each other but never a higher precedence alert
+        if (_order == 0)
+        {
+            _order = -1;
+        }
+
+        // Show the percent while saving, then whether the files were written
+        if (percent >= 0)
+        {
+            set_ui_alert(_save + std::to_string(percent) + "%", 5.0, 0);
+        }
+        else if (failed)
+        {
+            set_ui_alert(_save_fail, 5.0, 4);
+        }
+        else
+        {
+            set_ui_alert(_saved, 2.0, 0);
+        }
+        _save_percent = percent;
+    }
     inline void set_console_string(const std::string &str)
     {
         _text.set_console(str);
@@ -510,6 +548,8 @@ class ui_overlay
     inline void update(const min::vec3<float> &p, const min::vec3<float> &dir,
                        const float health, const float energy, const double fps,
                        const double idle, const size_t chunks, const size_t insts,
+                       const frame_summary &frame, const frame_summary &update,
+                       const memory_report &mem, const size_t awake, const size_t asleep,
                        const std::string &target, const float time, const float dt)
     {
         // If menu needs updating
@@ -533,6 +573,10 @@ class ui_overlay
             _text.set_debug_idle(idle);
             _text.set_debug_chunks(chunks);
             _text.set_debug_insts(insts);
+            _text.set_debug_frame(frame);
+            _text.set_debug_update(update);
+            _text.set_debug_memory(mem.resident(), mem.reserved());
+            _text.set_debug_sleep(awake, asleep);
             _text.set_debug_target(target);
         }
 
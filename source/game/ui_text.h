@@ -20,7 +20,10 @@ along with Beyond Dying Skies.  If not, see <http://www.gnu.org/licenses/>.
 
 #include <array>
 #include <game/file.h>
+#include <game/frame_stats.h>
 #include <game/memory_map.h>
+#include <game/memory_report.h>
+#include <game/profiler.h>
 #include <game/ui_bg_assets.h>
 #include <game/ui_config.h>
 #include <game/ui_info.h>
@@ -66,7 +69,7 @@ class ui_text
     static constexpr size_t _ui = _timer + 1;
     static constexpr size_t _alert = _ui + 2;
     static constexpr size_t _debug = _alert + 1;
-    static constexpr size_t _stream = _debug + 14;
+    static constexpr size_t _stream = _debug + 18;
     static constexpr size_t _menu = _stream + _max_stream;
     static constexpr size_t _text_end = _menu + ui_menu::max_size();
 
@@ -200,6 +203,8 @@ class ui_text
     }
     inline void update_main_batch()
     {
+        const profile_scope scope("ui_text::update_main_batch");
+
         // Clear all indices
         _indices.clear();
 
@@ -263,6 +268,8 @@ class ui_text
     }
     inline void update_stream_batch()
     {
+        const profile_scope scope("ui_text::update_stream_batch");
+
         // Clear all indices
         _indices.clear();
 
@@ -340,7 +347,7 @@ class ui_text
             _text.set_line_wrap(i, _x_alert_wrap, _y_alert_wrap);
         }
 
-        // Add 11 debug entries
+        // Add 16 debug entries
         for (size_t i = _debug; i < _stream; i++)
         {
             _text.add_text("", 0, 0);
@@ -657,6 +664,43 @@ class ui_text
         _ss << "INSTANCES: " << insts;
         _text.set_text(_debug + 10, _ss.str());
     }
+    inline void set_debug_frame(const frame_summary &frame)
+    {
+        // Clear and reset the stream
+        clear_stream();
+
+        // Update frame time percentiles
+        _ss << "FRAME MS- P50: " << frame.p50 << ", P95: " << frame.p95 << ", P99: " << frame.p99 << ", MAX: " << frame.max;
+        _text.set_text(_debug + 11, _ss.str());
+    }
+    inline void set_debug_update(const frame_summary &update)
+    {
+        // Clear and reset the stream
+        clear_stream();
+
+        // Update world update time percentiles
+        _ss << "UPDATE MS- P50: " << update.p50 << ", P95: " << update.p95 << ", P99: " << update.p99 << ", MAX: " << update.max;
+        _text.set_text(_debug + 12, _ss.str());
+    }
+    inline void set_debug_memory(const size_t resident, const size_t reserved)
+    {
+        // Clear and reset the stream
+        clear_stream();
+
+        // Update subsystem memory totals
+        const double mb = 1.0 / (1024.0 * 1024.0);
+        _ss << "MEMORY MB- RESIDENT: " << resident * mb << ", RESERVED: " << reserved * mb;
+        _text.set_text(_debug + 13, _ss.str());
+    }
+    inline void set_debug_sleep(const size_t awake, const size_t asleep)
+    {
+        // Clear and reset the stream
+        clear_stream();
+
+        // Update awake and sleeping drop counts
+        _ss << "DROPS- AWAKE: " << awake << ", ASLEEP: " << asleep;
+        _text.set_text(_debug + 14, _ss.str());
+    }
     inline void set_debug_target(const std::string &str)
     {
         // Clear and reset the stream
@@ -664,15 +708,15 @@ class ui_text
 
         // Update FPS and IDLE
         _ss << "TARGET: " << str;
-        _text.set_text(_debug + 11, _ss.str());
+        _text.set_text(_debug + 15, _ss.str());
     }
     inline void set_debug_version(const std::string &str)
     {
-        _text.set_text(_debug + 12, str);
+        _text.set_text(_debug + 16, str);
     }
     inline void set_debug_game_mode(const std::string &str)
     {
-        _text.set_text(_debug + 13, str);
+        _text.set_text(_debug + 17, str);
     }
     inline void set_focus(const std::string &str)
     {
@@ -186,38 +186,34 @@ class uniforms
         // Update camera position
         _ub.set_vector(cam.get_position(), _cam_pos_id);
     }
-    inline void update_chests(const std::vector<min::mat4<float>> &matrices)
+    inline void update_chests(const std::vector<min::mat4<float>> &matrices, const size_t begin, const size_t end)
     {
-        // Upload all chest matrices
-        const size_t size = matrices.size();
-        for (size_t i = 0; i < size; i++)
+        // Upload the changed chest matrices
+        for (size_t i = begin; i < end; i++)
         {
             _ub.set_matrix(matrices[i], _chest_id[i]);
         }
     }
-    inline void update_drones(const std::vector<min::mat4<float>> &matrices)
+    inline void update_drones(const std::vector<min::mat4<float>> &matrices, const size_t begin, const size_t end)
     {
-        // Upload all drone matrices
-        const size_t size = matrices.size();
-        for (size_t i = 0; i < size; i++)
+        // Upload the changed drone matrices
+        for (size_t i = begin; i < end; i++)
         {
             _ub.set_matrix(matrices[i], _drone_id[i]);
         }
     }
-    inline void update_drops(const std::vector<min::mat4<float>> &matrices)
+    inline void update_drops(const std::vector<min::mat4<float>> &matrices, const size_t begin, const size_t end)
     {
-        // Upload all drop matrices
-        const size_t size = matrices.size();
-        for (size_t i = 0; i < size; i++)
+        // Upload the changed drop matrices
+        for (size_t i = begin; i < end; i++)
         {
             _ub.set_matrix(matrices[i], _drop_id[i]);
         }
     }
-    inline void update_explosives(const std::vector<min::mat4<float>> &matrices)
+    inline void update_explosives(const std::vector<min::mat4<float>> &matrices, const size_t begin, const size_t end)
     {
-        // Upload all explosive matrices
-        const size_t size = matrices.size();
-        for (size_t i = 0; i < size; i++)
+        // Upload the changed explosive matrices
+        for (size_t i = begin; i < end; i++)
         {
             _ub.set_matrix(matrices[i], _explode_id[i]);
         }
@@ -234,11 +230,10 @@ class uniforms
     {
         _ub.set_matrix(model, _md5_id);
     }
-    inline void update_missiles(const std::vector<min::mat4<float>> &matrices)
+    inline void update_missiles(const std::vector<min::mat4<float>> &matrices, const size_t begin, const size_t end)
     {
-        // Upload all missile matrices
-        const size_t size = matrices.size();
-        for (size_t i = 0; i < size; i++)
+        // Upload the changed missile matrices
+        for (size_t i = begin; i < end; i++)
         {
             _ub.set_matrix(matrices[i], _missile_id[i]);
         }
@@ -18,18 +18,18 @@ along with Beyond Dying Skies.  If not, see <http://www.gnu.org/licenses/>.
 #ifndef _BDS_WORK_QUEUE_BDS_
 #define _BDS_WORK_QUEUE_BDS_
 
-#include <min/thread_pool.h>
+#include <game/task_pool.h>
 namespace game
 {
 
-// Global thread pool for creating terrain
+// Global work stealing pool for creating terrain
 class work_queue
 {
   public:
-    static min::thread_pool worker;
+    static task_pool worker;
 };
 
-min::thread_pool work_queue::worker;
+task_pool work_queue::worker;
 }
 
 #endif
@@ -18,6 +18,7 @@ along with Beyond Dying Skies.  If not, see <http://www.gnu.org/licenses/>.
 #ifndef _BDS_WORLD_BDS_
 #define _BDS_WORLD_BDS_
 
+#include <algorithm>
 #include <chrono>
 #include <cmath>
 #include <cstdint>
@@ -27,19 +28,26 @@ along with Beyond Dying Skies.  If not, see <http://www.gnu.org/licenses/>.
 #include <game/def.h>
 #include <game/drones.h>
 #include <game/drops.h>
+#include <game/entity.h>
 #include <game/explosive.h>
+#include <game/frame_graph.h>
+#include <game/frame_stats.h>
 #include <game/id.h>
 #include <game/load_state.h>
+#include <game/memory_report.h>
 #include <game/missiles.h>
 #include <game/options.h>
 #include <game/particle.h>
 #include <game/player.h>
+#include <game/profiler.h>
 #include <game/sky.h>
 #include <game/sound.h>
 #include <game/static_instance.h>
 #include <game/swatch.h>
 #include <game/terrain.h>
 #include <game/uniforms.h>
+#include <game/work_queue.h>
+#include <iostream>
 #include <min/camera.h>
 #include <min/grid.h>
 #include <min/physics_nt.h>
@@ -59,12 +67,12 @@ class world
     static constexpr float _damage_charge = 100.0;
     static constexpr float _damage_ex = 50.0;
     static constexpr float _damage_miss = 100.0;
-    static constexpr float _damping = 0.1;
     static constexpr float _explode_size = 100.0;
     static constexpr float _explode_speed = 5.0;
     static constexpr float _explode_time = 5.0;
+    static constexpr size_t _max_ticks = 9;
+    static constexpr float _max_travel = 0.25;
     static constexpr float _spawn_limit = 5.0;
-    static constexpr float _time_step = 1.0 / _physics_frames;
     static constexpr size_t _pre_max_scale = 5;
     static constexpr size_t _pre_max_vol = _pre_max_scale * _pre_max_scale * _pre_max_scale;
     static constexpr size_t _ray_max_dist = 100;
@@ -111,6 +119,7 @@ class world
     drops _drops;
     explosives _explosives;
     missiles _missiles;
+    entity_store _entities;
     const std::string _invalid_str;
 
     // Random stuff
@@ -124,6 +133,17 @@ class world
     std::uniform_real_distribution<float> _scat_dist;
     std::mt19937 _gen;
 
+    // Frame update graph
+    frame_graph _frame;
+    frame_stats _frame_stats;
+    min::camera<float> *_frame_cam;
+    float _frame_dt;
+    bool _frame_dump;
+    bool _frame_track;
+
+    // Physics time not yet simulated
+    float _accum;
+
     // Callback functions
     inline auto dmg_default_call()
     {
@@ -246,6 +266,9 @@ class world
         const auto f = [](const min::vec3<float> &, const block_id) -> void {
         };
 
+        // Wake drops resting near the removed geometry
+        _drops.wake(p, wake_radius(scale));
+
         // Offset remove radius for geometry removal
         return _grid.set_geometry(_grid.snap(center_radius(p, scale)), scale, offset, block_id::EMPTY, f);
     }
@@ -257,6 +280,11 @@ class world
         // return center position
         return center;
     }
+    static inline float wake_radius(const min::tri<unsigned> &scale)
+    {
+        // Reach one cell past the largest edited extent
+        return std::max(scale.x(), std::max(scale.y(), scale.z())) + 1.0;
+    }
     inline size_t character_load()
     {
         // Is this a new game?
@@ -298,6 +326,12 @@ class world
     }
     inline void drone_damage(const size_t drone_index, const min::tri<unsigned> &scale, const min::vec3<float> &dir, const float size, const float damage)
     {
+        // Ignore drones already killed this step
+        if (!_drones.valid(drone_index))
+        {
+            return;
+        }
+
         // Cache the drone position, no reference here
         const min::vec3<float> p = _drones.position(drone_index);
 
@@ -375,6 +409,9 @@ class world
         const min::tri<int> offset(1, 1, 1);
         _grid.set_geometry(center, scale, offset, block_id::EMPTY, f);
 
+        // Wake drops resting near the explosion
+        _drops.wake(p, wake_radius(scale));
+
         // Calculate explosion speed
         const min::vec3<float> speed = dir * _explode_speed;
 
@@ -679,6 +716,9 @@ class world
 
         // Reserve space for view chunks
         _view_chunk_index.reserve(view_chunk_size * view_chunk_size * view_chunk_size);
+
+        // Reserve space for every entity transform
+        _entities.reserve(static_instance::max_alloc());
     }
     inline void set_collision_callbacks()
     {
@@ -712,11 +752,11 @@ class world
                 // Get the atlas id from the drop
                 const item_id it_id = id_from_atlas(atlas);
 
-                // Add drop to inventory
-                uint_fast8_t count = 1;
+                // Add the drop stack to inventory
+                uint_fast8_t count = this->_drops.count(index);
                 inv.add(it_id, count);
 
-                // If we picked it up
+                // If we picked it all up
                 if (count == 0)
                 {
                     // Calculate random extra item
@@ -740,6 +780,11 @@ class world
                     // Add player experience
                     stat.add_exp(exp);
                 }
+                else
+                {
+                    // Keep what did not fit in the inventory
+                    this->_drops.set_count(index, count);
+                }
             }
         };
 
@@ -756,11 +801,14 @@ class world
             {
                 if (this->_player.is_explodeable())
                 {
+                    // Cache the explosive position before removing it
+                    const min::vec3<float> p = b1.get_position();
+
                     // Remove this explosive
                     this->_explosives.explode(exp_index);
 
                     // Explode player
-                    this->explode_call(this->dmg_drone_call(), this->sound_ex_call())(this->_explosives.position(exp_index), this->_explosives.get_scale(), block_id::EMPTY);
+                    this->explode_call(this->dmg_drone_call(), this->sound_ex_call())(p, this->_explosives.get_scale(), block_id::EMPTY);
                 }
             }
             else if (b2.get_id() == id_value(static_id::DRONE))
@@ -794,11 +842,14 @@ class world
             {
                 if (this->_player.is_explodeable())
                 {
+                    // Cache the missile position before removing it
+                    const min::vec3<float> p = b1.get_position();
+
                     // Remove this missile
                     this->_missiles.explode(miss_index);
 
                     // Explode player
-                    this->explode_call(this->dmg_drone_call(), this->sound_ex_call())(this->_missiles.position(miss_index), this->_missiles.get_scale(), block_id::EMPTY);
+                    this->explode_call(this->dmg_drone_call(), this->sound_ex_call())(p, this->_missiles.get_scale(), block_id::EMPTY);
                 }
             }
             else if (b2.get_id() == id_value(static_id::DRONE))
@@ -838,6 +889,43 @@ class world
 
         return min::vec3<float>(x, y, z);
     }
+    inline void update_preview()
+    {
+        // Get ray from camera to destination
+        const min::ray<float, min::vec3> &r = _player.ray();
+
+        // Trace a ray to the destination point to find placement position, return point is snapped
+        // swatch_copy_place == true is copy, == false is default place mode
+        if (_swatch_copy_place)
+        {
+            block_id value;
+            _preview = _grid.ray_trace_last(r, 6, value);
+        }
+        else
+        {
+            _preview = _grid.ray_trace_prev(r, 6);
+        }
+
+        // Update offset x-vector
+        if (_frame_cam->get_forward().x() >= 0.0)
+        {
+            _cached_offset.x(1);
+        }
+        else
+        {
+            _cached_offset.x(-1);
+        }
+
+        // Update offset z-vector
+        if (_frame_cam->get_forward().z() >= 0.0)
+        {
+            _cached_offset.z(1);
+        }
+        else
+        {
+            _cached_offset.z(-1);
+        }
+    }
     inline void update_all_chunks()
     {
         // For all chunk meshes
@@ -855,14 +943,33 @@ class world
             }
         }
     }
+    inline static size_t solve_count(const float speed, const float span, const size_t ticks)
+    {
+        // Number of solves that keep travel under the limit per solve
+        const size_t n = std::ceil(speed * span / _max_travel);
+        return std::min(std::max(n, static_cast<size_t>(1)), ticks);
+    }
     inline void update_world_physics(const float dt)
     {
-        // Calculate number of physics steps
-        const size_t steps = std::round(dt / _time_step);
-        if (steps > 0)
+        const profile_scope scope("world::update_world_physics");
+        const memory_scope mem(mem_tag::PHYSICS);
+
+        // Accumulate frame time and consume it in whole physics ticks
+        _accum += dt;
+        size_t ticks = static_cast<size_t>(_accum / _time_step);
+        _accum -= ticks * _time_step;
+
+        // Cap catch up work, a long frame slows the game instead of spiralling
+        if (ticks > _max_ticks)
+        {
+            ticks = _max_ticks;
+            _accum = 0.0;
+        }
+
+        if (ticks > 0)
         {
             // Friction Coefficient
-            const float friction = -10.0 / steps;
+            const float friction = -10.0 / ticks;
             const float drop_friction = friction * 2.0;
 
             // Get player position and player level
@@ -872,50 +979,142 @@ class world
             // Send drones after the player
             _drones.set_destination(p);
 
-            // Solve all physics timesteps
-            for (size_t i = 0; i < steps; i++)
+            // The player sets the number of solves, projectiles sweep each solve
+            const float span = ticks * _time_step;
+            const size_t solves = solve_count(_player.velocity().magnitude(), span, ticks);
+
+            // Slow groups only collide once on the last solve
+            const bool drone_all = solve_count(_drones.max_speed(), span, ticks) > 1;
+            const bool drop_all = solve_count(_drops.max_speed(), span, ticks) > 1;
+
+            // Solve all physics steps
+            size_t done = 0;
+            for (size_t i = 0; i < solves; i++)
             {
+                // Spread ticks evenly across the solves
+                const size_t next = ((i + 1) * ticks) / solves;
+                const size_t kk = next - done;
+                const bool last = (i + 1) == solves;
+                done = next;
+
                 // Update the player before frame
-                _player.update_pre_frame(friction);
+                _player.update_pre_frame(friction, kk);
 
                 // Update chests on this frame
                 _chests.update_frame();
 
                 // Update drones on this frame
-                _drones.update_frame(_grid, player_level, drone_respawn_call(), explode_call(dmg_default_call(), sound_choose_call()));
+                if (drone_all || last)
+                {
+                    const size_t drone_ticks = (drone_all) ? kk : ticks;
+                    _drones.update_frame(_grid, drone_ticks, player_level, drone_respawn_call(), explode_call(dmg_default_call(), sound_choose_call()));
+                }
 
-                // Update drops on this frame
-                _drops.update_frame(_grid, drop_friction, explode_drop_call());
+                // Update drops on this frame, friction covers every skipped tick
+                if (drop_all || last)
+                {
+                    const float drop_fric = (drop_all) ? drop_friction : drop_friction * ticks / kk;
+                    _drops.update_frame(_grid, p, drop_fric, explode_drop_call());
+                }
 
                 // Update explosives on this frame
-                _explosives.update_frame(_grid, explode_call(dmg_default_call(), sound_choose_call()));
+                _explosives.update_frame(_grid, kk * _time_step, explode_call(dmg_default_call(), sound_choose_call()));
 
                 // Update missiles on this frame
-                _missiles.update_frame(_grid, explode_call(dmg_default_call(), sound_choose_call()));
+                _missiles.update_frame(_grid, kk * _time_step, explode_call(dmg_default_call(), sound_choose_call()));
 
                 // Solve all collisions
-                _simulation.solve(_time_step, _damping);
+                _simulation.solve(kk * _time_step, _damping);
 
                 // Update the player after frame
                 _player.update_post_frame(_grid, explode_default_call());
             }
 
-            // Update the chest positions
-            _chests.update();
-
-            // Update the drones positions
-            _drones.update(_grid, p, player_level, launch_missile_call());
+            // Gather every entity transform once
+            _entities.clear();
+            _chests.gather(_entities);
+            _drones.gather(_entities);
+            _drops.gather(_entities);
+            _explosives.gather(_entities);
+            _missiles.gather(_entities);
+            _entities.load(_simulation);
 
-            // Update the drop positions
-            _drops.update(_grid, dt);
+            // Write the instance matrices and spin drops and explosives
+            _entities.write(_instance);
+            _entities.rotate(_instance, dt);
 
-            // Update the explosive positions
-            _explosives.update(_grid, dt);
+            // Aim the drones
+            _drones.update(_entities, p, player_level, launch_missile_call());
 
             // Update any missiles
-            _missiles.update(_grid);
+            _missiles.update(_entities);
+        }
+    }
+
+    inline void update_view_chunks()
+    {
+        // For all chunk meshes
+        for (const auto &i : _view_chunk_index)
+        {
+            // If the chunk needs updating
+            if (_grid.is_update_chunk(i))
+            {
+                // Upload contents to the vertex buffer
+                _terrain.upload_geometry(i, _grid.get_chunk(i));
+
+                // Flag that we updated the chunk
+                _grid.update_chunk(i);
+            }
         }
     }
+    inline void build_frame_graph()
+    {
+        // Update the physics and AI in world, callbacks play sounds so stay on the main thread
+        const size_t physics = _frame.add_main("physics", {}, [this]() {
+            this->update_world_physics(this->_frame_dt);
+        });
+
+        // Reset explosion state and update player vectors
+        const size_t player = _frame.add("player", {physics}, [this]() {
+            this->_player.reset_explode();
+            this->_player.update(*this->_frame_cam);
+        });
+
+        // Detect if we crossed a chunk boundary
+        const size_t chunk = _frame.add("chunk", {physics}, [this]() {
+            this->_grid.update_current_chunk(this->_player.position());
+        });
+
+        // Get surrounding chunks for drawing
+        const size_t view = _frame.add("view", {chunk}, [this]() {
+            this->_grid.update_view_chunk_index(*this->_frame_cam, this->_view_chunk_index);
+        });
+
+        // Flush out the update chunks, only writes chunk meshes so ray traces can read the grid
+        const size_t flush = _frame.add("flush", {physics}, [this]() {
+            this->_grid.flush_chunk_updates();
+        });
+
+        // Set the player target, this queries the simulation
+        _frame.add("target", {player}, [this]() {
+            this->_player.update_target(this->_grid, this->_frame_track, _ray_max_dist);
+        });
+
+        // Update the static instance culling, the view distance needs the current chunk
+        _frame.add("instance", {chunk}, [this]() {
+            this->_instance.update(this->_grid, *this->_frame_cam);
+        });
+
+        // Trace the placement preview while chunks are flushed
+        _frame.add("preview", {player}, [this]() {
+            this->update_preview();
+        });
+
+        // Upload updated view chunks, OpenGL must stay on the main thread
+        _frame.add_main("upload", {view, flush}, [this]() {
+            this->update_view_chunks();
+        });
+    }
 
   public:
     world(const options &opt, particle &particles, sound &s, const uniforms &uniforms)
@@ -952,13 +1151,28 @@ class world
           _health_dist(0.75, 1.5),
           _miss_dist(-0.5, 0.5),
           _scat_dist(-0.1, 0.1),
-          _gen(std::chrono::high_resolution_clock::now().time_since_epoch().count())
+          _gen(std::chrono::high_resolution_clock::now().time_since_epoch().count()),
+          _frame_stats(opt.grid(), opt.chunk(), opt.view(), 600),
+          _frame_cam(nullptr),
+          _frame_dt(0.0),
+          _frame_dump(opt.is_frame_graph()),
+          _frame_track(false),
+          _accum(0.0)
     {
         // Set the collision elasticity of the physics simulation
-        _simulation.set_elasticity(0.1);
+        _simulation.set_elasticity(_elasticity);
+
+        // Solve drop collisions on the work queue
+        if (opt.is_parallel_physics())
+        {
+            _drops.set_pool(&work_queue::worker);
+        }
 
         // Reserve space for used vectors
         reserve_memory(opt.view());
+
+        // Create the frame update graph
+        build_frame_graph();
     }
     inline void load(options &opt)
     {
@@ -1003,6 +1217,7 @@ class world
         _drops.reset();
         _explosives.reset();
         _missiles.reset();
+        _entities.reset();
 
         // Prune physics bodies from simulation
         _simulation.clear();
@@ -1038,6 +1253,9 @@ class world
 
             _grid.set_geometry(_preview, _scale, _preview_offset, _atlas_id, f);
         }
+
+        // Wake drops that may now be inside the new geometry
+        _drops.wake(_preview, wake_radius(_scale));
     }
     inline bool can_add_block() const
     {
@@ -1079,6 +1297,10 @@ class world
     {
         return _atlas_id;
     }
+    inline const chests &get_chests() const
+    {
+        return _chests;
+    }
     inline size_t get_chunks_in_view() const
     {
         return _view_chunk_index.size();
@@ -1091,6 +1313,18 @@ class world
     {
         return _drops;
     }
+    inline const explosives &get_explosives() const
+    {
+        return _explosives;
+    }
+    inline const frame_graph &get_frame_graph() const
+    {
+        return _frame;
+    }
+    inline const frame_stats &get_frame_stats() const
+    {
+        return _frame_stats;
+    }
     inline const cgrid &get_grid() const
     {
         return _grid;
@@ -1107,6 +1341,10 @@ class world
     {
         return _state;
     }
+    inline const missiles &get_missiles() const
+    {
+        return _missiles;
+    }
     inline player &get_player()
     {
         return _player;
@@ -1240,6 +1478,12 @@ class world
         // Generate new preview
         generate_preview();
     }
+    inline void memory(memory_report &report) const
+    {
+        _grid.memory(report);
+        _terrain.memory(report);
+        _instance.memory(report);
+    }
     inline void portal()
     {
         // Get default spawn point
@@ -1308,11 +1552,24 @@ class world
         // Set the state
         _state.set_state(_player.position(), cam, _player.get_inventory(), _player.get_stats(), _instance);
 
-        // Save the state
-        _state.save(opt);
+        // Snapshot the state
+        std::vector<uint8_t> state;
+        _state.serialize(opt, state);
 
-        // Save the world state
-        _grid.save(opt);
+        // Save the world, the state is written once the world on disk matches it
+        _grid.save(opt, std::move(state));
+    }
+    inline bool save_failed() const
+    {
+        return _grid.save_failed();
+    }
+    inline float save_progress() const
+    {
+        return _grid.save_progress();
+    }
+    inline void save_wait()
+    {
+        _grid.save_wait();
     }
     template <typename R>
     inline size_t scatter_ray(const min::tri<unsigned> &scale, const float size, const R &ray_call)
@@ -1499,78 +1756,33 @@ class world
     }
     inline void update(min::camera<float> &cam, const bool track_target, const float dt)
     {
-        // Update the physics and AI in world
-        update_world_physics(dt);
-
-        // Get player position
-        const min::vec3<float> &p = _player.position();
-
-        // Reset explosion state
-        _player.reset_explode();
-
-        // Update player vectors and set target
-        _player.update(cam);
-        _player.update_target(_grid, track_target, _ray_max_dist);
-
-        // Detect if we crossed a chunk boundary
-        _grid.update_current_chunk(p);
-
-        // Get surrounding chunks for drawing
-        _grid.update_view_chunk_index(cam, _view_chunk_index);
-
-        // Flush out the update chunks
-        _grid.flush_chunk_updates();
+        const profile_scope scope("world::update");
 
-        // For all chunk meshes
-        for (const auto &i : _view_chunk_index)
-        {
-            // If the chunk needs updating
-            if (_grid.is_update_chunk(i))
-            {
-                // Upload contents to the vertex buffer
-                _terrain.upload_geometry(i, _grid.get_chunk(i));
+        // Cache the frame parameters for the graph nodes
+        _frame_cam = &cam;
+        _frame_dt = dt;
+        _frame_track = track_target;
 
-                // Flag that we updated the chunk
-                _grid.update_chunk(i);
-            }
-        }
+        // Run the frame update graph on the work queue
+        _frame.execute(work_queue::worker);
 
-        // Update the static instance frustum culling
-        _instance.update(_simulation, _grid, cam);
+        // Tag frame statistics with the entity counts
+        frame_tags tags;
+        tags.chunks = _view_chunk_index.size();
+        tags.insts = _instance.get_inst_in_view();
+        tags.chests = _chests.size();
+        tags.drones = _drones.size();
+        tags.drops = _drops.size();
+        tags.explosives = _explosives.size();
+        tags.missiles = _missiles.size();
 
-        // Get ray from camera to destination
-        const min::ray<float, min::vec3> &r = _player.ray();
+        // Record the frame time and the graph node times
+        _frame_stats.add(dt * 1000.0, _frame, tags);
 
-        // Trace a ray to the destination point to find placement position, return point is snapped
-        // swatch_copy_place == true is copy, == false is default place mode
-        if (_swatch_copy_place)
+        // Print the critical path if enabled
+        if (_frame_dump)
         {
-            block_id value;
-            _preview = _grid.ray_trace_last(r, 6, value);
-        }
-        else
-        {
-            _preview = _grid.ray_trace_prev(r, 6);
-        }
-
-        // Update offset x-vector
-        if (cam.get_forward().x() >= 0.0)
-        {
-            _cached_offset.x(1);
-        }
-        else
-        {
-            _cached_offset.x(-1);
-        }
-
-        // Update offset z-vector
-        if (cam.get_forward().z() >= 0.0)
-        {
-            _cached_offset.z(1);
-        }
-        else
-        {
-            _cached_offset.z(-1);
+            _frame.dump(std::cout);
         }
     }
 };
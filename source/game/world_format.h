@@ -0,0 +1,566 @@
+/* Copyright [2013-2018] [Aaron Springstroh, Minimal Graphics Library]
+
+This file is part of the Beyond Dying Skies.
+
+Beyond Dying Skies is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+Beyond Dying Skies is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with Beyond Dying Skies.  If not, see <http://www.gnu.org/licenses/>.
+*/
+#ifndef _BDS_WORLD_FORMAT_BDS_
+#define _BDS_WORLD_FORMAT_BDS_
+
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <functional>
+#include <game/id.h>
+#include <game/lz.h>
+#include <game/profiler.h>
+#include <game/work_queue.h>
+#include <iostream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+namespace game
+{
+
+// Chunked world save, a header and offset table followed by one record per chunk
+// Records are run length or palette encoded and optionally LZ compressed, so they encode and decode in parallel
+class world_format
+{
+  private:
+    static constexpr uint32_t _magic = 0x57534442;
+    static constexpr uint32_t _version = 2;
+    static constexpr size_t _header_v1 = 6 * sizeof(uint32_t);
+    static constexpr size_t _header = 7 * sizeof(uint32_t);
+    static constexpr uint8_t _rle = 0;
+    static constexpr uint8_t _palette = 1;
+    static constexpr uint8_t _raw = 2;
+    static constexpr uint8_t _lz = 0x80;
+    static constexpr size_t _lz_min = 16;
+    static constexpr size_t _palette_max = 16;
+
+    // Per thread buffers for one chunk
+    class scratch
+    {
+      public:
+        std::vector<uint8_t> cells;
+        std::vector<uint8_t> rle;
+        std::vector<uint8_t> palette;
+        std::vector<uint8_t> packed;
+    };
+
+    std::vector<std::vector<uint8_t>> _records;
+
+    static inline scratch &local()
+    {
+        static thread_local scratch s;
+        return s;
+    }
+    static inline uint8_t to_byte(const block_id id)
+    {
+        return static_cast<uint8_t>(static_cast<int8_t>(id));
+    }
+    static inline block_id from_byte(const uint8_t b)
+    {
+        return static_cast<block_id>(static_cast<int8_t>(b));
+    }
+    static inline uint32_t read_u32(const uint8_t *const p)
+    {
+        // Little endian
+        return static_cast<uint32_t>(p[0]) | (static_cast<uint32_t>(p[1]) << 8) | (static_cast<uint32_t>(p[2]) << 16) | (static_cast<uint32_t>(p[3]) << 24);
+    }
+    static inline bool reject(const std::string &reason)
+    {
+        // A malformed file falls back to a new world like a raw save of the wrong size
+        std::cout << "world_format: " << reason << ", regenerating world" << std::endl;
+        return false;
+    }
+    static inline void write_u32(std::vector<uint8_t> &out, const uint32_t value)
+    {
+        // Little endian
+        out.push_back(static_cast<uint8_t>(value));
+        out.push_back(static_cast<uint8_t>(value >> 8));
+        out.push_back(static_cast<uint8_t>(value >> 16));
+        out.push_back(static_cast<uint8_t>(value >> 24));
+    }
+    static inline bool read_var(const uint8_t *&in, const uint8_t *const end, size_t &out)
+    {
+        // Seven bits per byte, high bit marks another byte
+        out = 0;
+        for (size_t shift = 0; in < end && shift < 64; shift += 7)
+        {
+            const uint8_t b = *in++;
+            out |= static_cast<size_t>(b & 0x7F) << shift;
+            if ((b & 0x80) == 0)
+            {
+                return true;
+            }
+        }
+
+        return false;
+    }
+    static inline void write_var(std::vector<uint8_t> &out, size_t value)
+    {
+        // Seven bits per byte, high bit marks another byte
+        while (value >= 0x80)
+        {
+            out.push_back(static_cast<uint8_t>(value | 0x80));
+            value >>= 7;
+        }
+        out.push_back(static_cast<uint8_t>(value));
+    }
+    template <typename F>
+    static inline void visit(const size_t scale, const size_t chunk, const size_t index, const F &f)
+    {
+        // Chunk offset in cells
+        const size_t axis = scale / chunk;
+        const size_t cx = (index / (axis * axis)) * chunk;
+        const size_t cy = ((index / axis) % axis) * chunk;
+        const size_t cz = (index % axis) * chunk;
+
+        // Visit the chunk cells in grid key order
+        size_t n = 0;
+        for (size_t x = 0; x < chunk; x++)
+        {
+            for (size_t y = 0; y < chunk; y++)
+            {
+                const size_t row = ((cx + x) * scale + (cy + y)) * scale + cz;
+                for (size_t z = 0; z < chunk; z++)
+                {
+                    f(n++, row + z);
+                }
+            }
+        }
+    }
+    static inline void encode_rle(const std::vector<uint8_t> &cells, std::vector<uint8_t> &out)
+    {
+        // Value followed by the run length
+        out.clear();
+        const size_t size = cells.size();
+        for (size_t i = 0; i < size;)
+        {
+            size_t j = i + 1;
+            while (j < size && cells[j] == cells[i])
+            {
+                j++;
+            }
+            out.push_back(cells[i]);
+            write_var(out, j - i);
+            i = j;
+        }
+    }
+    static inline bool encode_palette(const std::vector<uint8_t> &cells, std::vector<uint8_t> &out)
+    {
+        // Map each value to its palette index in first seen order
+        uint8_t index[256];
+        bool used[256] = {};
+        uint8_t values[_palette_max];
+        size_t count = 0;
+        for (const uint8_t c : cells)
+        {
+            if (!used[c])
+            {
+                // Too many values to beat the raw encoding
+                if (count == _palette_max)
+                {
+                    return false;
+                }
+                used[c] = true;
+                index[c] = static_cast<uint8_t>(count);
+                values[count++] = c;
+            }
+        }
+
+        // Pack indices with the fewest power of two bits
+        const size_t bits = (count <= 2) ? 1 : (count <= 4) ? 2 : 4;
+        out.clear();
+        out.push_back(static_cast<uint8_t>(count - 1));
+        out.insert(out.end(), values, values + count);
+        const size_t start = out.size();
+        out.resize(start + (cells.size() * bits + 7) / 8, 0);
+        const size_t size = cells.size();
+        for (size_t i = 0; i < size; i++)
+        {
+            const size_t bit = i * bits;
+            out[start + bit / 8] |= static_cast<uint8_t>(index[cells[i]] << (bit % 8));
+        }
+
+        return true;
+    }
+    static inline void encode_cells(const bool compress, std::vector<uint8_t> &out)
+    {
+        scratch &s = local();
+
+        // Pick the smallest of run length, palette and raw
+        encode_rle(s.cells, s.rle);
+        uint8_t mode = _rle;
+        const std::vector<uint8_t> *payload = &s.rle;
+        if (s.rle.size() > s.cells.size())
+        {
+            mode = _raw;
+            payload = &s.cells;
+        }
+        if (encode_palette(s.cells, s.palette) && s.palette.size() < payload->size())
+        {
+            mode = _palette;
+            payload = &s.palette;
+        }
+
+        // Keep the LZ pass only if it saves space
+        out.clear();
+        if (compress && payload->size() >= _lz_min)
+        {
+            s.packed.clear();
+            lz::compress(payload->data(), payload->size(), s.packed);
+            if (s.packed.size() + 4 < payload->size())
+            {
+                out.push_back(mode | _lz);
+                write_var(out, payload->size());
+                out.insert(out.end(), s.packed.begin(), s.packed.end());
+                return;
+            }
+        }
+
+        // Store the payload as is
+        out.push_back(mode);
+        out.insert(out.end(), payload->begin(), payload->end());
+    }
+    static inline bool decode_payload(const uint8_t mode, const uint8_t *in, const uint8_t *const end, std::vector<uint8_t> &cells)
+    {
+        const size_t size = cells.size();
+        if (mode == _rle)
+        {
+            // Expand value and run pairs
+            size_t n = 0;
+            while (in < end)
+            {
+                const uint8_t value = *in++;
+                size_t run;
+                if (!read_var(in, end, run) || run > size - n)
+                {
+                    return false;
+                }
+                std::fill(cells.begin() + n, cells.begin() + n + run, value);
+                n += run;
+            }
+
+            return n == size;
+        }
+        else if (mode == _palette)
+        {
+            // Read the palette
+            if (in == end)
+            {
+                return false;
+            }
+            const size_t count = static_cast<size_t>(*in++) + 1;
+            if (count > _palette_max || static_cast<size_t>(end - in) < count)
+            {
+                return false;
+            }
+            const uint8_t *const values = in;
+            in += count;
+
+            // Unpack the indices
+            const size_t bits = (count <= 2) ? 1 : (count <= 4) ? 2 : 4;
+            const size_t mask = (static_cast<size_t>(1) << bits) - 1;
+            if (static_cast<size_t>(end - in) != (size * bits + 7) / 8)
+            {
+                return false;
+            }
+            for (size_t i = 0; i < size; i++)
+            {
+                const size_t bit = i * bits;
+                const size_t p = (in[bit / 8] >> (bit % 8)) & mask;
+                if (p >= count)
+                {
+                    return false;
+                }
+                cells[i] = values[p];
+            }
+
+            return true;
+        }
+        else if (mode == _raw)
+        {
+            // Copy the cells
+            if (static_cast<size_t>(end - in) != size)
+            {
+                return false;
+            }
+            std::copy(in, end, cells.begin());
+
+            return true;
+        }
+
+        // Unknown encoding
+        return false;
+    }
+    static inline bool decode_chunk(std::vector<block_id> &grid, const size_t scale, const size_t chunk, const size_t index, const uint8_t *in, const uint8_t *const end)
+    {
+        scratch &s = local();
+        s.cells.resize(chunk * chunk * chunk);
+
+        // Read the encoding
+        if (in == end)
+        {
+            return false;
+        }
+        const uint8_t mode = *in++;
+
+        // Inflate the payload first if it was LZ compressed
+        if (mode & _lz)
+        {
+            size_t size;
+            if (!read_var(in, end, size) || size > s.cells.size() * 2 + 16)
+            {
+                return false;
+            }
+            s.packed.resize(size);
+            if (!lz::decompress(in, end - in, s.packed.data(), size))
+            {
+                return false;
+            }
+            const uint8_t *const data = s.packed.data();
+            if (!decode_payload(mode & ~_lz, data, data + size, s.cells))
+            {
+                return false;
+            }
+        }
+        else if (!decode_payload(mode, in, end, s.cells))
+        {
+            return false;
+        }
+
+        // Scatter the chunk cells
+        visit(scale, chunk, index, [&s, &grid](const size_t n, const size_t key) {
+            grid[key] = from_byte(s.cells[n]);
+        });
+
+        return true;
+    }
+
+    template <typename G, typename R>
+    inline void encode_records(const size_t scale, const size_t chunk, const bool compress, const uint32_t base, std::vector<uint8_t> &out, const G &gather, const R &run)
+    {
+        // Encode all chunks, gather fills the cells of one chunk
+        const size_t axis = scale / chunk;
+        const size_t chunks = axis * axis * axis;
+        _records.resize(chunks);
+        const auto work = [this, &gather, compress](std::mt19937 &gen, const size_t i) {
+            gather(i, local().cells);
+            encode_cells(compress, _records[i]);
+        };
+        run(work, chunks);
+
+        // Sum the record sizes
+        size_t total = 0;
+        for (const auto &r : _records)
+        {
+            total += r.size();
+        }
+        if (total > 0xFFFFFFFF)
+        {
+            throw std::runtime_error("world_format: world too large for 32 bit offsets");
+        }
+
+        // Write the header
+        out.clear();
+        out.reserve(_header + (chunks + 1) * sizeof(uint32_t) + total);
+        write_u32(out, _magic);
+        write_u32(out, _version);
+        write_u32(out, static_cast<uint32_t>(scale));
+        write_u32(out, static_cast<uint32_t>(chunk));
+        write_u32(out, compress ? 1 : 0);
+        write_u32(out, static_cast<uint32_t>(chunks));
+        write_u32(out, base);
+
+        // Write the record offsets, the last is the payload size
+        size_t offset = 0;
+        for (const auto &r : _records)
+        {
+            write_u32(out, static_cast<uint32_t>(offset));
+            offset += r.size();
+        }
+        write_u32(out, static_cast<uint32_t>(offset));
+
+        // Write the records
+        for (const auto &r : _records)
+        {
+            out.insert(out.end(), r.begin(), r.end());
+        }
+    }
+
+  public:
+    static inline bool is_format(const uint8_t *const data, const size_t size)
+    {
+        // The raw format starts with the cell count, a cube that is never the magic number
+        return size >= _header_v1 && read_u32(data) == _magic;
+    }
+    static inline uint32_t base(const uint8_t *const data, const size_t size)
+    {
+        // Identifies the saved world, version one files predate it
+        if (is_format(data, size) && read_u32(data + 4) >= 2 && size >= _header)
+        {
+            return read_u32(data + 24);
+        }
+
+        return 0;
+    }
+    static inline void gather(const std::vector<block_id> &grid, const size_t scale, const size_t chunk, const size_t index, std::vector<uint8_t> &cells)
+    {
+        // Copy the chunk cells in record order
+        cells.resize(chunk * chunk * chunk);
+        visit(scale, chunk, index, [&cells, &grid](const size_t n, const size_t key) {
+            cells[n] = to_byte(grid[key]);
+        });
+    }
+    static inline bool decode(const uint8_t *const data, const size_t size, const size_t scale, std::vector<block_id> &grid)
+    {
+        const profile_scope scope("world_format::decode");
+
+        // Check the header
+        if (!is_format(data, size))
+        {
+            return false;
+        }
+
+        // Version two added the world base id
+        const uint32_t version = read_u32(data + 4);
+        if (version != 1 && version != _version)
+        {
+            return reject("unsupported version " + std::to_string(version));
+        }
+        size_t header = _header;
+        if (version == 1)
+        {
+            header = _header_v1;
+        }
+
+        // Worlds of another size can't be loaded
+        const size_t file_scale = read_u32(data + 8);
+        const size_t chunk = read_u32(data + 12);
+        const size_t chunks = read_u32(data + 20);
+        if (file_scale != scale || grid.size() != scale * scale * scale)
+        {
+            return false;
+        }
+        else if (chunk == 0 || scale % chunk != 0 || chunks != (scale / chunk) * (scale / chunk) * (scale / chunk))
+        {
+            return reject("bad chunk layout");
+        }
+
+        // Check the offset table fits
+        const size_t table = header + (chunks + 1) * sizeof(uint32_t);
+        if (size < table || read_u32(data + table - 4) != size - table)
+        {
+            return reject("truncated world file");
+        }
+
+        // Decode all chunks in parallel, each chunk owns its cells
+        const uint8_t *const payload = data + table;
+        std::atomic<bool> bad(false);
+        const uint8_t *const offsets = data + header;
+        const auto work = [offsets, payload, scale, chunk, &grid, &bad](std::mt19937 &gen, const size_t i) {
+            const size_t begin = read_u32(offsets + i * sizeof(uint32_t));
+            const size_t end = read_u32(offsets + (i + 1) * sizeof(uint32_t));
+            if (begin > end || !decode_chunk(grid, scale, chunk, i, payload + begin, payload + end))
+            {
+                bad = true;
+            }
+        };
+        work_queue::worker.run(std::cref(work), 0, chunks);
+
+        // Check all chunks decoded
+        if (bad)
+        {
+            return reject("corrupt chunk record");
+        }
+
+        return true;
+    }
+    static inline bool decode_raw(const uint8_t *const data, const size_t size, const size_t scale, std::vector<block_id> &grid)
+    {
+        const profile_scope scope("world_format::decode_raw");
+
+        // Older saves are the cell count followed by one byte per cell
+        const size_t cubic = scale * scale * scale;
+        if (size < sizeof(uint32_t) || read_u32(data) != cubic || size - sizeof(uint32_t) != cubic || grid.size() != cubic)
+        {
+            return false;
+        }
+
+        // Copy the cells in parallel ranges
+        const uint8_t *const cells = data + sizeof(uint32_t);
+        const size_t ranges = scale;
+        const size_t range = cubic / ranges;
+        const auto work = [cells, range, &grid](std::mt19937 &gen, const size_t i) {
+            const size_t begin = i * range;
+            for (size_t j = begin; j < begin + range; j++)
+            {
+                grid[j] = from_byte(cells[j]);
+            }
+        };
+        work_queue::worker.run(std::cref(work), 0, ranges);
+
+        return true;
+    }
+    inline void encode(const std::vector<block_id> &grid, const size_t scale, const size_t chunk, const bool compress, const uint32_t base, std::vector<uint8_t> &out)
+    {
+        const profile_scope scope("world_format::encode");
+
+        // Encode chunks in parallel on the work queue
+        const auto gather_grid = [&grid, scale, chunk](const size_t i, std::vector<uint8_t> &cells) {
+            gather(grid, scale, chunk, i, cells);
+        };
+        encode_records(scale, chunk, compress, base, out, gather_grid, [](const std::function<void(std::mt19937 &, const size_t)> &work, const size_t chunks) {
+            work_queue::worker.run(std::cref(work), 0, chunks);
+        });
+    }
+    template <typename G>
+    inline void encode_serial(const size_t scale, const size_t chunk, const bool compress, const uint32_t base, std::vector<uint8_t> &out, const G &gather_chunk)
+    {
+        // Encode chunks on the calling thread, for threads that must not block the work queue
+        std::mt19937 gen;
+        encode_records(scale, chunk, compress, base, out, gather_chunk, [&gen](const std::function<void(std::mt19937 &, const size_t)> &work, const size_t chunks) {
+            for (size_t i = 0; i < chunks; i++)
+            {
+                work(gen, i);
+            }
+        });
+    }
+    inline size_t memory_resident() const
+    {
+        size_t out = _records.size() * sizeof(std::vector<uint8_t>);
+        for (const auto &r : _records)
+        {
+            out += r.size();
+        }
+
+        return out;
+    }
+    inline size_t memory_reserved() const
+    {
+        size_t out = _records.capacity() * sizeof(std::vector<uint8_t>);
+        for (const auto &r : _records)
+        {
+            out += r.capacity();
+        }
+
+        return out;
+    }
+};
+}
+
+#endif
@@ -19,7 +19,8 @@ along with Beyond Dying Skies.  If not, see <http://www.gnu.org/licenses/>.
 #define _BDS_MANDELBULB_BDS_
 
 #include <game/id.h>
-#include <min/thread_pool.h>
+#include <game/profiler.h>
+#include <game/task_pool.h>
 #include <min/vec3.h>
 
 namespace kernel
@@ -108,8 +109,10 @@ class mandelbulb
   public:
     mandelbulb() {}
     template <typename F>
-    inline void generate(min::thread_pool &pool, std::vector<game::block_id> &grid, const size_t gsize, const F &f)
+    inline void generate(game::task_pool &pool, std::vector<game::block_id> &grid, const size_t gsize, const F &f)
     {
+        const game::profile_scope scope("kernel::mandelbulb::generate");
+
         // Create working function
         const auto work = [this, &grid, gsize, &f](std::mt19937 &gen, const size_t i) {
             // Do mandelbulb on this cell if empty
@@ -19,7 +19,8 @@ along with Beyond Dying Skies.  If not, see <http://www.gnu.org/licenses/>.
 #define _BDS_TERRAIN_CREATIVE_BDS_
 
 #include <game/id.h>
-#include <min/thread_pool.h>
+#include <game/profiler.h>
+#include <game/task_pool.h>
 #include <min/vec3.h>
 
 namespace kernel
@@ -39,8 +40,10 @@ class terrain_creative
     terrain_creative(const size_t scale)
         : _scale(scale) {}
 
-    inline void generate(min::thread_pool &pool, std::vector<game::block_id> &write) const
+    inline void generate(game::task_pool &pool, std::vector<game::block_id> &write) const
     {
+        const game::profile_scope scope("kernel::terrain_creative::generate");
+
         // Create working function
         const auto work = [this, &write](std::mt19937 &gen, const size_t i) {
             // Dope minerals in base
@@ -19,8 +19,9 @@ along with Beyond Dying Skies.  If not, see <http://www.gnu.org/licenses/>.
 #define _BDS_TERRAIN_HEIGHT_BDS_
 
 #include <game/id.h>
+#include <game/profiler.h>
+#include <game/task_pool.h>
 #include <min/height_map.h>
-#include <min/thread_pool.h>
 #include <min/vec3.h>
 
 namespace kernel
@@ -46,7 +47,7 @@ class terrain_height
 
         return false;
     }
-    inline void terrain(min::thread_pool &pool, std::vector<game::block_id> &write, const min::height_map<float> &map) const
+    inline void terrain(game::task_pool &pool, std::vector<game::block_id> &write, const min::height_map<float> &map) const
     {
         // Parallelize on X axis
         const auto work = [this, &map, &write](std::mt19937 &gen, const size_t i) {
@@ -92,7 +93,7 @@ class terrain_height
         // Run height map in parallel
         pool.run(std::cref(work), 0, _scale);
     }
-    inline void plants(min::thread_pool &pool, std::vector<game::block_id> &write, const min::height_map<float> &map, const size_t size) const
+    inline void plants(game::task_pool &pool, std::vector<game::block_id> &write, const min::height_map<float> &map, const size_t size) const
     {
         // Parallelize on X axis
         const auto work = [this, &map, &write](std::mt19937 &gen, const size_t i) {
@@ -117,7 +118,7 @@ class terrain_height
         // Run height map in parallel
         pool.run(std::cref(work), 0, size);
     }
-    inline void trees(min::thread_pool &pool, std::vector<game::block_id> &write, const min::height_map<float> &map, const size_t size) const
+    inline void trees(game::task_pool &pool, std::vector<game::block_id> &write, const min::height_map<float> &map, const size_t size) const
     {
         // Parallelize on X axis
         const auto work = [this, &map, &write](std::mt19937 &gen, const size_t i) {
@@ -183,8 +184,10 @@ class terrain_height
     terrain_height(const size_t scale, const size_t start, const size_t stop)
         : _scale(scale), _start(start), _stop(stop) {}
 
-    inline void generate(min::thread_pool &pool, std::mt19937 &gen, std::vector<game::block_id> &write) const
+    inline void generate(game::task_pool &pool, std::mt19937 &gen, std::vector<game::block_id> &write) const
     {
+        const game::profile_scope scope("kernel::terrain_height::generate");
+
         // Generate height map
         const size_t level = std::ceil(std::log2(_scale));
         min::height_map<float> map(gen, level, 4.0, 8.0);
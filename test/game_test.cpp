@@ -16,7 +16,15 @@ You should have received a copy of the GNU General Public License
 along with Beyond Dying Skies.  If not, see <http://www.gnu.org/licenses/>.
 */
 #include <iostream>
+#include <tbroad.h>
+#include <tcull.h>
+#include <tray.h>
+#include <treg.h>
+#include <tsolid.h>
+#include <tsweep.h>
+#include <ttask_pool.h>
 #include <tthread_pool.h>
+#include <tworld.h>
 
 int main()
 {
@@ -24,6 +32,16 @@ int main()
     {
         bool out = true;
         out = out && test_thread_pool();
+        out = out && test_task_pool();
+        out = out && test_sweep();
+        out = out && test_solid();
+        out = out && test_ray();
+        out = out && test_broadphase();
+        out = out && test_registry();
+        out = out && test_cull();
+        out = out && test_world_format();
+        out = out && test_edit_journal();
+        out = out && test_save_writer();
         if (out)
         {
             std::cout << "Game tests passed!" << std::endl;
@@ -0,0 +1,106 @@
+/* Copyright [2013-2018] [Aaron Springstroh, Minimal Graphics Library]
+
+This file is part of the Beyond Dying Skies.
+
+Beyond Dying Skies is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+Beyond Dying Skies is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with Beyond Dying Skies.  If not, see <http://www.gnu.org/licenses/>.
+*/
+#ifndef _BDS_TEST_BROADPHASE_BDS_
+#define _BDS_TEST_BROADPHASE_BDS_
+
+#include <game/broadphase.h>
+#include <random>
+#include <stdexcept>
+#include <test.h>
+#include <vector>
+
+bool broadphase_match(const game::broadphase &broad, const std::vector<size_t> &keys)
+{
+    // Every live id must be found once, in the cell of its key
+    std::vector<size_t> seen(keys.size(), 0);
+    bool out = true;
+    broad.for_each_cell([&keys, &seen, &out](const size_t key, const std::vector<uint_fast16_t> &items) {
+        out = out && !items.empty();
+        for (const uint_fast16_t id : items)
+        {
+            out = out && keys[id] == key;
+            seen[id]++;
+        }
+    });
+
+    // Removed ids must be gone
+    const size_t none = static_cast<size_t>(-1);
+    const size_t size = keys.size();
+    for (size_t i = 0; i < size; i++)
+    {
+        out = out && seen[i] == ((keys[i] != none) ? 1 : 0);
+    }
+
+    return out;
+}
+
+bool test_broadphase()
+{
+    bool out = true;
+
+    // Ids wander over many chunk keys so emptied cells force table rebuilds
+    const size_t ids = 90;
+    const size_t none = static_cast<size_t>(-1);
+    game::broadphase broad(ids);
+    std::vector<size_t> keys(ids, none);
+    std::mt19937 gen(17);
+    std::uniform_int_distribution<size_t> pick(0, ids - 1);
+    std::uniform_int_distribution<size_t> chunk(0, 4095);
+    std::uniform_int_distribution<size_t> action(0, 9);
+    for (size_t n = 0; n < 20000; n++)
+    {
+        const size_t id = pick(gen);
+        if (action(gen) == 0)
+        {
+            broad.remove(id);
+            keys[id] = none;
+        }
+        else
+        {
+            // Mostly small moves between neighboring chunks
+            const size_t key = (keys[id] != none && action(gen) < 7) ? (keys[id] + 1) % 4096 : chunk(gen);
+            broad.update(id, key);
+            keys[id] = key;
+        }
+    }
+    out = out && broadphase_match(broad, keys);
+    if (!out)
+    {
+        throw std::runtime_error("Failed broadphase random moves");
+    }
+
+    // Updating an id in place must not move it
+    broad.reset_moves();
+    for (size_t i = 0; i < ids; i++)
+    {
+        if (keys[i] != none)
+        {
+            broad.update(i, keys[i]);
+        }
+    }
+    out = out && compare(0, static_cast<int>(broad.moves()));
+    if (!out)
+    {
+        throw std::runtime_error("Failed broadphase stationary ids");
+    }
+
+    // return status
+    return out;
+}
+
+#endif
@@ -0,0 +1,89 @@
+/* Copyright [2013-2018] [Aaron Springstroh, Minimal Graphics Library]
+
+This file is part of the Beyond Dying Skies.
+
+Beyond Dying Skies is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+Beyond Dying Skies is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with Beyond Dying Skies.  If not, see <http://www.gnu.org/licenses/>.
+*/
+#ifndef _BDS_TEST_CULL_BDS_
+#define _BDS_TEST_CULL_BDS_
+
+#include <game/frustum_cull.h>
+#include <min/aabbox.h>
+#include <min/vec3.h>
+#include <random>
+#include <stdexcept>
+#include <test.h>
+#include <vector>
+
+bool test_cull()
+{
+    bool out = true;
+
+    // Camera at the origin looking down +z with a 90 degree view
+    game::frustum_cull cull;
+    const min::vec3<float> eye(0.0, 0.0, 0.0);
+    const min::vec3<float> forward(0.0, 0.0, 1.0);
+    const min::vec3<float> up(0.0, 1.0, 0.0);
+    const min::vec3<float> right(1.0, 0.0, 0.0);
+    cull.set_view(eye, forward, up, right, 1.0, 1.0, 1.0, 64.0);
+
+    // Inside, behind, past far, off to the side, straddling a side plane
+    cull.add(min::aabbox<float, min::vec3>(min::vec3<float>(-1.0, -1.0, 9.0), min::vec3<float>(1.0, 1.0, 11.0)));
+    cull.add(min::aabbox<float, min::vec3>(min::vec3<float>(-1.0, -1.0, -11.0), min::vec3<float>(1.0, 1.0, -9.0)));
+    cull.add(min::aabbox<float, min::vec3>(min::vec3<float>(-1.0, -1.0, 70.0), min::vec3<float>(1.0, 1.0, 72.0)));
+    cull.add(min::aabbox<float, min::vec3>(min::vec3<float>(30.0, -1.0, 9.0), min::vec3<float>(32.0, 1.0, 11.0)));
+    cull.add(min::aabbox<float, min::vec3>(min::vec3<float>(9.0, -1.0, 9.0), min::vec3<float>(12.0, 1.0, 11.0)));
+    const std::vector<size_t> &in = cull.cull();
+    out = out && compare(2, static_cast<int>(in.size()));
+    out = out && compare(0, static_cast<int>(in[0]));
+    out = out && compare(4, static_cast<int>(in[1]));
+    if (!out)
+    {
+        throw std::runtime_error("Failed frustum cull planes");
+    }
+
+    // Range check drops the box straddling the side plane
+    cull.set_range(eye, 14.0);
+    out = out && compare(1, static_cast<int>(cull.cull().size()));
+    if (!out)
+    {
+        throw std::runtime_error("Failed frustum cull range");
+    }
+
+    // cull() runs the AVX2 kernel whenever the CPU has it, whole number boxes keep every product exact so both paths must agree
+    cull.clear();
+    cull.clear_range();
+    std::mt19937 gen(46);
+    std::uniform_int_distribution<int> center(-64, 64);
+    std::uniform_int_distribution<int> extent(0, 3);
+    for (size_t i = 0; i < 1001; i++)
+    {
+        const min::vec3<float> c(center(gen), center(gen), center(gen));
+        const min::vec3<float> e(extent(gen), extent(gen), extent(gen));
+        cull.add(min::aabbox<float, min::vec3>(c - e, c + e));
+    }
+    const std::vector<size_t> batch = cull.cull();
+    const std::vector<size_t> &scalar = cull.cull_scalar();
+    out = out && compare(static_cast<int>(scalar.size()), static_cast<int>(batch.size()));
+    out = out && batch == scalar;
+    out = out && !batch.empty();
+    if (!out)
+    {
+        throw std::runtime_error("Failed frustum cull batch");
+    }
+
+    return out;
+}
+
+#endif
@@ -0,0 +1,134 @@
+/* Copyright [2013-2018] [Aaron Springstroh, Minimal Graphics Library]
+
+This file is part of the Beyond Dying Skies.
+
+Beyond Dying Skies is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+Beyond Dying Skies is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with Beyond Dying Skies.  If not, see <http://www.gnu.org/licenses/>.
+*/
+#ifndef _BDS_TEST_REGISTRY_BDS_
+#define _BDS_TEST_REGISTRY_BDS_
+
+#include <game/registry.h>
+#include <random>
+#include <stdexcept>
+#include <test.h>
+#include <vector>
+
+bool registry_match(const game::registry<size_t> &reg, const std::vector<size_t> &handles, const std::vector<size_t> &values)
+{
+    // Every live handle must find its own value
+    bool out = compare(static_cast<int>(handles.size()), static_cast<int>(reg.size()));
+    const size_t size = handles.size();
+    for (size_t i = 0; i < size; i++)
+    {
+        out = out && reg.valid(handles[i]);
+        out = out && reg[reg.index(handles[i])] == values[i];
+    }
+
+    // Every element must map back to its handle
+    for (size_t i = 0; i < reg.size(); i++)
+    {
+        out = out && reg.index(reg.handle(i)) == i;
+    }
+
+    return out;
+}
+
+bool test_registry()
+{
+    bool out = true;
+
+    // Add and remove at random, the live handles must survive every swap
+    game::registry<size_t> reg;
+    std::vector<size_t> handles;
+    std::vector<size_t> values;
+    std::vector<size_t> stale;
+    std::mt19937 gen(23);
+    std::uniform_int_distribution<size_t> action(0, 2);
+    for (size_t n = 0; n < 5000; n++)
+    {
+        if (action(gen) != 0 || handles.empty())
+        {
+            handles.push_back(reg.add(n));
+            values.push_back(n);
+        }
+        else
+        {
+            // Remove a random live element by its handle
+            const size_t i = std::uniform_int_distribution<size_t>(0, handles.size() - 1)(gen);
+            reg.remove(reg.index(handles[i]));
+            stale.push_back(handles[i]);
+            handles[i] = handles.back();
+            handles.pop_back();
+            values[i] = values.back();
+            values.pop_back();
+        }
+    }
+    out = out && registry_match(reg, handles, values);
+    if (!out)
+    {
+        throw std::runtime_error("Failed registry random removal");
+    }
+
+    // Removed handles must stay invalid even after their slots are reused
+    for (const size_t h : stale)
+    {
+        out = out && !reg.valid(h);
+    }
+    if (!out)
+    {
+        throw std::runtime_error("Failed registry stale handles");
+    }
+
+    // Bulk remove the odd values and mirror the moves in a parallel array
+    std::vector<size_t> mirror(reg.begin(), reg.end());
+    const size_t removed = reg.remove_if([](const size_t v) { return (v % 2) == 1; }, [&mirror](const size_t from, const size_t to) {
+        mirror[to] = mirror[from];
+    });
+    mirror.resize(reg.size());
+    size_t odd = 0;
+    for (size_t i = handles.size(); i-- > 0;)
+    {
+        if (values[i] % 2 == 1)
+        {
+            odd++;
+            out = out && !reg.valid(handles[i]);
+            handles.erase(handles.begin() + i);
+            values.erase(values.begin() + i);
+        }
+    }
+    out = out && compare(static_cast<int>(odd), static_cast<int>(removed));
+    out = out && registry_match(reg, handles, values);
+    out = out && mirror == std::vector<size_t>(reg.begin(), reg.end());
+    if (!out)
+    {
+        throw std::runtime_error("Failed registry bulk removal");
+    }
+
+    // Clearing stales every handle
+    reg.clear();
+    for (const size_t h : handles)
+    {
+        out = out && !reg.valid(h);
+    }
+    out = out && compare(0, static_cast<int>(reg.size()));
+    if (!out)
+    {
+        throw std::runtime_error("Failed registry clear");
+    }
+
+    // return status
+    return out;
+}
+
+#endif
@@ -0,0 +1,84 @@
+/* Copyright [2013-2018] [Aaron Springstroh, Minimal Graphics Library]
+
+This file is part of the Beyond Dying Skies.
+
+Beyond Dying Skies is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+Beyond Dying Skies is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with Beyond Dying Skies.  If not, see <http://www.gnu.org/licenses/>.
+*/
+#ifndef _BDS_TEST_SOLID_BDS_
+#define _BDS_TEST_SOLID_BDS_
+
+#include <game/cgrid.h>
+#include <game/id.h>
+#include <game/options.h>
+#include <min/tri.h>
+#include <random>
+#include <stdexcept>
+#include <test.h>
+
+bool solid_match(game::cgrid &grid)
+{
+    // The bitmap must agree with every cell
+    const size_t scale = grid.grid_scale();
+    for (size_t i = 0; i < scale; i++)
+    {
+        for (size_t j = 0; j < scale; j++)
+        {
+            for (size_t k = 0; k < scale; k++)
+            {
+                const min::tri<size_t> index(i, j, k);
+                const bool solid = grid.get_block_id(grid.get_block_key(index)) != game::block_id::EMPTY;
+                if (grid.is_solid(index) != solid)
+                {
+                    return false;
+                }
+            }
+        }
+    }
+
+    return true;
+}
+
+bool test_solid()
+{
+    bool out = true;
+
+    // Create a small empty grid with chunks that do not fill a whole word
+    game::options opt;
+    opt.set_grid(6);
+    opt.set_chunk(3);
+    opt.set_view(3);
+    game::cgrid grid(opt);
+    out = out && solid_match(grid);
+
+    // Randomly place and remove blocks
+    std::mt19937 gen(7);
+    std::uniform_int_distribution<size_t> cell(0, grid.grid_scale() - 1);
+    std::uniform_int_distribution<int> place(0, 2);
+    for (size_t n = 0; n < 2000; n++)
+    {
+        const min::tri<size_t> index(cell(gen), cell(gen), cell(gen));
+        const game::block_id value = (place(gen) == 0) ? game::block_id::EMPTY : game::block_id::DIRT1;
+        grid.set_block_id(grid.get_block_key(index), value);
+    }
+    out = out && solid_match(grid);
+    if (!out)
+    {
+        throw std::runtime_error("Failed solid bitmap test");
+    }
+
+    // return status
+    return out;
+}
+
+#endif
@@ -0,0 +1,132 @@
+/* Copyright [2013-2018] [Aaron Springstroh, Minimal Graphics Library]
+
+This file is part of the Beyond Dying Skies.
+
+Beyond Dying Skies is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+Beyond Dying Skies is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with Beyond Dying Skies.  If not, see <http://www.gnu.org/licenses/>.
+*/
+#ifndef _BDS_TEST_SWEEP_BDS_
+#define _BDS_TEST_SWEEP_BDS_
+
+#include <game/cgrid.h>
+#include <game/id.h>
+#include <game/options.h>
+#include <min/vec3.h>
+#include <stdexcept>
+#include <test.h>
+
+void sweep_set(game::cgrid &grid, const min::vec3<float> &p, const game::block_id value)
+{
+    // Set the cell containing this point
+    const size_t key = grid.get_block_key(grid.get_grid_index_safe(p));
+    grid.set_block_id(key, value);
+}
+
+bool sweep_shot(const game::cgrid &grid, const min::vec3<float> &p, const min::vec3<float> &d, float &toi)
+{
+    // Sweep a missile sized box, ignore the atlas
+    game::block_id atlas = game::block_id::EMPTY;
+    return grid.sweep(p, game::cgrid::missile_half_extent(), d, toi, atlas);
+}
+
+bool test_sweep()
+{
+    bool out = true;
+
+    // Create a small empty grid
+    game::options opt;
+    opt.set_grid(8);
+    opt.set_chunk(4);
+    opt.set_view(3);
+    game::cgrid grid(opt);
+
+    // Build a single cell wall spanning x in [2, 3]
+    for (float y = -7.5; y < 8.0; y++)
+    {
+        for (float z = -7.5; z < 8.0; z++)
+        {
+            sweep_set(grid, min::vec3<float>(2.5, y, z), game::block_id::STONE1);
+        }
+    }
+
+    // Shots at 60 fps travelling up to 100 cells in one step can not pass the wall
+    for (float speed = 60.0; speed <= 6000.0; speed *= 1.5)
+    {
+        const float dx = speed / 60.0;
+        for (float y = -6.0; y <= 6.0; y += 1.7)
+        {
+            float toi = 0.0;
+            const bool hit = sweep_shot(grid, min::vec3<float>(-4.0, y, 0.3), min::vec3<float>(dx, 0.0, 0.0), toi);
+
+            // Leading face starts at -3.75 and touches the wall at 2.0
+            const bool expect = dx >= 5.75;
+            out = out && compare(hit, expect);
+            if (expect)
+            {
+                out = out && compare(toi * dx, 5.75, 1E-3);
+            }
+            if (!out)
+            {
+                throw std::runtime_error("Failed sweep wall shot at speed " + std::to_string(speed));
+            }
+
+            // Shots from behind stop at the other face of the wall
+            const bool back = sweep_shot(grid, min::vec3<float>(7.0, y, -0.3), min::vec3<float>(-dx, 0.0, 0.0), toi);
+            out = out && compare(back, dx >= 3.75);
+            if (back)
+            {
+                out = out && compare(toi * dx, 3.75, 1E-3);
+            }
+            if (!out)
+            {
+                throw std::runtime_error("Failed sweep back shot at speed " + std::to_string(speed));
+            }
+        }
+    }
+
+    // Resting against the wall is not an impact
+    float toi = 0.0;
+    out = out && compare(sweep_shot(grid, min::vec3<float>(1.75, 0.0, 0.0), min::vec3<float>(0.0, 0.0, 0.0), toi), false);
+    out = out && compare(sweep_shot(grid, min::vec3<float>(1.75, 0.0, 0.0), min::vec3<float>(-20.0, 0.0, 0.0), toi), false);
+    if (!out)
+    {
+        throw std::runtime_error("Failed sweep resting contact");
+    }
+
+    // Replace the wall with a single cell pillar at the origin
+    for (float y = -7.5; y < 8.0; y++)
+    {
+        for (float z = -7.5; z < 8.0; z++)
+        {
+            sweep_set(grid, min::vec3<float>(2.5, y, z), game::block_id::EMPTY);
+        }
+    }
+    sweep_set(grid, min::vec3<float>(0.5, 0.5, 0.5), game::block_id::STONE1);
+
+    // Diagonal shot hits the corner of the pillar
+    const bool diag = sweep_shot(grid, min::vec3<float>(-4.5, -4.5, -4.5), min::vec3<float>(30.0, 30.0, 30.0), toi);
+    out = out && compare(diag, true);
+    out = out && compare(toi, 4.25 / 30.0, 1E-4);
+
+    // Shot passing beside the pillar misses
+    out = out && compare(sweep_shot(grid, min::vec3<float>(-4.5, 1.5, 0.5), min::vec3<float>(30.0, 0.0, 0.0), toi), false);
+    if (!out)
+    {
+        throw std::runtime_error("Failed sweep pillar shot");
+    }
+
+    // return status
+    return out;
+}
+
+#endif
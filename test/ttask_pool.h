@@ -0,0 +1,186 @@
+/* Copyright [2013-2018] [Aaron Springstroh, Minimal Graphics Library]
+
+This file is part of the Beyond Dying Skies.
+
+Beyond Dying Skies is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+Beyond Dying Skies is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with Beyond Dying Skies.  If not, see <http://www.gnu.org/licenses/>.
+*/
+#ifndef _BDS_TEST_TASK_POOL_BDS_
+#define _BDS_TEST_TASK_POOL_BDS_
+
+#include <atomic>
+#include <game/task_pool.h>
+#include <stdexcept>
+#include <test.h>
+#include <thread>
+#include <vector>
+
+size_t task_pool_sum(game::task_pool &pool, const std::vector<size_t> &data, const size_t start, const size_t stop)
+{
+    // Sum small ranges serially
+    if (stop - start <= 64)
+    {
+        size_t out = 0;
+        for (size_t i = start; i < stop; i++)
+        {
+            out += data[i];
+        }
+
+        return out;
+    }
+
+    // Split the range and sum both halves as nested tasks
+    const size_t mid = start + (stop - start) / 2;
+    size_t left = 0;
+    size_t right = 0;
+    game::task_group g;
+    pool.spawn(g, [&pool, &data, &left, start, mid](std::mt19937 &gen) {
+        left = task_pool_sum(pool, data, start, mid);
+    });
+    pool.spawn(g, [&pool, &data, &right, mid, stop](std::mt19937 &gen) {
+        right = task_pool_sum(pool, data, mid, stop);
+    });
+    pool.wait(g);
+
+    return left + right;
+}
+
+bool test_task_pool()
+{
+    bool out = true;
+
+    // Create a work stealing pool
+    game::task_pool pool(4);
+
+    // Test the run adapter with the thread pool signature
+    {
+        std::vector<int> items(10000, 0);
+        const auto work = [&items](std::mt19937 &gen, const size_t i) {
+            items[i]++;
+        };
+
+        // Run the job in parallel, many times
+        pool.wake();
+        for (size_t i = 0; i < 100; i++)
+        {
+            pool.run(std::cref(work), 0, items.size());
+        }
+        pool.sleep();
+
+        // Every item must be touched exactly once per run
+        bool passed = true;
+        for (const int i : items)
+        {
+            passed = passed && (i == 100);
+        }
+        out = out && passed;
+        if (!out)
+        {
+            throw std::runtime_error("Failed task pool run adapter");
+        }
+    }
+
+    // Test nested fork join
+    {
+        std::vector<size_t> data(100000);
+        for (size_t i = 0; i < data.size(); i++)
+        {
+            data[i] = i;
+        }
+
+        // Recursively sum the data
+        const size_t sum = task_pool_sum(pool, data, 0, data.size());
+        const size_t expected = (data.size() * (data.size() - 1)) / 2;
+        out = out && (sum == expected);
+        if (!out)
+        {
+            throw std::runtime_error("Failed task pool nested tasks");
+        }
+    }
+
+    // Test continuations
+    {
+        for (size_t i = 0; i < 100; i++)
+        {
+            std::atomic<size_t> count(0);
+            size_t seen = 0;
+
+            // Spawn tasks and chain a continuation
+            game::task_group g;
+            game::task_group next;
+            for (size_t j = 0; j < 32; j++)
+            {
+                pool.spawn(g, [&count](std::mt19937 &gen) {
+                    count.fetch_add(1);
+                });
+            }
+            pool.then(g, next, [&count, &seen](std::mt19937 &gen) {
+                seen = count.load();
+            });
+            pool.wait(next);
+
+            // Continuation must see all tasks completed
+            out = out && (seen == 32);
+            if (!out)
+            {
+                throw std::runtime_error("Failed task pool continuation");
+            }
+        }
+    }
+
+    // Test concurrent independent jobs
+    {
+        std::vector<std::vector<int>> jobs(4, std::vector<int>(5000, 0));
+        std::vector<std::thread> threads;
+        for (size_t t = 0; t < jobs.size(); t++)
+        {
+            threads.emplace_back([&pool, &jobs, t]() {
+                std::vector<int> &items = jobs[t];
+                const auto work = [&items](std::mt19937 &gen, const size_t i) {
+                    items[i]++;
+                };
+                for (size_t i = 0; i < 50; i++)
+                {
+                    pool.run(std::cref(work), 0, items.size());
+                }
+            });
+        }
+        for (auto &t : threads)
+        {
+            t.join();
+        }
+
+        // Every job must complete independently
+        bool passed = true;
+        for (const auto &items : jobs)
+        {
+            for (const int i : items)
+            {
+                passed = passed && (i == 50);
+            }
+        }
+        out = out && passed;
+        if (!out)
+        {
+            throw std::runtime_error("Failed task pool concurrent jobs");
+        }
+    }
+
+    // Kill the pool
+    pool.kill();
+
+    // return status
+    return out;
+}
+
+#endif
@@ -0,0 +1,277 @@
+/* Copyright [2013-2018] [Aaron Springstroh, Minimal Graphics Library]
+
+This file is part of the Beyond Dying Skies.
+
+Beyond Dying Skies is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+Beyond Dying Skies is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with Beyond Dying Skies.  If not, see <http://www.gnu.org/licenses/>.
+*/
+#ifndef _BDS_TEST_WORLD_FORMAT_BDS_
+#define _BDS_TEST_WORLD_FORMAT_BDS_
+
+#include <cstdio>
+#include <fstream>
+#include <game/edit_journal.h>
+#include <game/file.h>
+#include <game/id.h>
+#include <game/lz.h>
+#include <game/mapped_file.h>
+#include <game/save_writer.h>
+#include <game/world_format.h>
+#include <atomic>
+#include <random>
+#include <stdexcept>
+#include <test.h>
+#include <vector>
+
+bool test_world_format()
+{
+    bool out = true;
+
+    // Layered terrain with noise so every chunk encoding is used
+    const size_t scale = 32;
+    std::vector<game::block_id> grid(scale * scale * scale, game::block_id::EMPTY);
+    std::mt19937 gen(47);
+    std::uniform_int_distribution<int> noise(0, 40);
+    for (size_t i = 0; i < grid.size(); i++)
+    {
+        const size_t y = (i / scale) % scale;
+        if (y < 8)
+        {
+            grid[i] = static_cast<game::block_id>(noise(gen) % 3);
+        }
+        else if (y < 12)
+        {
+            grid[i] = static_cast<game::block_id>(noise(gen));
+        }
+        else if (y < 16)
+        {
+            grid[i] = game::block_id::DIRT1;
+        }
+    }
+
+    // Round trip with and without the LZ pass
+    game::world_format format;
+    std::vector<uint8_t> stream;
+    for (const bool compress : {false, true})
+    {
+        for (const size_t chunk : {4, 8, 16})
+        {
+            format.encode(grid, scale, chunk, compress, 0, stream);
+            std::vector<game::block_id> load(grid.size(), game::block_id::INVALID);
+            out = out && game::world_format::decode(stream.data(), stream.size(), scale, load);
+            out = out && load == grid;
+            out = out && stream.size() < grid.size();
+        }
+    }
+    if (!out)
+    {
+        throw std::runtime_error("Failed world format round trip");
+    }
+
+    // Raw saves are not the new format and other sizes are rejected
+    std::vector<game::block_id> small(8 * 8 * 8);
+    const uint8_t header[8] = {0x00, 0x80, 0x00, 0x00, 0xFF, 0xFF, 0xFF, 0xFF};
+    out = out && !game::world_format::is_format(header, sizeof(header));
+    out = out && !game::world_format::decode(stream.data(), stream.size(), 8, small);
+    if (!out)
+    {
+        throw std::runtime_error("Failed world format detection");
+    }
+
+    // Truncated files and unknown versions are rejected so the world regenerates
+    {
+        std::vector<game::block_id> load(grid.size());
+        out = out && !game::world_format::decode(stream.data(), stream.size() - 1, scale, load);
+        std::vector<uint8_t> future(stream);
+        future[4] = 0xFF;
+        out = out && !game::world_format::decode(future.data(), future.size(), scale, load);
+    }
+    if (!out)
+    {
+        throw std::runtime_error("Failed world format truncation");
+    }
+
+    // Raw saves decode straight from a mapped file
+    std::vector<uint8_t> raw;
+    const uint32_t cells = static_cast<uint32_t>(grid.size());
+    for (size_t i = 0; i < 4; i++)
+    {
+        raw.push_back(static_cast<uint8_t>(cells >> (i * 8)));
+    }
+    for (const game::block_id b : grid)
+    {
+        raw.push_back(static_cast<uint8_t>(static_cast<int8_t>(b)));
+    }
+    const std::string name = "bds_world_test.bin";
+    game::file::save_file(name, raw);
+    {
+        const game::mapped_file map(name);
+        std::vector<game::block_id> load(grid.size(), game::block_id::INVALID);
+        out = out && !game::world_format::is_format(map.data(), map.size());
+        out = out && game::world_format::decode_raw(map.data(), map.size(), scale, load);
+        out = out && load == grid;
+        out = out && !game::world_format::decode_raw(map.data(), map.size() - 1, scale, load);
+    }
+    std::remove(name.c_str());
+    if (!out)
+    {
+        throw std::runtime_error("Failed world format raw mapped load");
+    }
+
+    // LZ round trip of overlapping repeats
+    std::vector<uint8_t> bytes;
+    for (size_t i = 0; i < 5000; i++)
+    {
+        bytes.push_back(static_cast<uint8_t>((i % 7 == 0) ? noise(gen) : i % 3));
+    }
+    std::vector<uint8_t> packed;
+    game::lz::compress(bytes.data(), bytes.size(), packed);
+    std::vector<uint8_t> unpacked(bytes.size());
+    out = out && game::lz::decompress(packed.data(), packed.size(), unpacked.data(), unpacked.size());
+    out = out && unpacked == bytes;
+    out = out && packed.size() < bytes.size();
+    if (!out)
+    {
+        throw std::runtime_error("Failed lz round trip");
+    }
+
+    return out;
+}
+
+bool test_edit_journal()
+{
+    bool out = true;
+
+    // Two saves worth of edits, the second overwrites a cell of the first
+    const std::string name = "bds_journal_test.bin";
+    const size_t scale = 8;
+    std::vector<game::block_id> grid(scale * scale * scale, game::block_id::EMPTY);
+    std::vector<game::block_id> expect(grid);
+    const uint32_t base = 7;
+    game::edit_journal journal;
+    game::edit_journal::remove(name);
+    const auto edit = [&journal, &expect](const size_t key, const game::block_id value) {
+        journal.append(key, value);
+        expect[key] = value;
+    };
+    edit(3, game::block_id::DIRT1);
+    edit(77, game::block_id::DIRT1);
+    out = out && journal.flush(name, scale, base);
+    edit(77, game::block_id::EMPTY);
+    edit(500, game::block_id::DIRT1);
+    out = out && journal.flush(name, scale, base);
+
+    // Replay restores the last value of every cell
+    const auto apply = [&grid](const size_t key, const game::block_id value) {
+        grid[key] = value;
+    };
+    game::edit_journal load;
+    out = out && load.replay(name, scale, base, apply);
+    out = out && grid == expect;
+    out = out && load.bytes() == journal.bytes();
+    if (!out)
+    {
+        throw std::runtime_error("Failed edit journal replay");
+    }
+
+    // A torn block from a crash is dropped and flagged, a log of another size or base world is ignored
+    {
+        std::ofstream file(name, std::ios::out | std::ios::binary | std::ios::app);
+        file.put(2);
+        file.put(0);
+    }
+    grid.assign(grid.size(), game::block_id::EMPTY);
+    out = out && !load.replay(name, scale, base, apply);
+    out = out && grid == expect;
+    grid.assign(grid.size(), game::block_id::EMPTY);
+    out = out && !load.replay(name, scale * 2, base, apply);
+    out = out && !load.replay(name, scale, base + 1, apply);
+    out = out && grid[3] == game::block_id::EMPTY;
+    if (!out)
+    {
+        throw std::runtime_error("Failed edit journal torn block");
+    }
+
+    // Sealed edits replay before the current log until the base world holds them
+    journal.discard();
+    edit(9, game::block_id::DIRT1);
+    out = out && journal.flush(name, scale, base);
+    journal.seal(name);
+    out = out && journal.bytes() == 0;
+    edit(9, game::block_id::EMPTY);
+    out = out && journal.flush(name, scale, base);
+    grid[9] = game::block_id::DIRT1;
+    out = out && !load.replay(name, scale, base, apply);
+    out = out && grid[9] == game::block_id::EMPTY;
+    game::edit_journal::remove_sealed(name);
+    out = out && !game::file::exists_file(name + ".old");
+    game::edit_journal::remove(name);
+    if (!out)
+    {
+        throw std::runtime_error("Failed edit journal compaction");
+    }
+
+    return out;
+}
+
+bool test_save_writer()
+{
+    bool out = true;
+
+    // Layered world that is saved while it is being edited
+    const std::string name = "bds_save_test.bin";
+    const size_t scale = 32;
+    const size_t chunk = 4;
+    std::vector<game::block_id> grid(scale * scale * scale, game::block_id::EMPTY);
+    for (size_t i = 0; i < grid.size(); i++)
+    {
+        if ((i / scale) % scale < 12)
+        {
+            grid[i] = game::block_id::DIRT1;
+        }
+    }
+    const std::vector<game::block_id> snapshot(grid);
+
+    // Edit cells across the grid while the writer encodes
+    std::atomic<bool> done(false);
+    game::save_writer saver;
+    saver.begin(grid, scale, chunk, 9, name, std::string(), std::vector<uint8_t>(), [&done]() {
+        done = true;
+    });
+    for (size_t i = 0; i < grid.size(); i += 97)
+    {
+        saver.before_write(i);
+        grid[i] = game::block_id::DIRT2;
+    }
+    saver.wait();
+    out = out && done && !saver.failed() && !saver.is_active();
+    out = out && saver.progress() < 0.0;
+
+    // The file holds the world as it was when the save began
+    std::vector<game::block_id> load(grid.size(), game::block_id::EMPTY);
+    {
+        const game::mapped_file map(name);
+        out = out && game::world_format::decode(map.data(), map.size(), scale, load);
+        out = out && game::world_format::base(map.data(), map.size()) == 9;
+    }
+    out = out && load == snapshot;
+    std::remove(name.c_str());
+    if (!out)
+    {
+        throw std::runtime_error("Failed save writer snapshot");
+    }
+
+    return out;
+}
+
+#endif